@@ -0,0 +1,15 @@
+// Live updates for the root page. The first 'state' event carries the
+// whole state; later ones only the fields that changed.
+function set(id, v) { var e = document.getElementById(id); if (e) e.textContent = v; }
+function onoff(v) { return v ? "ON" : "OFF"; }
+var es = new EventSource("/events");
+es.addEventListener("state", function(e) {
+  var s = JSON.parse(e.data);
+  if ("temps" in s) s.temps.forEach(function(t, i) { set("t" + i, t.toFixed(2)); });
+  if ("vcc" in s) set("vcc", s.vcc.toFixed(2));
+  if ("light" in s) set("light", s.light);
+  if ("moisture" in s) set("moisture", s.moisture);
+  if ("relay_1" in s) set("relay_1", onoff(s.relay_1));
+  if ("relay_2" in s) set("relay_2", onoff(s.relay_2));
+  if ("dry" in s) set("dry", s.dry ? "DRY" : "OK");
+});
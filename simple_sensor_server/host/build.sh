@@ -0,0 +1,15 @@
+#!/bin/sh
+# Builds the Linux sensor server and the load generator into ./build.
+#
+#   ./build.sh            Optimised build
+#   CXX=clang++ ./build.sh
+#   CXXFLAGS="-O1 -g -fsanitize=address,undefined" ./build.sh
+set -e
+cd "$(dirname "$0")"
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:--O2 -g}
+WARN="-std=c++17 -Wall -Wextra"
+mkdir -p build
+$CXX $WARN $CXXFLAGS -I../web_server_kit -o build/sensor_server sensor_server.cpp
+$CXX $WARN $CXXFLAGS -o build/load_gen load_gen.cpp
+echo "Built build/sensor_server and build/load_gen"
@@ -0,0 +1,65 @@
+// Fake sensors for the host build.
+//
+// Produces plausible, slowly changing readings in place of the DS18B20
+// probes, the ADS1115 and the supply voltage, and switches the relays
+// from them the way the sketch's controllers would. Deterministic for a
+// given seed, so runs are repeatable.
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#include "sensor_app.h"
+
+class FakeSensors
+{
+public:
+   explicit FakeSensors(uint8_t probes = 1, uint32_t seed = 1) :
+      _probes(probes > MAX_PROBES ? MAX_PROBES : probes),
+      _rng(seed != 0 ? seed : 1)
+   {
+      for ( uint8_t i = 0; i < MAX_PROBES; ++i )
+         _temp[i] = 70.0f + i;
+   }
+
+   // Advances the fake readings to now_ms and writes them to snap.
+   void fill(Snapshot& snap, uint32_t now_ms)
+   {
+      snap.format = SNAPSHOT_FORMAT;
+      snap.probes = _probes;
+      for ( uint8_t i = 0; i < _probes; ++i )
+      {
+         // Random walk, pulled back towards 70 F.
+         _temp[i] += 0.02f * (_uniform() - 0.5f) + 0.001f * (70.0f - _temp[i]);
+         snap.temp[i] = static_cast<int16_t>(lroundf(_temp[i] * 100.0f));
+      }
+      snap.vcc = static_cast<uint16_t>(3300 + static_cast<int>(_uniform() * 20.0f));
+
+      // Light follows a 10 minute 'day'; moisture dries out and is watered.
+      const float phase = static_cast<float>(now_ms % 600000U) / 600000.0f;
+      snap.light = static_cast<int16_t>(22000.0f + 8000.0f * std::sin(6.2831853f * phase) + 50.0f * _uniform());
+      _moisture += 2.0f;
+      if ( _moisture > 14000.0f )
+         _moisture = 9000.0f;
+      snap.moisture = static_cast<int16_t>(_moisture);
+
+      snap.relay_1 = snap.temp[0] < 7000 ? 1U : 0U;
+      snap.relay_2 = snap.light < 22000 ? 1U : 0U;
+      snap.is_dry = snap.moisture > 12000 ? 1U : 0U;
+   } // fill()
+
+private:
+   // xorshift32, in [0, 1)
+   float _uniform()
+   {
+      _rng ^= _rng << 13;
+      _rng ^= _rng >> 17;
+      _rng ^= _rng << 5;
+      return static_cast<float>(_rng >> 8) / 16777216.0f;
+   } // _uniform()
+
+   uint8_t  _probes;
+   uint32_t _rng;
+   float    _temp[MAX_PROBES];
+   float    _moisture {10000.0f};
+}; // FakeSensors
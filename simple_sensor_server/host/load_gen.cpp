@@ -0,0 +1,505 @@
+// HTTP load generator for the sensor server.
+//
+// Runs a closed-loop load at each concurrency level in turn: N
+// connections, each sending its next request as soon as the previous
+// response is complete. Requests cycle through the given paths. For each
+// level it reports throughput and latency percentiles, and optionally
+// writes all levels as JSON and/or CSV so runs can be compared.
+//
+// usage: load_gen [options]
+//   --host A          Server address (127.0.0.1)
+//   --port N          Server port (8080)
+//   --path P          Request path; repeat for several (/api/state)
+//   --concurrency L   Comma-separated levels (1,2,4,8,16)
+//   --duration S      Seconds measured per level (5)
+//   --warmup S        Seconds run before measuring each level (1)
+//   --timeout-ms N    A request taking longer counts as an error (2000)
+//   --close           Connection: close on every request (default keep-alive)
+//   --json FILE       Write results as JSON
+//   --csv FILE        Write results as CSV
+//
+// Single-threaded, non-blocking sockets driven by epoll. Linux only.
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+struct Options
+{
+   std::string host {"127.0.0.1"};
+   unsigned port {8080};
+   std::vector<std::string> paths;
+   std::vector<unsigned> levels {1, 2, 4, 8, 16};
+   double duration_s {5.0};
+   double warmup_s {1.0};
+   unsigned timeout_ms {2000};
+   bool keep_alive {true};
+   std::string json;
+   std::string csv;
+}; // Options
+
+// Results for one concurrency level.
+struct Result
+{
+   unsigned concurrency {0};
+   uint64_t requests {0};    // Completed with a status below 400
+   uint64_t errors {0};      // Failed connections, timeouts, status 400 and up
+   uint64_t connects {0};    // TCP connections opened
+   uint64_t bytes {0};       // Response bytes received
+   double   seconds {0.0};
+   double   rps {0.0};
+   double   p50_us {0.0};
+   double   p99_us {0.0};
+   double   p999_us {0.0};
+   double   max_us {0.0};
+}; // Result
+
+// One client connection.
+struct Conn
+{
+   int         fd {-1};
+   size_t      path {0};      // Index of the path being requested
+   std::string out;           // Request bytes not yet sent
+   std::string in;            // Response bytes so far
+   Clock::time_point start;   // When the request was started
+   bool        busy {false};  // A request is outstanding
+}; // Conn
+
+// Parses a response in buf.
+// Returns -1 if it is malformed, 0 if incomplete, or the number of bytes
+// it occupies. Sets status and whether the server will close.
+static long response_length(const std::string& buf, int& status, bool& close)
+{
+   const size_t head_end = buf.find("\r\n\r\n");
+   if ( head_end == std::string::npos )
+      return 0;
+   if ( buf.compare(0, 9, "HTTP/1.1 ") != 0 && buf.compare(0, 9, "HTTP/1.0 ") != 0 )
+      return -1;
+   status = atoi(buf.c_str() + 9);
+   close = buf.compare(0, 9, "HTTP/1.0 ") == 0;
+
+   long content_length = -1;
+   bool chunked = false;
+   size_t pos = buf.find("\r\n") + 2;
+   while ( pos < head_end )
+   {
+      size_t eol = buf.find("\r\n", pos);
+      std::string line = buf.substr(pos, eol - pos);
+      std::string lower = line;
+      std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+      if ( lower.compare(0, 15, "content-length:") == 0 )
+         content_length = atol(line.c_str() + 15);
+      else if ( lower.compare(0, 18, "transfer-encoding:") == 0 && lower.find("chunked") != std::string::npos )
+         chunked = true;
+      else if ( lower.compare(0, 11, "connection:") == 0 )
+         close = lower.find("close") != std::string::npos;
+      pos = eol + 2;
+   }
+
+   size_t body = head_end + 4;
+   if ( status == 304 || status == 204 )
+      return static_cast<long>(body);
+   if ( chunked )
+   {
+      for ( ;; )
+      {
+         size_t eol = buf.find("\r\n", body);
+         if ( eol == std::string::npos )
+            return 0;
+         long n = strtol(buf.c_str() + body, nullptr, 16);
+         if ( n < 0 )
+            return -1;
+         body = eol + 2 + static_cast<size_t>(n) + 2;
+         if ( body > buf.size() )
+            return 0;
+         if ( n == 0 )
+            return static_cast<long>(body);
+      }
+   }
+   if ( content_length < 0 )
+      return -1; // The server always sends one or the other
+   if ( buf.size() < body + static_cast<size_t>(content_length) )
+      return 0;
+   return static_cast<long>(body + static_cast<size_t>(content_length));
+} // response_length()
+
+class LoadRun
+{
+public:
+   LoadRun(const Options& opt, unsigned concurrency) :
+      _opt(opt),
+      _conns(concurrency)
+   {
+      _epoll = epoll_create1(0);
+      memset(&_addr, 0, sizeof(_addr));
+      _addr.sin_family = AF_INET;
+      _addr.sin_port = htons(static_cast<uint16_t>(opt.port));
+      inet_pton(AF_INET, opt.host.c_str(), &_addr.sin_addr);
+      for ( size_t i = 0; i < _conns.size(); ++i )
+         _conns[i].path = i % opt.paths.size();
+   }
+
+   ~LoadRun()
+   {
+      for ( auto& c : _conns )
+         if ( c.fd >= 0 )
+            ::close(c.fd);
+      ::close(_epoll);
+   }
+
+   Result run()
+   {
+      const auto warmup_end = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(_opt.warmup_s));
+      const auto end = warmup_end + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(_opt.duration_s));
+
+      for ( auto& c : _conns )
+         _start(c);
+
+      epoll_event events[64];
+      bool measuring = false;
+      while ( Clock::now() < end )
+      {
+         if ( !measuring && Clock::now() >= warmup_end )
+         {
+            measuring = true;
+            _measure = true;
+            _result = Result();
+            _latencies.clear();
+         }
+
+         int n = epoll_wait(_epoll, events, 64, 10);
+         for ( int i = 0; i < n; ++i )
+         {
+            // Errors and hang-ups surface through recv(), after any
+            // response that arrived before them.
+            Conn& c = _conns[events[i].data.u32];
+            if ( events[i].events & EPOLLOUT )
+               _send(c);
+            if ( c.fd >= 0 && (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) )
+               _recv(c);
+         }
+         _check_timeouts();
+      }
+
+      _result.concurrency = static_cast<unsigned>(_conns.size());
+      _result.seconds = _opt.duration_s;
+      _result.rps = _result.requests / _opt.duration_s;
+      if ( !_latencies.empty() )
+      {
+         std::sort(_latencies.begin(), _latencies.end());
+         _result.p50_us = _percentile(0.50);
+         _result.p99_us = _percentile(0.99);
+         _result.p999_us = _percentile(0.999);
+         _result.max_us = _latencies.back();
+      }
+      return _result;
+   } // run()
+
+private:
+   // Sends the next request, connecting first if needed.
+   void _start(Conn& c)
+   {
+      if ( c.fd < 0 && !_connect(c) )
+         return;
+      c.out = "GET " + _opt.paths[c.path] + " HTTP/1.1\r\nHost: " + _opt.host +
+         (_opt.keep_alive ? "\r\n\r\n" : "\r\nConnection: close\r\n\r\n");
+      c.in.clear();
+      c.busy = true;
+      c.start = Clock::now();
+      _send(c);
+   } // _start()
+
+   bool _connect(Conn& c)
+   {
+      c.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+      if ( c.fd < 0 )
+         return false;
+      int one = 1;
+      setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      if ( ::connect(c.fd, reinterpret_cast<sockaddr*>(&_addr), sizeof(_addr)) < 0 && errno != EINPROGRESS )
+      {
+         ::close(c.fd);
+         c.fd = -1;
+         _count_error();
+         return false;
+      }
+      epoll_event ev {};
+      ev.events = EPOLLIN | EPOLLOUT;
+      ev.data.u32 = static_cast<uint32_t>(&c - _conns.data());
+      epoll_ctl(_epoll, EPOLL_CTL_ADD, c.fd, &ev);
+      if ( _measure )
+         ++_result.connects;
+      return true;
+   } // _connect()
+
+   void _send(Conn& c)
+   {
+      if ( c.out.empty() )
+         return;
+      ssize_t n = ::send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+      if ( n > 0 )
+         c.out.erase(0, static_cast<size_t>(n));
+      else if ( n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOTCONN )
+      {
+         _fail(c);
+         return;
+      }
+      _watch(c);
+   } // _send()
+
+   // Only ask for write readiness while there is something to write.
+   void _watch(Conn& c)
+   {
+      epoll_event ev {};
+      ev.events = EPOLLIN | (c.out.empty() ? 0U : static_cast<uint32_t>(EPOLLOUT));
+      ev.data.u32 = static_cast<uint32_t>(&c - _conns.data());
+      epoll_ctl(_epoll, EPOLL_CTL_MOD, c.fd, &ev);
+   } // _watch()
+
+   void _recv(Conn& c)
+   {
+      char buf[4096];
+      for ( ;; )
+      {
+         ssize_t n = ::recv(c.fd, buf, sizeof(buf), 0);
+         if ( n > 0 )
+         {
+            c.in.append(buf, static_cast<size_t>(n));
+            continue;
+         }
+         if ( n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) )
+            break;
+         // Closed. Fine if a complete response arrived first.
+         _complete(c, true);
+         return;
+      }
+      _complete(c, false);
+   } // _recv()
+
+   // Finishes the request if its response is complete.
+   void _complete(Conn& c, bool closed)
+   {
+      int status = 0;
+      bool close = false;
+      long len = c.busy ? response_length(c.in, status, close) : 0;
+      if ( len < 0 || (len == 0 && closed) )
+      {
+         _fail(c);
+         return;
+      }
+      if ( len == 0 )
+         return;
+
+      const double us = std::chrono::duration<double, std::micro>(Clock::now() - c.start).count();
+      if ( _measure )
+      {
+         _result.bytes += static_cast<uint64_t>(len);
+         if ( status >= 400 )
+            ++_result.errors;
+         else
+         {
+            ++_result.requests;
+            _latencies.push_back(us);
+         }
+      }
+      c.busy = false;
+      c.path = (c.path + 1) % _opt.paths.size();
+      if ( close || closed || !_opt.keep_alive )
+         _disconnect(c);
+      _start(c);
+   } // _complete()
+
+   void _fail(Conn& c)
+   {
+      _count_error();
+      c.busy = false;
+      _disconnect(c);
+      _start(c);
+   } // _fail()
+
+   void _disconnect(Conn& c)
+   {
+      if ( c.fd >= 0 )
+      {
+         epoll_ctl(_epoll, EPOLL_CTL_DEL, c.fd, nullptr);
+         ::close(c.fd);
+      }
+      c.fd = -1;
+      c.out.clear();
+      c.in.clear();
+   } // _disconnect()
+
+   void _check_timeouts()
+   {
+      const auto now = Clock::now();
+      for ( auto& c : _conns )
+      {
+         if ( c.fd < 0 && !c.busy )
+            _start(c); // Connecting failed earlier; try again
+         else if ( c.busy && now - c.start > std::chrono::milliseconds(_opt.timeout_ms) )
+            _fail(c);
+      }
+   } // _check_timeouts()
+
+   void _count_error()
+   {
+      if ( _measure )
+         ++_result.errors;
+   } // _count_error()
+
+   double _percentile(double p) const
+   {
+      size_t i = static_cast<size_t>(p * static_cast<double>(_latencies.size() - 1) + 0.5);
+      return _latencies[std::min(i, _latencies.size() - 1)];
+   } // _percentile()
+
+   const Options&      _opt;
+   std::vector<Conn>   _conns;
+   int                 _epoll {-1};
+   sockaddr_in         _addr;
+   bool                _measure {false};
+   Result              _result;
+   std::vector<double> _latencies;
+}; // LoadRun
+
+static std::vector<unsigned> parse_levels(const char* s)
+{
+   std::vector<unsigned> levels;
+   while ( *s != '\0' )
+   {
+      char* end = nullptr;
+      unsigned long v = strtoul(s, &end, 10);
+      if ( end == s || v == 0 )
+         return {};
+      levels.push_back(static_cast<unsigned>(v));
+      s = ( *end == ',' ) ? end + 1 : end;
+   }
+   return levels;
+} // parse_levels()
+
+static void usage(const char* argv0)
+{
+   fprintf(stderr,
+      "usage: %s [--host A] [--port N] [--path P]... [--concurrency 1,2,4]\n"
+      "          [--duration S] [--warmup S] [--timeout-ms N] [--close]\n"
+      "          [--json FILE] [--csv FILE]\n", argv0);
+} // usage()
+
+static bool write_json(const std::string& file, const Options& opt, const std::vector<Result>& results)
+{
+   FILE* f = fopen(file.c_str(), "w");
+   if ( f == nullptr )
+      return false;
+   fprintf(f, "{\n  \"host\": \"%s\",\n  \"port\": %u,\n  \"keep_alive\": %s,\n  \"paths\": [",
+      opt.host.c_str(), opt.port, opt.keep_alive ? "true" : "false");
+   for ( size_t i = 0; i < opt.paths.size(); ++i )
+      fprintf(f, "%s\"%s\"", i ? ", " : "", opt.paths[i].c_str());
+   fprintf(f, "],\n  \"results\": [\n");
+   for ( size_t i = 0; i < results.size(); ++i )
+   {
+      const Result& r = results[i];
+      fprintf(f, "    {\"concurrency\": %u, \"requests\": %llu, \"errors\": %llu, \"connects\": %llu, "
+         "\"bytes\": %llu, \"seconds\": %.3f, \"rps\": %.1f, \"p50_us\": %.1f, \"p99_us\": %.1f, "
+         "\"p999_us\": %.1f, \"max_us\": %.1f}%s\n",
+         r.concurrency, static_cast<unsigned long long>(r.requests), static_cast<unsigned long long>(r.errors),
+         static_cast<unsigned long long>(r.connects), static_cast<unsigned long long>(r.bytes), r.seconds,
+         r.rps, r.p50_us, r.p99_us, r.p999_us, r.max_us, i + 1 < results.size() ? "," : "");
+   }
+   fprintf(f, "  ]\n}\n");
+   return fclose(f) == 0;
+} // write_json()
+
+static bool write_csv(const std::string& file, const std::vector<Result>& results)
+{
+   FILE* f = fopen(file.c_str(), "w");
+   if ( f == nullptr )
+      return false;
+   fprintf(f, "concurrency,requests,errors,connects,bytes,seconds,rps,p50_us,p99_us,p999_us,max_us\n");
+   for ( const Result& r : results )
+      fprintf(f, "%u,%llu,%llu,%llu,%llu,%.3f,%.1f,%.1f,%.1f,%.1f,%.1f\n",
+         r.concurrency, static_cast<unsigned long long>(r.requests), static_cast<unsigned long long>(r.errors),
+         static_cast<unsigned long long>(r.connects), static_cast<unsigned long long>(r.bytes), r.seconds,
+         r.rps, r.p50_us, r.p99_us, r.p999_us, r.max_us);
+   return fclose(f) == 0;
+} // write_csv()
+
+int main(int argc, char** argv)
+{
+   Options opt;
+   for ( int i = 1; i < argc; ++i )
+   {
+      const bool has_value = i + 1 < argc;
+      if ( strcmp(argv[i], "--host") == 0 && has_value )
+         opt.host = argv[++i];
+      else if ( strcmp(argv[i], "--port") == 0 && has_value )
+         opt.port = static_cast<unsigned>(atoi(argv[++i]));
+      else if ( strcmp(argv[i], "--path") == 0 && has_value )
+         opt.paths.push_back(argv[++i]);
+      else if ( strcmp(argv[i], "--concurrency") == 0 && has_value )
+         opt.levels = parse_levels(argv[++i]);
+      else if ( strcmp(argv[i], "--duration") == 0 && has_value )
+         opt.duration_s = atof(argv[++i]);
+      else if ( strcmp(argv[i], "--warmup") == 0 && has_value )
+         opt.warmup_s = atof(argv[++i]);
+      else if ( strcmp(argv[i], "--timeout-ms") == 0 && has_value )
+         opt.timeout_ms = static_cast<unsigned>(atoi(argv[++i]));
+      else if ( strcmp(argv[i], "--close") == 0 )
+         opt.keep_alive = false;
+      else if ( strcmp(argv[i], "--json") == 0 && has_value )
+         opt.json = argv[++i];
+      else if ( strcmp(argv[i], "--csv") == 0 && has_value )
+         opt.csv = argv[++i];
+      else
+      {
+         usage(argv[0]);
+         return 2;
+      }
+   }
+   if ( opt.paths.empty() )
+      opt.paths.push_back("/api/state");
+   in_addr probe;
+   if ( opt.levels.empty() || opt.duration_s <= 0.0 || inet_pton(AF_INET, opt.host.c_str(), &probe) != 1 )
+   {
+      usage(argv[0]);
+      return 2;
+   }
+
+   std::vector<Result> results;
+   printf("%11s %9s %7s %9s %10s %10s %10s %10s\n", "concurrency", "requests", "errors", "rps", "p50_us", "p99_us", "p999_us", "max_us");
+   for ( unsigned level : opt.levels )
+   {
+      LoadRun run(opt, level);
+      Result r = run.run();
+      printf("%11u %9llu %7llu %9.1f %10.1f %10.1f %10.1f %10.1f\n", r.concurrency,
+         static_cast<unsigned long long>(r.requests), static_cast<unsigned long long>(r.errors),
+         r.rps, r.p50_us, r.p99_us, r.p999_us, r.max_us);
+      fflush(stdout);
+      results.push_back(r);
+   }
+
+   if ( !opt.json.empty() && !write_json(opt.json, opt, results) )
+   {
+      perror(opt.json.c_str());
+      return 1;
+   }
+   if ( !opt.csv.empty() && !write_csv(opt.csv, results) )
+   {
+      perror(opt.csv.c_str());
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,134 @@
+// Linux build of the sensor server.
+//
+// Serves sensor_app.h, the same pages and API as the sketch, from fake
+// sensors over POSIX sockets, with the same connection pool and buffer
+// sizes as the device. Used as the target for load_gen.
+//
+// usage: sensor_server [--port N] [--probes N] [--period-ms N] [--idle-us N]
+//                      [--prefill-hours N]
+//   --port       Listening port (8080)
+//   --probes     Fake temperature probes, 1 - 4 (1)
+//   --period-ms  Time between snapshots, as do_snapshot() on the device (1000)
+//   --idle-us    Sleep after a pass of the loop; 0 spins (50)
+//   --prefill-hours  Start with this much sensor history, as if the server
+//                had already been up that long (0)
+//
+// Prints the server counters when stopped with Ctrl-C or SIGTERM.
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "http_backend_posix.h"
+#include "sensor_app.h"
+#include "fake_sensors.h"
+
+static volatile std::sig_atomic_t stop = 0;
+
+static void on_signal(int)
+{
+   stop = 1;
+}
+
+static uint32_t millis()
+{
+   using namespace std::chrono;
+   return static_cast<uint32_t>(duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+static constexpr uint32_t HISTORY_PERIOD_S = 5; // As HISTORY_PERIOD_MS in the sketch
+
+// Samples a snapshot into the history, as do_history() on the device.
+static void record_history(const Snapshot& snap, uint32_t t)
+{
+   temp_history.add_float(t, snap.temp[0] / 100.0f);
+   light_history.add(t, snap.light);
+   moisture_history.add(t, snap.moisture);
+}
+
+int main(int argc, char** argv)
+{
+   unsigned port = 8080;
+   unsigned probes = 1;
+   unsigned period_ms = 1000;
+   unsigned idle_us = 50;
+   unsigned prefill_hours = 0;
+   for ( int i = 1; i < argc; ++i )
+   {
+      const bool has_value = i + 1 < argc;
+      if ( strcmp(argv[i], "--port") == 0 && has_value )
+         port = static_cast<unsigned>(atoi(argv[++i]));
+      else if ( strcmp(argv[i], "--probes") == 0 && has_value )
+         probes = static_cast<unsigned>(atoi(argv[++i]));
+      else if ( strcmp(argv[i], "--period-ms") == 0 && has_value )
+         period_ms = static_cast<unsigned>(atoi(argv[++i]));
+      else if ( strcmp(argv[i], "--idle-us") == 0 && has_value )
+         idle_us = static_cast<unsigned>(atoi(argv[++i]));
+      else if ( strcmp(argv[i], "--prefill-hours") == 0 && has_value )
+         prefill_hours = static_cast<unsigned>(atoi(argv[++i]));
+      else
+      {
+         fprintf(stderr, "usage: %s [--port N] [--probes N] [--period-ms N] [--idle-us N] [--prefill-hours N]\n", argv[0]);
+         return 2;
+      }
+   }
+
+   SSW::PosixBackend backend;
+   static SensorServer<SSW::PosixBackend> server(backend);
+   attach_routes(server);
+   if ( !backend.begin(static_cast<uint16_t>(port), 64) )
+   {
+      perror("sensor_server: listen");
+      return 1;
+   }
+
+   std::signal(SIGINT, on_signal);
+   std::signal(SIGTERM, on_signal);
+   printf("sensor_server: listening on port %u, %u probe(s)\n", port, probes);
+   fflush(stdout);
+
+   FakeSensors sensors(static_cast<uint8_t>(probes));
+
+   // History times are seconds since 'boot', which is backdated by the
+   // prefill so the live samples carry on from the synthetic ones.
+   const uint32_t prefill_s = prefill_hours * 3600U;
+   {
+      FakeSensors history_sensors(static_cast<uint8_t>(probes), 2);
+      Snapshot snap {};
+      for ( uint32_t t = HISTORY_PERIOD_S; t < prefill_s; t += HISTORY_PERIOD_S )
+      {
+         history_sensors.fill(snap, t * 1000U);
+         record_history(snap, t);
+      }
+   }
+   const uint32_t boot_ms = millis() - prefill_s * 1000U;
+   uint32_t next_history = prefill_s + HISTORY_PERIOD_S;
+
+   uint32_t last_snapshot = millis() - period_ms;
+   while ( !stop )
+   {
+      const uint32_t now = millis();
+      server.poll(now);
+      if ( now - last_snapshot >= period_ms )
+      {
+         sensors.fill(state.edit(), now);
+         state.publish();
+         last_snapshot = now;
+      }
+      publish_changes(server, now);
+      if ( (now - boot_ms) / 1000U >= next_history )
+      {
+         record_history(state.current(), next_history);
+         next_history += HISTORY_PERIOD_S;
+      }
+      if ( idle_us > 0 )
+         std::this_thread::sleep_for(std::chrono::microseconds(idle_us));
+   }
+
+   const SSW::HttpStats& st = server.stats();
+   printf("sensor_server: accepted %u requests %u not_found %u bad_requests %u timeouts %u dropped %u\n",
+      st.accepted, st.requests, st.not_found, st.bad_requests, st.timeouts, st.dropped);
+   return 0;
+}
@@ -0,0 +1,198 @@
+// SSW::Hysteresis and SSW::ControllerTable with mock sensors and
+// outputs, at the sketch's lamp and soil moisture settings.
+#include <vector>
+
+#include "hysteresis.h"
+#include "check.h"
+
+// Readings are set by the test; 'valid' false means no reading yet.
+struct MockSensor
+{
+   using value_type = int32_t;
+   int32_t value {0};
+   bool valid {true};
+   bool read(int32_t& v)
+   {
+      v = value;
+      return valid;
+   }
+};
+
+// Records every write, as a GPIO would see it.
+struct MockOutput
+{
+   std::vector<bool> writes;
+   void write(bool on) { writes.push_back(on); }
+   bool on() const { return !writes.empty() && writes.back(); }
+};
+
+// The sketch's values, from web_server_kit.ino
+static const int32_t DUSK = 22000;
+static const int32_t DRY = 12000;
+static const uint32_t RELAY_DWELL_MS = 5000;
+
+using Lamp = SSW::Hysteresis<MockSensor, MockOutput, SSW::ActiveBelow>;
+using Soil = SSW::Hysteresis<MockSensor, MockOutput, SSW::ActiveAbove>;
+
+/// @brief Feeds 'values' one per 'step_ms' from 't0', updating each time.
+template <typename C>
+static uint32_t feed(C& c, MockSensor& s, const std::vector<int32_t>& values, uint32_t t0,
+                     uint32_t step_ms = 1000)
+{
+   uint32_t t = t0;
+   for ( int32_t v : values )
+   {
+      s.value = v;
+      c.update(t);
+      t += step_ms;
+   }
+   return t;
+}
+
+static void test_lamp_band()
+{
+   MockSensor light;
+   MockOutput relay;
+   Lamp lamp(light, relay, {DUSK, DUSK / 100, RELAY_DWELL_MS, RELAY_DWELL_MS});
+
+   // Inside the band nothing happens, however long it is held
+   uint32_t t = feed(lamp, light, {30000, DUSK, DUSK - 220, DUSK + 220, DUSK}, 10000);
+   CHECK(relay.writes.empty());
+
+   // Below the band: on, written once
+   t = feed(lamp, light, {DUSK - 221, DUSK - 500, DUSK - 221}, t);
+   CHECK_EQ(relay.writes.size(), 1);
+   CHECK(relay.on());
+
+   // Noise across the set point does not chatter
+   t = feed(lamp, light, {DUSK, DUSK + 200, DUSK - 200, DUSK + 220}, t);
+   CHECK_EQ(relay.writes.size(), 1);
+
+   // Above the band: off
+   t = feed(lamp, light, {DUSK + 221}, t);
+   CHECK_EQ(relay.writes.size(), 2);
+   CHECK(!relay.on());
+   CHECK_EQ(lamp.transitions(), 2);
+}
+
+static void test_soil_band()
+{
+   // The soil band is centred on DRY like the others: on above DRY + h,
+   // off below DRY - h. It used to set at DRY - h and clear at DRY + h,
+   // so a reading near DRY toggled the LED on every pass.
+   MockSensor soil;
+   MockOutput led;
+   Soil monitor(soil, led, {DRY, DRY / 100});
+
+   std::vector<int32_t> near;
+   for ( int i = 0; i < 50; ++i )
+      near.push_back(DRY + (i % 2 == 0 ? -100 : 100));
+   uint32_t t = feed(monitor, soil, near, 0);
+   CHECK(led.writes.empty());
+
+   t = feed(monitor, soil, {DRY + 121}, t);
+   CHECK(led.on());
+   t = feed(monitor, soil, near, t);
+   CHECK_EQ(led.writes.size(), 1);
+   t = feed(monitor, soil, {DRY - 121}, t);
+   CHECK(!led.on());
+   CHECK_EQ(led.writes.size(), 2);
+}
+
+static void test_dwell()
+{
+   MockSensor light;
+   MockOutput relay;
+   Lamp lamp(light, relay, {DUSK, DUSK / 100, RELAY_DWELL_MS, RELAY_DWELL_MS});
+
+   // The dwell counts from startup, so the first turn-on waits too
+   light.value = 0;
+   CHECK(!lamp.update(4999));
+   CHECK(lamp.update(5000));
+
+   // A flash of light does not turn the lamp off before its dwell ...
+   light.value = 30000;
+   CHECK(!lamp.update(6000));
+   CHECK(!lamp.update(9999));
+   CHECK(lamp.on());
+   // ... and if the light goes away again in time, nothing is written
+   light.value = 0;
+   CHECK(!lamp.update(9999));
+   CHECK_EQ(relay.writes.size(), 1);
+
+   light.value = 30000;
+   CHECK(lamp.update(10000));
+   light.value = 0;
+   CHECK(!lamp.update(14999));
+   CHECK(lamp.update(15000));
+   CHECK_EQ(relay.writes.size(), 3);
+}
+
+static void test_min_cycle_and_no_reading()
+{
+   MockSensor s;
+   MockOutput out;
+   SSW::HysteresisConfig<int32_t> cfg {100, 10};
+   cfg.min_cycle_ms = 60000;
+   Soil c(s, out, cfg);
+
+   s.value = 200;
+   CHECK(c.update(0));
+   s.value = 0;
+   CHECK(c.update(1000));
+   s.value = 200;
+   CHECK(!c.update(59999)); // Too soon after the last turn-on
+   CHECK(c.update(60000));
+
+   // No reading: the output is left alone
+   s.valid = false;
+   s.value = 0;
+   CHECK(!c.update(120000));
+   CHECK(c.on());
+   s.valid = true;
+   CHECK(c.update(120000));
+   CHECK(!c.on());
+}
+
+static void test_wrap()
+{
+   // Dwell times across the millis() wrap
+   MockSensor light;
+   MockOutput relay;
+   Lamp lamp(light, relay, {DUSK, DUSK / 100, RELAY_DWELL_MS, RELAY_DWELL_MS});
+   light.value = 0;
+   const uint32_t t0 = UINT32_MAX - 2000;
+   CHECK(lamp.update(t0));
+   light.value = 30000;
+   CHECK(!lamp.update(t0 + RELAY_DWELL_MS - 1));
+   CHECK(lamp.update(t0 + RELAY_DWELL_MS));
+}
+
+static void test_table()
+{
+   MockSensor light, soil;
+   MockOutput relay, led;
+   Lamp lamp(light, relay, {DUSK, DUSK / 100, RELAY_DWELL_MS, RELAY_DWELL_MS});
+   Soil monitor(soil, led, {DRY, DRY / 100});
+   SSW::ControllerTable<Lamp, Soil> table(lamp, monitor);
+   CHECK_EQ(table.size(), 2);
+
+   light.value = 0;
+   soil.value = 20000;
+   CHECK_EQ(table.update(0), 1); // The lamp waits for its dwell
+   CHECK_EQ(table.update(RELAY_DWELL_MS), 1);
+   CHECK_EQ(table.update(RELAY_DWELL_MS + 1000), 0);
+   CHECK(relay.on());
+   CHECK(led.on());
+}
+
+int main()
+{
+   test_lamp_band();
+   test_soil_band();
+   test_dwell();
+   test_min_cycle_and_no_reading();
+   test_wrap();
+   test_table();
+   return check_result("hysteresis_test");
+}
@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""Embeds static web assets in the sketch as precompressed PROGMEM arrays.
+
+Every file under the assets directory is gzip-compressed and written to a
+C++ header as a PROGMEM array, together with a table of SSW::Asset entries
+(see asset_store.h) giving its path, content type, compressed length and
+ETag. The output only changes when an asset does: compression is
+deterministic and the ETag is an FNV-1a hash of the compressed bytes.
+
+The Arduino IDE has no pre-build step, so run this after editing an asset
+and commit the regenerated header:
+
+    python3 tools/make_assets.py
+"""
+
+import argparse
+import gzip
+import os
+import re
+import sys
+
+# Content type and whether the browser may keep the file without asking.
+# Pages are never cached; the rest are unless --max-age is 0.
+CONTENT_TYPES = {
+    ".html": ("text/html", False),
+    ".css": ("text/css", True),
+    ".js": ("text/javascript", True),
+    ".png": ("image/png", True),
+    ".gif": ("image/gif", True),
+    ".jpg": ("image/jpeg", True),
+    ".jpeg": ("image/jpeg", True),
+    ".svg": ("image/svg+xml", True),
+    ".ico": ("image/x-icon", True),
+    ".json": ("application/json", True),
+}
+
+
+def fnv1a(data):
+    """32-bit FNV-1a, as SSW::fnv1a()."""
+    h = 2166136261
+    for b in data:
+        h ^= b
+        h = (h * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def symbol(path):
+    """ASSET_ name for a request path, e.g. /app.js -> ASSET_APP_JS."""
+    return "ASSET_" + re.sub(r"[^0-9A-Za-z]", "_", path.strip("/")).upper()
+
+
+def collect(root):
+    """Yields (request path, file path) for every file under root, sorted."""
+    for dirpath, dirnames, filenames in os.walk(root):
+        dirnames.sort()
+        for name in sorted(filenames):
+            if name.startswith("."):
+                continue
+            full = os.path.join(dirpath, name)
+            rel = os.path.relpath(full, root).replace(os.sep, "/")
+            yield "/" + rel, full
+
+
+def c_array(data):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append("  " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+    return "\n".join(lines)
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--assets", default=os.path.join(here, "..", "assets"),
+                        help="directory of files to embed")
+    parser.add_argument("--output", default=os.path.join(here, "..", "web_server_kit", "assets.h"),
+                        help="header to write")
+    parser.add_argument("--max-age", type=int, default=0,
+                        help="seconds cacheable assets may be reused without revalidating; "
+                             "0 revalidates every time, which costs a 304")
+    args = parser.parse_args()
+
+    out = [
+        "// Generated by tools/make_assets.py from assets/. Do not edit;",
+        "// change the assets and run the script again.",
+        "#pragma once",
+        "",
+        '#include "asset_store.h"',
+        "",
+    ]
+    table = []
+    total_raw = total_gz = 0
+    for path, full in collect(args.assets):
+        ext = os.path.splitext(path)[1].lower()
+        if ext not in CONTENT_TYPES:
+            sys.exit("make_assets: no content type for %s" % path)
+        content_type, cacheable = CONTENT_TYPES[ext]
+        with open(full, "rb") as f:
+            raw = f.read()
+        gz = gzip.compress(raw, compresslevel=9, mtime=0)
+        etag = '\\"%08x\\"' % fnv1a(gz)
+        cache = "max-age=%d" % args.max_age if cacheable and args.max_age > 0 else "no-cache"
+        name = symbol(path)
+
+        out.append("// %s: %u bytes, %u gzipped" % (path, len(raw), len(gz)))
+        out.append("static const uint8_t %s[] PROGMEM = {" % name)
+        out.append(c_array(gz))
+        out.append("};")
+        out.append("")
+        table.append('  { "%s", "%s", %s, %u, %u, "%s", "%s" },'
+                     % (path, content_type, name, len(gz), len(raw), etag, cache))
+        total_raw += len(raw)
+        total_gz += len(gz)
+
+    if not table:
+        sys.exit("make_assets: no assets in %s" % args.assets)
+
+    out.append("static const SSW::Asset ASSETS[] = {")
+    out.extend(table)
+    out.append("};")
+    out.append("")
+
+    text = "\n".join(out)
+    try:
+        with open(args.output) as f:
+            if f.read() == text:
+                return
+    except OSError:
+        pass
+    with open(args.output, "w") as f:
+        f.write(text)
+    print("make_assets: %d assets, %u bytes, %u gzipped -> %s"
+          % (len(table), total_raw, total_gz, os.path.relpath(args.output)))
+
+
+if __name__ == "__main__":
+    main()
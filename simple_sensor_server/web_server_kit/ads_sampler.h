@@ -0,0 +1,199 @@
+// Interrupt-paced ADS1115 sampling.
+//
+// The ADS1115 runs in continuous-conversion mode with its ALERT/RDY pin
+// configured as a conversion-ready signal (the Adafruit_ADS1X15 v2
+// library does this in startADCReading()). Each falling edge on the pin
+// means a new result is waiting. The interrupt handler only counts the
+// edge; service() reads the result from loop(), stores it for the
+// current channel and switches the multiplexer to the next enabled
+// channel, so the channels are sampled round-robin at the data rate.
+//
+// Without an ALERT/RDY pin (NO_RDY_PIN), or if RDY_FALLBACK_TIMEOUTS
+// restarts in a row see no edge because the pin is not wired, the
+// sampler polls instead: it reads each result one conversion period
+// after starting it.
+//
+// Readers get the latest value, or the mean of the recent history, from
+// RAM without any I2C traffic.
+#pragma once
+
+#include <Arduino.h>
+#include <Adafruit_ADS1X15.h>
+
+#include "time_series.h"
+
+class AdsSampler
+{
+public:
+   static constexpr uint8_t CHANNELS = 4;
+   static constexpr size_t HISTORY = 16;           // Recent samples kept per channel
+   static constexpr uint32_t RDY_TIMEOUT_MS = 100; // Restart if the pin goes quiet this long
+   static constexpr uint32_t RDY_FALLBACK_TIMEOUTS = 5; // Consecutive timeouts before polling
+   static constexpr uint8_t NO_RDY_PIN = 0xFF;     // ALERT/RDY is not connected: poll
+
+   // adc: The ADS1115, already configured for gain
+   // rdy_pin: GPIO connected to ALERT/RDY, or NO_RDY_PIN. Needs a
+   //    pull-up. Avoid the boot strapping pins (D3, D4 and D8 on a
+   //    NodeMCU): the ADS1115 can hold the line low while the ESP8266
+   //    resets.
+   // channel_mask: Bit n enables AIN n
+   // rate: ADS1115 data rate, e.g. RATE_ADS1115_128SPS
+   AdsSampler(Adafruit_ADS1115& adc, uint8_t rdy_pin, uint8_t channel_mask, uint16_t rate = RATE_ADS1115_128SPS) :
+      _adc(adc),
+      _rdy_pin(rdy_pin),
+      _mask(channel_mask & 0x0F),
+      _rate(rate)
+   {}
+
+   // Attaches the interrupt, if there is a pin, and starts converting
+   // the first channel.
+   void begin()
+   {
+      if ( _mask == 0 )
+         return;
+      if ( _rdy_pin == NO_RDY_PIN )
+      {
+         _polled = true;
+      }
+      else
+      {
+         _instance = this;
+         pinMode(_rdy_pin, INPUT_PULLUP);
+         attachInterrupt(digitalPinToInterrupt(_rdy_pin), _rdy_isr, FALLING);
+      }
+      _adc.setDataRate(_rate);
+      _period_ms = _conversion_ms(_rate);
+      _channel = CHANNELS - 1;
+      _next_channel();
+      _start(millis());
+   } // begin()
+
+   // Collects a waiting result and moves on to the next channel. Call
+   // from loop(). At most one I2C read and one configuration write per
+   // call.
+   void service()
+   {
+      if ( _mask == 0 )
+         return;
+
+      const uint32_t now = millis();
+      if ( _polled )
+      {
+         // No RDY: a result is waiting one conversion period after the start.
+         if ( now - _started_ms < _period_ms )
+            return;
+      }
+      else
+      {
+         const uint32_t ready = _ready;
+         if ( ready == _handled )
+         {
+            // A missed edge would stall the sampler; restart the conversion.
+            if ( now - _started_ms > RDY_TIMEOUT_MS )
+            {
+               ++_timeouts;
+               if ( ++_quiet_restarts >= RDY_FALLBACK_TIMEOUTS )
+               {
+                  detachInterrupt(digitalPinToInterrupt(_rdy_pin));
+                  _polled = true;
+               }
+               _start(now);
+            }
+            return;
+         }
+         _handled = ready;
+         _quiet_restarts = 0;
+      }
+
+      Channel& c = _channels[_channel];
+      c.latest = _adc.getLastConversionResults();
+      c.history.push(c.latest);
+      ++c.seq;
+
+      _next_channel();
+      _start(now);
+   } // service()
+
+   // The latest sample of AIN ch.
+   int16_t latest(uint8_t ch) const { return ch < CHANNELS ? _channels[ch].latest : 0; }
+
+   // Mean of the recent samples of AIN ch.
+   int16_t mean(uint8_t ch) const
+   {
+      if ( ch >= CHANNELS || _channels[ch].history.empty() )
+         return 0;
+      const auto& h = _channels[ch].history;
+      int32_t sum = 0;
+      for ( size_t i = 0; i < h.size(); ++i )
+         sum += h[i];
+      return static_cast<int16_t>(sum / static_cast<int32_t>(h.size()));
+   } // mean()
+
+   // Increments with each sample of AIN ch. 0 until the first sample.
+   uint32_t sequence(uint8_t ch) const { return ch < CHANNELS ? _channels[ch].seq : 0U; }
+
+   bool available(uint8_t ch) const { return sequence(ch) != 0; }
+
+   // Number of times the conversion had to be restarted.
+   uint32_t timeouts() const { return _timeouts; }
+
+   // True if the sampler polls on a timer: there is no ALERT/RDY pin, or
+   // it has given up on it.
+   bool polled() const { return _polled; }
+
+private:
+   struct Channel
+   {
+      int16_t  latest {0};
+      uint32_t seq {0};
+      SSW::RingBuffer<int16_t, HISTORY> history;
+   };
+
+   static void IRAM_ATTR _rdy_isr()
+   {
+      if ( _instance != nullptr )
+         _instance->_ready = _instance->_ready + 1;
+   } // _rdy_isr()
+
+   // One conversion period for an ADS1115 data rate setting, rounded up,
+   // plus a millisecond for the oscillator's tolerance.
+   static uint32_t _conversion_ms(uint16_t rate)
+   {
+      static const uint16_t SPS[] = {8, 16, 32, 64, 128, 250, 475, 860};
+      const uint16_t sps = SPS[(rate >> 5) & 0x07];
+      return (1000U + sps - 1) / sps + 1;
+   } // _conversion_ms()
+
+   void _next_channel()
+   {
+      do
+      {
+         _channel = (_channel + 1) % CHANNELS;
+      } while ( !(_mask & (1U << _channel)) );
+   } // _next_channel()
+
+   void _start(uint32_t now)
+   {
+      // Writing the configuration restarts the conversion, so the next
+      // RDY edge carries a result from the new channel.
+      _adc.startADCReading(MUX_BY_CHANNEL[_channel], /*continuous=*/true);
+      _started_ms = now;
+      _handled = _ready;
+   } // _start()
+
+   inline static AdsSampler* _instance = nullptr;
+
+   Adafruit_ADS1115& _adc;
+   uint8_t  _rdy_pin;
+   uint8_t  _mask;
+   uint16_t _rate;
+   uint8_t  _channel {0};         // Channel being converted
+   volatile uint32_t _ready {0};  // RDY edges, counted by the ISR
+   uint32_t _handled {0};         // RDY edges consumed by service()
+   uint32_t _started_ms {0};      // When the current channel was started
+   uint32_t _timeouts {0};
+   uint32_t _quiet_restarts {0};  // Timeouts since the last RDY edge
+   uint32_t _period_ms {8};       // Conversion period at _rate
+   bool     _polled {false};      // Reading on a timer instead of RDY
+   Channel  _channels[CHANNELS];
+}; // class AdsSampler
@@ -0,0 +1,64 @@
+/////////////////////////////////////////////////////////////////////
+/// Precompressed static assets
+///
+/// tools/make_assets.py gzips the files in assets/ at build time and
+/// writes assets.h: one PROGMEM array per file plus a table of SSW::Asset
+/// entries with the compressed length and an ETag computed from the
+/// contents. Nothing is compressed, hashed or measured on the device.
+///
+/// serve_asset() answers a request from the table: the body goes out
+/// straight from flash with Content-Encoding: gzip, and a request whose
+/// If-None-Match names the current ETag gets 304 Not Modified.
+/////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "http_server.h"
+
+namespace SSW
+{
+
+/// @brief One embedded file.
+struct Asset
+{
+  const char*    path;          ///< Request path, e.g. "/app.js"
+  const char*    content_type;
+  const uint8_t* data;          ///< Gzip-compressed contents, PROGMEM
+  uint32_t       len;           ///< Compressed length
+  uint32_t       raw_len;       ///< Uncompressed length, for diagnostics
+  const char*    etag;          ///< Quoted ETag
+  const char*    cache_control; ///< Cache-Control header value
+}; // struct Asset
+
+/// @brief Looks up an asset by request path.
+/// @return The asset, or nullptr
+template <size_t N>
+const Asset* find_asset(const Asset (&table)[N], const char* path)
+{
+  for ( const Asset& a : table )
+    if ( strcmp(a.path, path) == 0 )
+      return &a;
+  return nullptr;
+} // find_asset()
+
+/// @brief Responds with an asset, or 304 if the client already has it.
+/// Every browser accepts gzip; a client that does not still gets the
+/// compressed bytes, labelled as such.
+inline void serve_asset(const Asset& a, const HttpRequest& req, HttpResponse& res)
+{
+  res.header("ETag", a.etag);
+  res.header("Cache-Control", a.cache_control);
+  res.header("Vary", "Accept-Encoding");
+  if ( strstr(req.if_none_match, a.etag) != nullptr )
+  {
+    res.not_modified();
+    return;
+  }
+  res.header("Content-Encoding", "gzip");
+  res.send(200, a.content_type, reinterpret_cast<const char*>(a.data), a.len, true);
+} // serve_asset()
+
+} // namespace SSW
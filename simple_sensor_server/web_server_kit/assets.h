@@ -0,0 +1,40 @@
+// Generated by tools/make_assets.py from assets/. Do not edit;
+// change the assets and run the script again.
+#pragma once
+
+#include "asset_store.h"
+
+// /app.js: 768 bytes, 419 gzipped
+static const uint8_t ASSET_APP_JS[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x6d, 0x51, 0xc1, 0x6a, 0x1b, 0x31,
+  0x10, 0xbd, 0xfb, 0x2b, 0x1e, 0xba, 0x64, 0x97, 0x2e, 0x5a, 0xea, 0x63, 0x4d, 0x28, 0xb4, 0xb5,
+  0xa1, 0x6d, 0x48, 0xa0, 0xe9, 0xa5, 0xa7, 0x20, 0x56, 0xb3, 0x5e, 0xc1, 0x5a, 0x32, 0xd2, 0xec,
+  0x26, 0x26, 0xe4, 0xdf, 0x3b, 0x52, 0x62, 0xbb, 0x6e, 0x7b, 0x91, 0x34, 0xa3, 0xf7, 0xde, 0xcc,
+  0x9b, 0x69, 0x5b, 0xdc, 0xb8, 0x99, 0x30, 0xed, 0xad, 0x61, 0x4a, 0xe8, 0x43, 0x04, 0x0f, 0x84,
+  0x18, 0x02, 0x63, 0x6f, 0xb6, 0xa4, 0xf1, 0x53, 0xc2, 0xde, 0xc5, 0xc4, 0xb8, 0x4a, 0x2c, 0xa0,
+  0x2b, 0xd0, 0x4c, 0x9e, 0xd1, 0x99, 0x18, 0x9d, 0x50, 0x04, 0xbe, 0x68, 0x5b, 0x3c, 0x0e, 0x61,
+  0x24, 0x14, 0xc4, 0x0a, 0xa3, 0x9c, 0x11, 0xc1, 0xcb, 0x77, 0xf0, 0xe3, 0xa1, 0x48, 0xf6, 0x8e,
+  0x46, 0x9b, 0xe1, 0x46, 0xb8, 0x83, 0xf1, 0x5b, 0xb2, 0x7a, 0xd1, 0x4f, 0xbe, 0x63, 0x17, 0x3c,
+  0x12, 0x71, 0xe5, 0x6c, 0x83, 0xb9, 0xc6, 0x33, 0x66, 0x13, 0x41, 0xb8, 0x86, 0x0d, 0xdd, 0xb4,
+  0x93, 0x5a, 0x7a, 0x4b, 0xbc, 0x1e, 0x29, 0x3f, 0x3f, 0x1d, 0xbe, 0x5a, 0x01, 0xd6, 0x2b, 0xb8,
+  0x1e, 0x15, 0xd5, 0x20, 0xcd, 0xf4, 0xc4, 0x9f, 0x83, 0xe7, 0xdc, 0xd4, 0x35, 0xe6, 0x15, 0x5e,
+  0xce, 0xb2, 0xc1, 0x87, 0xbe, 0xaf, 0x8a, 0x68, 0x24, 0x9e, 0xa2, 0xc7, 0x8c, 0x8f, 0x50, 0x77,
+  0xb7, 0x0a, 0x1f, 0xe4, 0xda, 0x6c, 0x54, 0x86, 0x97, 0x7a, 0x49, 0xc8, 0x9e, 0x1e, 0xb1, 0xce,
+  0xee, 0xee, 0xc3, 0x14, 0x3b, 0xaa, 0x54, 0x5b, 0xbc, 0x26, 0x55, 0xaf, 0x16, 0x94, 0xb4, 0xb1,
+  0xb6, 0xfc, 0xde, 0xb8, 0x24, 0xd5, 0x28, 0x56, 0xaa, 0xf8, 0x55, 0x0d, 0x8e, 0x05, 0x73, 0x47,
+  0xcf, 0x0b, 0x14, 0x07, 0x59, 0xf0, 0xdb, 0xfd, 0xdd, 0xad, 0xde, 0x9b, 0x98, 0xa8, 0x22, 0x2d,
+  0x23, 0x36, 0x22, 0x84, 0xd2, 0xba, 0x62, 0xda, 0xed, 0x93, 0x82, 0x13, 0xef, 0x35, 0x92, 0x2e,
+  0xa1, 0x96, 0xf9, 0xaf, 0x4d, 0x37, 0x54, 0x27, 0x3d, 0x6e, 0xe0, 0x72, 0xf7, 0x79, 0x3e, 0x8a,
+  0x15, 0xde, 0xc1, 0x35, 0x60, 0xcd, 0x61, 0xe3, 0x9e, 0xc8, 0x56, 0xcb, 0x5a, 0x26, 0xf1, 0x72,
+  0x16, 0x9d, 0xbb, 0xee, 0x24, 0x99, 0x19, 0x39, 0x6e, 0x44, 0x5d, 0xee, 0x0b, 0xce, 0x11, 0x3f,
+  0xba, 0xed, 0xc0, 0x17, 0x8c, 0xd7, 0x4c, 0xe6, 0x94, 0xd7, 0x19, 0xba, 0x0b, 0xe2, 0x7a, 0x8a,
+  0x74, 0x81, 0x3e, 0x25, 0x33, 0xe1, 0x18, 0x9c, 0x39, 0x91, 0x46, 0x73, 0x78, 0x78, 0x7f, 0x41,
+  0x39, 0xe6, 0x9a, 0xb7, 0xe5, 0x24, 0xfd, 0x96, 0xa9, 0xff, 0xe6, 0x2d, 0xff, 0xc3, 0x5b, 0xfe,
+  0xc3, 0xfb, 0xd3, 0x8e, 0x8d, 0x87, 0x0b, 0x4e, 0x8e, 0x73, 0x67, 0x72, 0xe7, 0xb5, 0x7f, 0xf9,
+  0xf1, 0xeb, 0x75, 0xef, 0xdf, 0xf3, 0x42, 0xf3, 0xd8, 0x7e, 0x03, 0x64, 0x77, 0xaf, 0x2e, 0x00,
+  0x03, 0x00, 0x00,
+};
+
+static const SSW::Asset ASSETS[] = {
+  { "/app.js", "text/javascript", ASSET_APP_JS, 419, 768, "\"021a355c\"", "no-cache" },
+};
@@ -0,0 +1,245 @@
+/////////////////////////////////////////////////////////////////////
+/// Sensor history over HTTP
+///
+/// Serves a TimeSeries as /api/history?sensor=..&from=..&to=..&res=..
+/// The records are read straight out of the ring buffers as the socket
+/// drains: each fill of the connection's output buffer runs a query()
+/// from where the last one stopped, so a day of data goes out in one
+/// response without ever being copied into a RAM buffer of its own.
+///
+/// Query parameters:
+///   sensor  Chosen by the application
+///   from    Start time, seconds. Negative means relative to the newest
+///           sample. Default: one day before 'to'.
+///   to      End time (exclusive), seconds. Negative as for 'from'.
+///           Default: just after the newest sample.
+///   res     raw, minute, hour or auto (default). auto picks the finest
+///           tier that still covers 'from' within max_records records.
+///   format  csv (default) or bin
+///
+/// CSV has a header line and one 't,mean,min,max,count' line per record,
+/// values in the series' units. Binary is a HistoryHeader followed by
+/// packed TSRecords, little-endian, values fixed point (divide by scale).
+/// The chosen tier is also returned in an X-Resolution header.
+/////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "http_server.h"
+#include "time_series.h"
+
+namespace SSW
+{
+
+static constexpr uint8_t HISTORY_VERSION = 1;
+static constexpr uint32_t HISTORY_DEFAULT_SPAN_S = 86400U; ///< A day
+static constexpr size_t HISTORY_MAX_RECORDS = 2000U;       ///< Default record limit for res=auto
+
+enum class HistoryFormat : uint8_t
+{
+  Csv,
+  Binary
+}; // enum class HistoryFormat
+
+/// @brief Start of a binary history response.
+struct HistoryHeader
+{
+  char     magic[4];  ///< "SSWH"
+  uint8_t  version;   ///< HISTORY_VERSION
+  uint8_t  tier;      ///< TSTier
+  uint16_t scale;     ///< Fixed-point scale of the values
+  uint32_t from;      ///< Requested range, seconds
+  uint32_t to;
+}; // struct HistoryHeader
+static_assert(sizeof(HistoryHeader) == 16, "HistoryHeader must not contain padding");
+static_assert(sizeof(TSRecord) == 12, "TSRecord must not contain padding");
+
+/// @brief A parsed history request.
+struct HistoryParams
+{
+  char          sensor[16] {};
+  uint32_t      from {0};
+  uint32_t      to {0};
+  bool          auto_tier {true};
+  TSTier        tier {TSTier::Raw};
+  HistoryFormat format {HistoryFormat::Csv};
+}; // struct HistoryParams
+
+inline const char* tier_name(TSTier tier)
+{
+  switch ( tier )
+  {
+    case TSTier::Raw: return "raw";
+    case TSTier::Minute: return "minute";
+    case TSTier::Hour:
+    default: return "hour";
+  }
+} // tier_name()
+
+/// @brief Reads the query parameters.
+/// @param now: Time of the newest sample, for relative and default times
+/// @return false if a parameter is malformed
+inline bool parse_history_params(const HttpRequest& req, uint32_t now, HistoryParams& p)
+{
+  char v[16];
+  req.param("sensor", p.sensor, sizeof(p.sensor));
+
+  auto time_param = [&](const char* name, uint32_t fallback, uint32_t& out)
+  {
+    if ( !req.param(name, v, sizeof(v)) )
+    {
+      out = fallback;
+      return true;
+    }
+    char* end = nullptr;
+    long long t = strtoll(v, &end, 10);
+    if ( end == v || *end != '\0' )
+      return false;
+    if ( t < 0 )
+      t += static_cast<long long>(now) + 1;
+    out = t < 0 ? 0U : ( t > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(t) );
+    return true;
+  };
+  if ( !time_param("to", now + 1, p.to) )
+    return false;
+  if ( !time_param("from", p.to > HISTORY_DEFAULT_SPAN_S ? p.to - HISTORY_DEFAULT_SPAN_S : 0, p.from) )
+    return false;
+
+  p.auto_tier = true;
+  if ( req.param("res", v, sizeof(v)) && strcmp(v, "auto") != 0 )
+  {
+    p.auto_tier = false;
+    if ( strcmp(v, "raw") == 0 )
+      p.tier = TSTier::Raw;
+    else if ( strcmp(v, "minute") == 0 )
+      p.tier = TSTier::Minute;
+    else if ( strcmp(v, "hour") == 0 )
+      p.tier = TSTier::Hour;
+    else
+      return false;
+  }
+
+  p.format = HistoryFormat::Csv;
+  if ( req.param("format", v, sizeof(v)) )
+  {
+    if ( strcmp(v, "bin") == 0 )
+      p.format = HistoryFormat::Binary;
+    else if ( strcmp(v, "csv") != 0 )
+      return false;
+  }
+  return true;
+} // parse_history_params()
+
+/// @brief Where a history response has got to. Lives in the connection.
+template <typename Series>
+struct HistoryCursor
+{
+  const Series* series;
+  uint32_t      next;     ///< Time of the next record to send
+  uint32_t      from;
+  uint32_t      to;
+  TSTier        tier;
+  HistoryFormat format;
+  bool          started;  ///< Header sent
+}; // struct HistoryCursor
+
+/// @brief Formats a fixed-point value in the series' units.
+inline int format_fixed(char* buf, size_t len, int16_t v, uint16_t scale)
+{
+  if ( scale <= 1 )
+    return snprintf(buf, len, "%d", v);
+  unsigned decimals = 0;
+  for ( uint32_t s = scale; s > 1 && s % 10 == 0; s /= 10 )
+    ++decimals;
+  uint32_t pow10 = 1;
+  for ( unsigned i = 0; i < decimals; ++i )
+    pow10 *= 10;
+  if ( pow10 != scale )
+    return snprintf(buf, len, "%.3f", static_cast<double>(v) / scale);
+  const uint32_t mag = v < 0 ? static_cast<uint32_t>(-static_cast<int32_t>(v)) : static_cast<uint32_t>(v);
+  return snprintf(buf, len, "%s%u.%0*u", v < 0 ? "-" : "", static_cast<unsigned>(mag / scale),
+    static_cast<int>(decimals), static_cast<unsigned>(mag % scale));
+} // format_fixed()
+
+/// @brief HttpProducer for a HistoryCursor<Series>.
+template <typename Series>
+size_t history_producer(void* ctx, char* buf, size_t cap, bool& done)
+{
+  static constexpr size_t CSV_LINE_MAX = 48; // "4294967295,-3276.8,-3276.8,-3276.8,65535\n" and then some
+  HistoryCursor<Series>& cur = *static_cast<HistoryCursor<Series>*>(ctx);
+  const uint16_t scale = cur.series->scale();
+  size_t n = 0;
+
+  if ( !cur.started )
+  {
+    if ( cur.format == HistoryFormat::Binary )
+    {
+      HistoryHeader h {{'S', 'S', 'W', 'H'}, HISTORY_VERSION, static_cast<uint8_t>(cur.tier), scale, cur.from, cur.to};
+      memcpy(buf, &h, sizeof(h));
+      n = sizeof(h);
+    }
+    else
+      n = static_cast<size_t>(snprintf(buf, cap, "t,mean,min,max,count\n"));
+    cur.started = true;
+  }
+
+  const size_t record_max = cur.format == HistoryFormat::Binary ? sizeof(TSRecord) : CSV_LINE_MAX;
+  bool full = false;
+  cur.series->query(cur.tier, cur.next, cur.to, [&](const TSRecord& r)
+  {
+    if ( cap - n < record_max )
+    {
+      full = true;
+      return false;
+    }
+    if ( cur.format == HistoryFormat::Binary )
+    {
+      memcpy(buf + n, &r, sizeof(r));
+      n += sizeof(r);
+    }
+    else
+    {
+      char* p = buf + n;
+      char* end = buf + cap;
+      p += snprintf(p, end - p, "%u,", static_cast<unsigned>(r.t));
+      p += format_fixed(p, end - p, r.mean, scale);
+      *p++ = ',';
+      p += format_fixed(p, end - p, r.min, scale);
+      *p++ = ',';
+      p += format_fixed(p, end - p, r.max, scale);
+      p += snprintf(p, end - p, ",%u\n", static_cast<unsigned>(r.count));
+      n = static_cast<size_t>(p - buf);
+    }
+    // Resume after this record. Raw samples sharing a time with the last
+    // one sent are skipped if a buffer boundary falls between them.
+    cur.next = r.t + 1;
+    return true;
+  });
+  done = !full;
+  return n;
+} // history_producer()
+
+/// @brief Responds with the requested range of a series.
+template <typename Series>
+void send_history(const Series& series, const HistoryParams& p, HttpResponse& res,
+  size_t max_records = HISTORY_MAX_RECORDS)
+{
+  HistoryCursor<Series> cur {&series, p.from, p.from, p.to,
+    p.auto_tier ? series.select_tier(p.from, p.to, max_records) : p.tier, p.format, false};
+  static_assert(sizeof(cur) <= HTTP_STREAM_CONTEXT, "HistoryCursor does not fit the connection");
+
+  char count[12];
+  snprintf(count, sizeof(count), "%u", static_cast<unsigned>(series.count(cur.tier, p.from, p.to)));
+  res.header("X-Resolution", tier_name(cur.tier));
+  res.header("X-Records", count);
+  res.header("Cache-Control", "no-cache");
+  res.send_stream(200, p.format == HistoryFormat::Binary ? "application/octet-stream" : "text/csv",
+    &history_producer<Series>, &cur, sizeof(cur));
+} // send_history()
+
+} // namespace SSW
@@ -0,0 +1,65 @@
+/////////////////////////////////////////////////////////////////////
+/// ESP8266 backend for SSW::HttpServer
+///
+/// Wraps WiFiServer and WiFiClient. WiFiClient::write() blocks until
+/// the data is sent, so send() never offers more than
+/// availableForWrite() will take.
+/////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <ESP8266WiFi.h>
+
+namespace SSW
+{
+
+class Esp8266Backend
+{
+public:
+  using Socket = WiFiClient;
+
+  explicit Esp8266Backend(uint16_t port) : _server(port) {}
+
+  void begin()
+  {
+    _server.begin();
+    _server.setNoDelay(true);
+  } // begin()
+
+  bool accept(Socket& s)
+  {
+    WiFiClient client = _server.available();
+    if ( !client )
+      return false;
+    s = client;
+    return true;
+  } // accept()
+
+  static int recv(Socket& s, char* buf, size_t n)
+  {
+    int avail = s.available();
+    if ( avail > 0 )
+      return s.read(reinterpret_cast<uint8_t*>(buf), n < static_cast<size_t>(avail) ? n : static_cast<size_t>(avail));
+    return s.connected() ? 0 : -1;
+  } // recv()
+
+  static int send(Socket& s, const char* buf, size_t n)
+  {
+    if ( !s.connected() )
+      return -1;
+    size_t room = s.availableForWrite();
+    if ( room == 0 )
+      return 0;
+    return static_cast<int>(s.write(reinterpret_cast<const uint8_t*>(buf), n < room ? n : room));
+  } // send()
+
+  static void close(Socket& s)
+  {
+    s.stop();
+    s = WiFiClient();
+  } // close()
+
+private:
+  WiFiServer _server;
+}; // class Esp8266Backend
+
+} // namespace SSW
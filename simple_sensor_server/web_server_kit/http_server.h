@@ -0,0 +1,914 @@
+/////////////////////////////////////////////////////////////////////
+/// Event-driven HTTP server core
+///
+/// SSW::HttpServer serves several clients at once from a fixed pool of
+/// connection slots without ever blocking the caller. poll() accepts new
+/// connections, reads whatever request bytes have arrived, and sends as
+/// much pending response as the sockets will take, then returns. Call it
+/// from loop() (or any event loop) as often as convenient.
+///
+/// Each connection runs a small state machine:
+///
+///   Reading    Collecting the request head (up to IN_BUF bytes)
+///   Writing    Streaming the response from its body source
+///   Streaming  A Server-Sent Events subscriber; stays open
+///
+/// Handlers are plain functions registered per path. They fill in an
+/// HttpResponse, which describes the response rather than sending it:
+/// a memory body (RAM or PROGMEM, sent without copying where the backend
+/// allows), a copied body (small, dynamic), a template streamed with
+/// chunked encoding (see TemplateCursor), or an event stream. Keep-alive
+/// and pipelined requests are supported; only GET and HEAD are.
+///
+/// Backend provides the sockets. It must have:
+///   using Socket = ...;                       Default-constructible, copyable
+///   bool accept(Socket& s);                   Non-blocking; true for a new connection
+///   static int recv(Socket& s, char* buf, size_t n);
+///                                             >0 bytes, 0 nothing yet, <0 closed
+///   static int send(Socket& s, const char* buf, size_t n);
+///                                             >=0 bytes taken, <0 error
+///   static void close(Socket& s);
+///
+/// See http_backend_posix.h (Linux, ESP32) and http_backend_esp8266.h.
+/////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "page_renderer.h"
+
+#if defined(ARDUINO)
+#include <pgmspace.h>
+#else
+#ifndef memcpy_P
+#define memcpy_P memcpy
+#endif
+#endif
+
+#if defined(ARDUINO_ARCH_ESP8266)
+// ESP8266 flash can only be read a word at a time, so PROGMEM bodies are
+// copied through the connection buffer with memcpy_P.
+#define SSW_HTTP_PROGMEM_COPY 1
+#else
+// Elsewhere flash is readable like RAM and PROGMEM bodies are sent in place.
+#define SSW_HTTP_PROGMEM_COPY 0
+#endif
+
+namespace SSW
+{
+
+enum class HttpMethod : uint8_t
+{
+  Get,
+  Head,
+  Other
+}; // enum class HttpMethod
+
+/// @brief A parsed request head. Strings point into the connection's
+/// input buffer and are valid only during the handler call.
+struct HttpRequest
+{
+  HttpMethod  method {HttpMethod::Other};
+  const char* path {""};          ///< Without the query string
+  const char* query {""};         ///< After '?', or empty
+  const char* if_none_match {""}; ///< If-None-Match header value
+  bool        keep_alive {true};
+  bool        accept_gzip {false};
+
+  /// @brief Copies the value of a query parameter.
+  /// @return true if the parameter is present
+  bool param(const char* name, char* out, size_t len) const
+  {
+    const size_t name_len = strlen(name);
+    const char* p = query;
+    while ( *p != '\0' )
+    {
+      const char* end = strchr(p, '&');
+      if ( end == nullptr )
+        end = p + strlen(p);
+      if ( static_cast<size_t>(end - p) > name_len && strncmp(p, name, name_len) == 0 && p[name_len] == '=' )
+      {
+        const char* v = p + name_len + 1;
+        size_t n = static_cast<size_t>(end - v);
+        if ( len == 0 )
+          return true;
+        if ( n >= len )
+          n = len - 1;
+        memcpy(out, v, n);
+        out[n] = '\0';
+        return true;
+      }
+      p = ( *end == '&' ) ? end + 1 : end;
+    }
+    return false;
+  } // param()
+}; // struct HttpRequest
+
+/// @brief How a response body is produced.
+enum class HttpBody : uint8_t
+{
+  None,
+  Memory,    ///< Static memory, RAM or PROGMEM
+  Template,  ///< TemplateCursor, chunked
+  Stream,    ///< HttpProducer, chunked
+  Events     ///< Server-Sent Events, open-ended
+}; // enum class HttpBody
+
+/// @brief Produces a streamed body a buffer at a time.
+/// @param ctx: The connection's copy of the context given to send_stream()
+/// @param buf: Output
+/// @param cap: Size of buf
+/// @param done: Set once the body is complete
+/// @return Bytes written. Returning 0 without setting done ends the body.
+using HttpProducer = size_t (*)(void* ctx, char* buf, size_t cap, bool& done);
+
+/// @brief Room for an HttpProducer's context in each connection.
+static constexpr size_t HTTP_STREAM_CONTEXT = 32;
+
+/// @class HttpResponse
+/// @brief What a handler wants sent. The head is assembled into the
+/// connection's output buffer after the handler returns.
+class HttpResponse
+{
+public:
+  static constexpr size_t HEADERS = 192; ///< Room for extra headers
+
+  /// @brief Adds a header. Ignored if there is no room.
+  void header(const char* name, const char* value)
+  {
+    int n = snprintf(_headers + _headers_len, HEADERS - _headers_len, "%s: %s\r\n", name, value);
+    if ( n > 0 && static_cast<size_t>(n) < HEADERS - _headers_len )
+      _headers_len += static_cast<size_t>(n);
+    else
+      _headers[_headers_len] = '\0';
+  } // header()
+
+  /// @brief Responds with a body in memory that outlives the response
+  /// (a literal, a PROGMEM array, a static buffer).
+  void send(int status, const char* content_type, const char* body, size_t len, bool progmem = false)
+  {
+    _status = status;
+    _content_type = content_type;
+    _body = HttpBody::Memory;
+    _data = body;
+    _len = len;
+    _progmem = progmem;
+  } // send()
+
+  /// @brief Responds with a nul-terminated string literal.
+  void send(int status, const char* content_type, const char* text)
+  {
+    send(status, content_type, text, strlen(text));
+  } // send()
+
+  /// @brief Responds with a small body copied into the connection's
+  /// output buffer, e.g. a snapshot that may change. Falls back to 500
+  /// if it does not fit.
+  void send_copy(int status, const char* content_type, const void* body, size_t len)
+  {
+    _status = status;
+    _content_type = content_type;
+    _body = HttpBody::None;
+    _copy = body;
+    _len = len;
+  } // send_copy()
+
+  /// @brief Responds with a template expanded on the fly (chunked).
+  void send_template(int status, const char* content_type, const char* tmpl, TemplateResolver resolve)
+  {
+    _status = status;
+    _content_type = content_type;
+    _body = HttpBody::Template;
+    _data = tmpl;
+    _resolve = resolve;
+  } // send_template()
+
+  /// @brief Responds with a body generated as the socket drains
+  /// (chunked), e.g. records read straight out of a ring buffer.
+  /// @param ctx: Copied here, so it may be a local of the handler.
+  ///   At most HTTP_STREAM_CONTEXT bytes, trivially copyable.
+  void send_stream(int status, const char* content_type, HttpProducer producer, const void* ctx, size_t len)
+  {
+    if ( len > HTTP_STREAM_CONTEXT )
+    {
+      send(500, "text/plain", "Stream context too large\n");
+      return;
+    }
+    _status = status;
+    _content_type = content_type;
+    _body = HttpBody::Stream;
+    _producer = producer;
+    _copy = nullptr;
+    memcpy(_context, ctx, len);
+  } // send_stream()
+
+  /// @brief Turns the connection into an event stream subscriber.
+  /// @param stream: Identifies the stream for HttpServer::publish()
+  /// @param event: Optional first event for this subscriber alone
+  /// @param data: Its data
+  void send_events(uint8_t stream, const char* event = nullptr, const char* data = nullptr)
+  {
+    _status = 200;
+    _content_type = "text/event-stream";
+    _body = HttpBody::Events;
+    _stream = stream;
+    _data = event;
+    _first_data = data;
+  } // send_events()
+
+  /// @brief 304 with no body, e.g. after an ETag match.
+  void not_modified()
+  {
+    _status = 304;
+    _content_type = nullptr;
+    _body = HttpBody::None;
+    _len = 0;
+  } // not_modified()
+
+private:
+  template <typename, size_t, size_t, size_t, size_t> friend class HttpServer;
+
+  int         _status {404};
+  const char* _content_type {"text/plain"};
+  HttpBody    _body {HttpBody::None};
+  const char* _data {nullptr};
+  const void* _copy {nullptr};
+  const char* _first_data {nullptr};
+  size_t      _len {0};
+  bool        _progmem {false};
+  TemplateResolver _resolve {nullptr};
+  HttpProducer _producer {nullptr};
+  alignas(8) unsigned char _context[HTTP_STREAM_CONTEXT];
+  uint8_t     _stream {0};
+  char        _headers[HEADERS] {};
+  size_t      _headers_len {0};
+}; // class HttpResponse
+
+using HttpHandler = void (*)(const HttpRequest& req, HttpResponse& res);
+
+/// @brief Counters for load testing and diagnostics.
+struct HttpStats
+{
+  uint32_t accepted {0};     ///< Connections accepted
+  uint32_t requests {0};     ///< Requests dispatched
+  uint32_t not_found {0};    ///< 404 responses
+  uint32_t bad_requests {0}; ///< Malformed or oversize requests
+  uint32_t timeouts {0};     ///< Connections closed for inactivity
+  uint32_t dropped {0};      ///< Event subscribers dropped for falling behind
+}; // struct HttpStats
+
+/// @class HttpServer
+/// @param Backend: Socket backend
+/// @param MAX_CONN: Connection slots
+/// @param IN_BUF: Request head buffer per connection
+/// @param OUT_BUF: Response buffer per connection. Also bounds the
+///   backlog of an event subscriber.
+/// @param MAX_ROUTES: Route table size
+template <typename Backend, size_t MAX_CONN = 4, size_t IN_BUF = 512, size_t OUT_BUF = 512, size_t MAX_ROUTES = 8>
+class HttpServer
+{
+  static_assert(OUT_BUF >= 256 && OUT_BUF <= 4095, "OUT_BUF must be 256 - 4095 bytes");
+
+public:
+  static constexpr uint32_t IDLE_TIMEOUT_MS = 5000; ///< Close a quiet non-streaming connection after this
+  static constexpr size_t PLACEHOLDER_RESERVE = 192; ///< Room kept for one template value
+
+  explicit HttpServer(Backend& backend) : _backend(backend) {}
+
+  /// @brief Registers a handler for an exact path. Returns false if the
+  /// route table is full.
+  bool on(const char* path, HttpHandler handler)
+  {
+    if ( _route_count == MAX_ROUTES )
+      return false;
+    _routes[_route_count].path = path;
+    _routes[_route_count].handler = handler;
+    ++_route_count;
+    return true;
+  } // on()
+
+  /// @brief Handles requests that match no route. The response
+  /// defaults to an empty 404.
+  void on_not_found(HttpHandler handler) { _not_found = handler; }
+
+  /// @brief Accepts, reads and writes without blocking.
+  void poll(uint32_t now_ms)
+  {
+    _accept(now_ms);
+    for ( auto& c : _conns )
+    {
+      if ( c.state == State::Free )
+        continue;
+      switch ( c.state )
+      {
+        case State::Reading:   _read(c, now_ms); break;
+        case State::Writing:   _write(c, now_ms); break;
+        case State::Streaming: _stream(c, now_ms); break;
+        default: break;
+      }
+      if ( c.state != State::Free && c.state != State::Streaming && now_ms - c.last_ms > IDLE_TIMEOUT_MS )
+      {
+        ++_stats.timeouts;
+        _close(c);
+      }
+    }
+  } // poll()
+
+  /// @brief Queues an event for every subscriber of a stream. A
+  /// subscriber without room for it is dropped.
+  void publish(uint8_t stream, const char* event, const char* data)
+  {
+    for ( auto& c : _conns )
+      if ( c.state == State::Streaming && c.stream == stream )
+        _queue_event(c, event, data);
+  } // publish()
+
+  /// @brief Queues a comment on every event stream so dead peers are noticed.
+  void keep_alive()
+  {
+    for ( auto& c : _conns )
+      if ( c.state == State::Streaming && !_queue(c, ": ping\n\n", 8) )
+        _drop_slow(c);
+  } // keep_alive()
+
+  size_t subscribers(uint8_t stream) const
+  {
+    size_t n = 0;
+    for ( const auto& c : _conns )
+      if ( c.state == State::Streaming && c.stream == stream )
+        ++n;
+    return n;
+  } // subscribers()
+
+  /// @brief Event stream subscribers across all streams.
+  size_t subscribers_all() const
+  {
+    size_t n = 0;
+    for ( const auto& c : _conns )
+      if ( c.state == State::Streaming )
+        ++n;
+    return n;
+  } // subscribers_all()
+
+  size_t connections() const
+  {
+    size_t n = 0;
+    for ( const auto& c : _conns )
+      if ( c.state != State::Free )
+        ++n;
+    return n;
+  } // connections()
+
+  const HttpStats& stats() const { return _stats; }
+
+private:
+  enum class State : uint8_t
+  {
+    Free,
+    Reading,
+    Writing,
+    Streaming
+  };
+
+  struct Conn
+  {
+    typename Backend::Socket sock;
+    State    state {State::Free};
+    uint32_t last_ms {0};
+    char     in[IN_BUF + 1];
+    size_t   in_len {0};
+    char     out[OUT_BUF];
+    size_t   out_len {0};
+    size_t   out_pos {0};
+    HttpBody body {HttpBody::None};
+    const char* data {nullptr};
+    size_t   left {0};
+    bool     progmem {false};
+    bool     keep_alive {false};
+    uint8_t  stream {0};
+    TemplateCursor cursor;
+    HttpProducer producer {nullptr};
+    alignas(8) unsigned char context[HTTP_STREAM_CONTEXT];
+  };
+
+  struct Route
+  {
+    const char* path {nullptr};
+    HttpHandler handler {nullptr};
+  };
+
+  void _accept(uint32_t now_ms)
+  {
+    for ( auto& c : _conns )
+    {
+      if ( c.state != State::Free )
+        continue;
+      if ( !_backend.accept(c.sock) )
+        return;
+      ++_stats.accepted;
+      c.state = State::Reading;
+      c.last_ms = now_ms;
+      c.in_len = 0;
+      c.out_len = c.out_pos = 0;
+      c.body = HttpBody::None;
+    }
+  } // _accept()
+
+  void _read(Conn& c, uint32_t now_ms)
+  {
+    if ( c.in_len < IN_BUF )
+    {
+      int n = Backend::recv(c.sock, c.in + c.in_len, IN_BUF - c.in_len);
+      if ( n < 0 )
+      {
+        _close(c);
+        return;
+      }
+      if ( n > 0 )
+      {
+        c.in_len += static_cast<size_t>(n);
+        c.last_ms = now_ms;
+      }
+    }
+    c.in[c.in_len] = '\0';
+
+    char* end = strstr(c.in, "\r\n\r\n");
+    if ( end == nullptr )
+    {
+      if ( c.in_len == IN_BUF )
+      {
+        ++_stats.bad_requests;
+        _error(c, 431, now_ms);
+      }
+      return;
+    }
+
+    const size_t head_len = static_cast<size_t>(end - c.in) + 4;
+    HttpRequest req;
+    HttpResponse res;
+    if ( !_parse(c.in, head_len, req) )
+    {
+      ++_stats.bad_requests;
+      _error(c, 400, now_ms);
+      return;
+    }
+
+    ++_stats.requests;
+    if ( req.method == HttpMethod::Other )
+      res.send(405, "text/plain", "Method Not Allowed\n");
+    else
+    {
+      HttpHandler handler = nullptr;
+      for ( size_t i = 0; i < _route_count; ++i )
+        if ( strcmp(_routes[i].path, req.path) == 0 )
+        {
+          handler = _routes[i].handler;
+          break;
+        }
+      if ( handler != nullptr )
+        handler(req, res);
+      else if ( _not_found != nullptr )
+        _not_found(req, res);
+      else
+        res.send(404, "text/plain", "Not Found\n");
+      if ( res._status == 404 )
+        ++_stats.not_found;
+    }
+
+    // Keep any pipelined bytes for the next request.
+    memmove(c.in, c.in + head_len, c.in_len - head_len);
+    c.in_len -= head_len;
+
+    _begin_response(c, req, res, now_ms);
+  } // _read()
+
+  /// @brief Splits the request head in place.
+  static bool _parse(char* head, size_t len, HttpRequest& req)
+  {
+    head[len - 2] = '\0'; // End the last header line
+    char* line_end = strstr(head, "\r\n");
+    if ( line_end == nullptr )
+      return false;
+    *line_end = '\0';
+
+    // Request line: METHOD SP target SP version
+    char* sp1 = strchr(head, ' ');
+    char* sp2 = sp1 ? strchr(sp1 + 1, ' ') : nullptr;
+    if ( sp1 == nullptr || sp2 == nullptr )
+      return false;
+    *sp1 = '\0';
+    *sp2 = '\0';
+    if ( strcmp(head, "GET") == 0 )
+      req.method = HttpMethod::Get;
+    else if ( strcmp(head, "HEAD") == 0 )
+      req.method = HttpMethod::Head;
+    else
+      req.method = HttpMethod::Other;
+
+    char* target = sp1 + 1;
+    char* q = strchr(target, '?');
+    if ( q != nullptr )
+    {
+      *q = '\0';
+      req.query = q + 1;
+    }
+    req.path = target;
+    req.keep_alive = ( strcmp(sp2 + 1, "HTTP/1.1") == 0 );
+
+    // Headers
+    bool has_body = false;
+    for ( char* line = line_end + 2; *line != '\0'; )
+    {
+      char* next = strstr(line, "\r\n");
+      if ( next != nullptr )
+        *next = '\0';
+      char* colon = strchr(line, ':');
+      if ( colon != nullptr )
+      {
+        *colon = '\0';
+        char* value = colon + 1;
+        while ( *value == ' ' || *value == '\t' )
+          ++value;
+        if ( _iequals(line, "If-None-Match") )
+          req.if_none_match = value;
+        else if ( _iequals(line, "Connection") )
+        {
+          if ( _icontains(value, "close") )
+            req.keep_alive = false;
+          else if ( _icontains(value, "keep-alive") )
+            req.keep_alive = true;
+        }
+        else if ( _iequals(line, "Accept-Encoding") )
+          req.accept_gzip = _icontains(value, "gzip");
+        else if ( _iequals(line, "Content-Length") && atoi(value) > 0 )
+          has_body = true;
+        else if ( _iequals(line, "Transfer-Encoding") )
+          has_body = true;
+      }
+      if ( next == nullptr )
+        break;
+      line = next + 2;
+    }
+    // Request bodies are not read; close afterwards rather than parse
+    // the body as the next request.
+    if ( has_body )
+      req.keep_alive = false;
+    return true;
+  } // _parse()
+
+  void _begin_response(Conn& c, const HttpRequest& req, HttpResponse& res, uint32_t now_ms)
+  {
+    if ( res._body == HttpBody::Events && subscribers_all() >= MAX_CONN - 1 )
+    {
+      // Keep a slot free for ordinary requests.
+      res = HttpResponse();
+      res.send(503, "text/plain", "Too many subscribers\n");
+    }
+    if ( res._copy != nullptr && res._len + res._headers_len + 160 > OUT_BUF )
+    {
+      // send_copy() body too large for the buffer.
+      res = HttpResponse();
+      res.send(500, "text/plain", "Response too large\n");
+    }
+
+    c.keep_alive = req.keep_alive && res._body != HttpBody::Events;
+    // With every slot taken, close after this response so a connection
+    // waiting to be accepted gets a turn.
+    if ( connections() == MAX_CONN )
+      c.keep_alive = false;
+    c.body = res._body;
+    c.data = res._data;
+    c.left = res._len;
+    c.progmem = SSW_HTTP_PROGMEM_COPY && res._progmem;
+    c.out_len = c.out_pos = 0;
+
+    const bool head_only = ( req.method == HttpMethod::Head ) || res._status == 304 || res._status == 204;
+    const bool chunked = ( res._body == HttpBody::Template || res._body == HttpBody::Stream );
+
+    int n = snprintf(c.out, OUT_BUF, "HTTP/1.1 %d %s\r\n", res._status, _reason(res._status));
+    _append(c, n);
+    if ( res._content_type != nullptr )
+      _append(c, snprintf(c.out + c.out_len, OUT_BUF - c.out_len, "Content-Type: %s\r\n", res._content_type));
+    if ( chunked )
+      _append(c, snprintf(c.out + c.out_len, OUT_BUF - c.out_len, "Transfer-Encoding: chunked\r\n"));
+    else if ( res._body != HttpBody::Events && res._status != 304 )
+      _append(c, snprintf(c.out + c.out_len, OUT_BUF - c.out_len, "Content-Length: %u\r\n",
+        static_cast<unsigned>(res._body == HttpBody::Memory || res._copy != nullptr ? c.left : 0)));
+    if ( res._body == HttpBody::Events )
+      _append(c, snprintf(c.out + c.out_len, OUT_BUF - c.out_len, "Cache-Control: no-cache\r\n"));
+    _append(c, snprintf(c.out + c.out_len, OUT_BUF - c.out_len, "Connection: %s\r\n", c.keep_alive ? "keep-alive" : "close"));
+    if ( res._headers_len > 0 && res._headers_len <= OUT_BUF - c.out_len - 2 )
+    {
+      memcpy(c.out + c.out_len, res._headers, res._headers_len);
+      c.out_len += res._headers_len;
+    }
+    c.out[c.out_len++] = '\r';
+    c.out[c.out_len++] = '\n';
+
+    if ( head_only )
+    {
+      c.body = HttpBody::None;
+      c.left = 0;
+    }
+    else if ( res._copy != nullptr )
+    {
+      memcpy(c.out + c.out_len, res._copy, res._len);
+      c.out_len += res._len;
+      c.left = 0;
+      c.body = HttpBody::None;
+    }
+    else if ( c.body == HttpBody::Template )
+    {
+      c.cursor.begin(c.data, res._resolve);
+    }
+    else if ( c.body == HttpBody::Stream )
+    {
+      c.producer = res._producer;
+      memcpy(c.context, res._context, HTTP_STREAM_CONTEXT);
+      c.left = 0;
+    }
+
+    c.last_ms = now_ms;
+    if ( res._body == HttpBody::Events && !head_only )
+    {
+      c.state = State::Streaming;
+      c.stream = res._stream;
+      if ( res._first_data != nullptr )
+        _queue_event(c, res._data, res._first_data);
+      _stream(c, now_ms);
+    }
+    else
+    {
+      c.state = State::Writing;
+      _write(c, now_ms);
+    }
+  } // _begin_response()
+
+  void _append(Conn& c, int n)
+  {
+    if ( n > 0 )
+      c.out_len += static_cast<size_t>(n) < OUT_BUF - c.out_len ? static_cast<size_t>(n) : OUT_BUF - c.out_len - 1;
+  } // _append()
+
+  /// @brief Refills the output buffer from the body source.
+  void _fill(Conn& c)
+  {
+    if ( c.out_pos == c.out_len )
+      c.out_pos = c.out_len = 0;
+    if ( c.out_len != 0 )
+      return;
+
+    if ( c.body == HttpBody::Memory && c.progmem )
+    {
+      size_t n = c.left < OUT_BUF ? c.left : OUT_BUF;
+      memcpy_P(c.out, c.data, n);
+      c.out_len = n;
+      c.data += n;
+      c.left -= n;
+      if ( c.left == 0 )
+        c.body = HttpBody::None;
+    }
+    else if ( c.body == HttpBody::Template || c.body == HttpBody::Stream )
+    {
+      // Chunk: 3 hex digits, CRLF, data, CRLF
+      static constexpr size_t HEAD = 5;
+      const size_t cap = OUT_BUF - HEAD - 2 - 5;
+      size_t n;
+      bool done;
+      if ( c.body == HttpBody::Template )
+      {
+        n = c.cursor.fill(c.out + HEAD, cap, PLACEHOLDER_RESERVE);
+        done = c.cursor.done();
+      }
+      else
+      {
+        done = false;
+        n = c.producer(c.context, c.out + HEAD, cap, done);
+        if ( n > cap )
+          n = cap;
+        done = done || n == 0;
+      }
+      if ( n > 0 )
+      {
+        static const char HEX[] = "0123456789abcdef";
+        c.out[0] = HEX[(n >> 8) & 0xF];
+        c.out[1] = HEX[(n >> 4) & 0xF];
+        c.out[2] = HEX[n & 0xF];
+        c.out[3] = '\r';
+        c.out[4] = '\n';
+        c.out[HEAD + n] = '\r';
+        c.out[HEAD + n + 1] = '\n';
+        c.out_len = HEAD + n + 2;
+      }
+      if ( done )
+      {
+        memcpy(c.out + c.out_len, "0\r\n\r\n", 5);
+        c.out_len += 5;
+        c.body = HttpBody::None;
+      }
+    }
+  } // _fill()
+
+  void _write(Conn& c, uint32_t now_ms)
+  {
+    for ( ;; )
+    {
+      _fill(c);
+      int n;
+      if ( c.out_len > c.out_pos )
+        n = Backend::send(c.sock, c.out + c.out_pos, c.out_len - c.out_pos);
+      else if ( c.body == HttpBody::Memory && c.left > 0 )
+      {
+        // RAM body: straight from the caller's memory, no copy.
+        n = Backend::send(c.sock, c.data, c.left);
+        if ( n > 0 )
+        {
+          c.data += n;
+          c.left -= static_cast<size_t>(n);
+          if ( c.left == 0 )
+            c.body = HttpBody::None;
+        }
+      }
+      else
+      {
+        _finish(c, now_ms);
+        return;
+      }
+
+      if ( n < 0 )
+      {
+        _close(c);
+        return;
+      }
+      if ( n == 0 )
+        return; // Socket full; try again next poll
+      c.last_ms = now_ms;
+      if ( c.out_len > c.out_pos )
+        c.out_pos += static_cast<size_t>(n);
+    }
+  } // _write()
+
+  /// @brief The response is out: wait for the next request or close.
+  void _finish(Conn& c, uint32_t now_ms)
+  {
+    if ( !c.keep_alive )
+    {
+      _close(c);
+      return;
+    }
+    c.state = State::Reading;
+    c.out_len = c.out_pos = 0;
+    c.last_ms = now_ms;
+    // A pipelined request already in c.in is handled on the next poll().
+  } // _finish()
+
+  void _stream(Conn& c, uint32_t now_ms)
+  {
+    // Anything the client sends is ignored; a closed socket ends the stream.
+    char discard[32];
+    if ( Backend::recv(c.sock, discard, sizeof(discard)) < 0 )
+    {
+      _close(c);
+      return;
+    }
+    if ( c.out_len > c.out_pos )
+    {
+      int n = Backend::send(c.sock, c.out + c.out_pos, c.out_len - c.out_pos);
+      if ( n < 0 )
+      {
+        _close(c);
+        return;
+      }
+      c.out_pos += static_cast<size_t>(n);
+      if ( c.out_pos == c.out_len )
+        c.out_pos = c.out_len = 0;
+      if ( n > 0 )
+        c.last_ms = now_ms;
+    }
+  } // _stream()
+
+  /// @brief Appends raw bytes to a connection's output. Returns false if
+  /// there is no room.
+  bool _queue(Conn& c, const char* data, size_t n)
+  {
+    _compact(c);
+    if ( n > OUT_BUF - c.out_len )
+      return false;
+    memcpy(c.out + c.out_len, data, n);
+    c.out_len += n;
+    return true;
+  } // _queue()
+
+  /// @brief Moves unsent output to the start of the buffer.
+  static void _compact(Conn& c)
+  {
+    if ( c.out_pos == 0 )
+      return;
+    memmove(c.out, c.out + c.out_pos, c.out_len - c.out_pos);
+    c.out_len -= c.out_pos;
+    c.out_pos = 0;
+  } // _compact()
+
+  void _queue_event(Conn& c, const char* event, const char* data)
+  {
+    const size_t event_len = event != nullptr ? strlen(event) : 0;
+    const size_t data_len = strlen(data);
+    const size_t need = (event != nullptr ? 8 + event_len : 0) + 6 + data_len + 2;
+    _compact(c);
+    if ( need > OUT_BUF - c.out_len )
+    {
+      // Too slow to keep up. Dropping it is better than sending a
+      // partial event or waiting.
+      _drop_slow(c);
+      return;
+    }
+    if ( event != nullptr )
+    {
+      _queue(c, "event: ", 7);
+      _queue(c, event, event_len);
+      _queue(c, "\n", 1);
+    }
+    _queue(c, "data: ", 6);
+    _queue(c, data, data_len);
+    _queue(c, "\n\n", 2);
+  } // _queue_event()
+
+  void _drop_slow(Conn& c)
+  {
+    ++_stats.dropped;
+    _close(c);
+  } // _drop_slow()
+
+  void _error(Conn& c, int status, uint32_t now_ms)
+  {
+    HttpRequest req;
+    req.keep_alive = false;
+    HttpResponse res;
+    res.send(status, "text/plain", _reason(status));
+    c.in_len = 0;
+    _begin_response(c, req, res, now_ms);
+  } // _error()
+
+  void _close(Conn& c)
+  {
+    Backend::close(c.sock);
+    c.state = State::Free;
+    c.in_len = 0;
+    c.out_len = c.out_pos = 0;
+    c.body = HttpBody::None;
+  } // _close()
+
+  static const char* _reason(int status)
+  {
+    switch ( status )
+    {
+      case 200: return "OK";
+      case 204: return "No Content";
+      case 304: return "Not Modified";
+      case 400: return "Bad Request";
+      case 404: return "Not Found";
+      case 405: return "Method Not Allowed";
+      case 431: return "Request Header Fields Too Large";
+      case 500: return "Internal Server Error";
+      case 503: return "Service Unavailable";
+      default:  return "Unknown";
+    }
+  } // _reason()
+
+  static bool _iequals(const char* a, const char* b)
+  {
+    for ( ; *a != '\0' && *b != '\0'; ++a, ++b )
+      if ( _lower(*a) != _lower(*b) )
+        return false;
+    return *a == *b;
+  } // _iequals()
+
+  static bool _icontains(const char* s, const char* word)
+  {
+    const size_t n = strlen(word);
+    for ( ; *s != '\0'; ++s )
+    {
+      size_t i = 0;
+      while ( i < n && s[i] != '\0' && _lower(s[i]) == word[i] )
+        ++i;
+      if ( i == n )
+        return true;
+    }
+    return false;
+  } // _icontains()
+
+  static char _lower(char c) { return ( c >= 'A' && c <= 'Z' ) ? static_cast<char>(c - 'A' + 'a') : c; }
+
+  Backend&    _backend;
+  Conn        _conns[MAX_CONN];
+  Route       _routes[MAX_ROUTES];
+  size_t      _route_count {0};
+  HttpHandler _not_found {nullptr};
+  HttpStats   _stats;
+}; // class HttpServer
+
+} // namespace SSW
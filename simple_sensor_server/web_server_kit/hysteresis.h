@@ -0,0 +1,169 @@
+/////////////////////////////////////////////////////////////////////
+/// Hysteresis (bang-bang) controllers
+///
+/// SSW::Hysteresis<Sensor, Output, Policy> switches an output on and
+/// off around a set point with a dead band:
+///
+///   Sensor  Provides 'value_type' and 'bool read(value_type& v)'.
+///           read() returns false while there is no reading, and the
+///           controller then leaves the output alone.
+///   Output  Provides 'void write(bool on)'. Called only on transitions.
+///   Policy  ActiveBelow (heater, lamp) or ActiveAbove (alarm on a
+///           rising value). Decides which side of the band is 'on'.
+///
+/// Transitions can be held back by dwell times (minimum on and off
+/// time) and by a minimum time between successive turn-ons, which
+/// protects relays and anything that must not short-cycle.
+///
+/// ControllerTable evaluates a fixed set of controllers in one batch per
+/// tick. Nothing here depends on Arduino, so the controllers can be run
+/// on the host with mock sensors and outputs.
+/////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+
+namespace SSW
+{
+
+/// @brief On below the band (set - hysteresis), off above it.
+struct ActiveBelow
+{
+  template <typename T>
+  static bool turn_on(T v, T set, T h) { return v < set - h; }
+  template <typename T>
+  static bool turn_off(T v, T set, T h) { return v > set + h; }
+}; // struct ActiveBelow
+
+/// @brief On above the band (set + hysteresis), off below it.
+struct ActiveAbove
+{
+  template <typename T>
+  static bool turn_on(T v, T set, T h) { return v > set + h; }
+  template <typename T>
+  static bool turn_off(T v, T set, T h) { return v < set - h; }
+}; // struct ActiveAbove
+
+/// @brief Set point, dead band and timing limits for one controller.
+template <typename T>
+struct HysteresisConfig
+{
+  T        set_point;            ///< Centre of the dead band
+  T        hysteresis;           ///< Half-width of the dead band
+  uint32_t min_on_ms {0};        ///< Minimum time the output stays on
+  uint32_t min_off_ms {0};       ///< Minimum time the output stays off
+  uint32_t min_cycle_ms {0};     ///< Minimum time between successive turn-ons
+}; // struct HysteresisConfig
+
+/// @class Hysteresis
+/// @brief One controller. The output starts off and is assumed to have
+/// been driven off by the caller at startup.
+template <typename Sensor, typename Output, typename Policy>
+class Hysteresis
+{
+public:
+  using value_type = typename Sensor::value_type;
+  using Config = HysteresisConfig<value_type>;
+
+  Hysteresis(Sensor& sensor, Output& output, const Config& cfg) :
+    _sensor(sensor),
+    _output(output),
+    _cfg(cfg)
+  {}
+
+  /// @brief Reads the sensor and switches the output if needed.
+  /// @return true if the output changed.
+  bool update(uint32_t now_ms)
+  {
+    value_type v;
+    if ( !_sensor.read(v) )
+      return false;
+
+    bool want = _on;
+    if ( !_on && Policy::turn_on(v, _cfg.set_point, _cfg.hysteresis) )
+      want = true;
+    else if ( _on && Policy::turn_off(v, _cfg.set_point, _cfg.hysteresis) )
+      want = false;
+
+    if ( want == _on || !_allowed(want, now_ms) )
+      return false;
+
+    _on = want;
+    _changed_ms = now_ms;
+    if ( want )
+      _last_on_ms = now_ms;
+    ++_transitions;
+    _output.write(want);
+    return true;
+  } // update()
+
+  bool on() const { return _on; }
+  uint32_t transitions() const { return _transitions; }
+
+  const Config& config() const { return _cfg; }
+  void set_point(value_type set) { _cfg.set_point = set; }
+
+private:
+  /// @brief Applies the dwell and cycle limits to a pending transition.
+  bool _allowed(bool want, uint32_t now_ms) const
+  {
+    const uint32_t in_state = now_ms - _changed_ms;
+    if ( want )
+    {
+      if ( in_state < _cfg.min_off_ms )
+        return false;
+      if ( _transitions != 0 && now_ms - _last_on_ms < _cfg.min_cycle_ms )
+        return false;
+      return true;
+    }
+    return in_state >= _cfg.min_on_ms;
+  } // _allowed()
+
+  Sensor&  _sensor;
+  Output&  _output;
+  Config   _cfg;
+  bool     _on {false};
+  uint32_t _changed_ms {0};   ///< When the output last changed (or startup)
+  uint32_t _last_on_ms {0};   ///< When the output last turned on
+  uint32_t _transitions {0};
+}; // class Hysteresis
+
+/// @brief Deduces the controller type: make_hysteresis<ActiveBelow>(s, o, cfg).
+template <typename Policy, typename Sensor, typename Output>
+Hysteresis<Sensor, Output, Policy> make_hysteresis(Sensor& sensor, Output& output,
+  const HysteresisConfig<typename Sensor::value_type>& cfg)
+{
+  return Hysteresis<Sensor, Output, Policy>(sensor, output, cfg);
+} // make_hysteresis()
+
+/// @class ControllerTable
+/// @brief A fixed set of controllers updated together.
+template <typename... Controllers>
+class ControllerTable
+{
+public:
+  explicit ControllerTable(Controllers&... controllers) : _controllers(controllers...) {}
+
+  /// @brief Updates every controller.
+  /// @return The number of outputs that changed.
+  unsigned update(uint32_t now_ms)
+  {
+    return _update(now_ms, std::index_sequence_for<Controllers...>{});
+  } // update()
+
+  static constexpr size_t size() { return sizeof...(Controllers); }
+
+private:
+  template <size_t... I>
+  unsigned _update(uint32_t now_ms, std::index_sequence<I...>)
+  {
+    return (0U + ... + static_cast<unsigned>(std::get<I>(_controllers).update(now_ms)));
+  } // _update()
+
+  std::tuple<Controllers&...> _controllers;
+}; // class ControllerTable
+
+} // namespace SSW
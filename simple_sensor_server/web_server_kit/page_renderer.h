@@ -0,0 +1,294 @@
+/////////////////////////////////////////////////////////////////////
+/// Streamed page rendering
+///
+/// SSW::render_page() expands a page template stored in PROGMEM into a
+/// small fixed buffer and hands it to a sink a chunk at a time, so a
+/// page of any size is served without building it in the heap.
+///
+/// Placeholders are written {{name}}. For each one the resolver is
+/// called with the name and a ChunkWriter, and prints the value
+/// directly into the output stream. Unknown names print nothing.
+///
+/// The sink is any callable taking (const char* data, size_t len). On
+/// the ESP8266 it is server.sendContent(); on the host it can append to
+/// a string or write to a socket.
+///
+/// TemplateCursor expands the same templates piecewise, for a server
+/// that fills a connection's output buffer each time it drains.
+/////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(ARDUINO)
+#include <pgmspace.h>
+#else
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+#ifndef pgm_read_byte
+#define pgm_read_byte(p) (*reinterpret_cast<const uint8_t*>(p))
+#endif
+#endif
+
+namespace SSW
+{
+
+/// @class ChunkWriter
+/// @brief Buffers output and passes it to the sink whenever the buffer
+/// fills. No heap allocation.
+template <size_t BUF, typename Sink>
+class ChunkWriter
+{
+  static_assert(BUF >= 16, "ChunkWriter buffer is too small");
+
+public:
+  explicit ChunkWriter(Sink& sink) : _sink(sink) {}
+  ~ChunkWriter() { flush(); }
+
+  void put(char c)
+  {
+    if ( _len == BUF )
+      flush();
+    _buf[_len++] = c;
+  } // put()
+
+  void write(const char* s, size_t n)
+  {
+    while ( n > 0 )
+    {
+      if ( _len == BUF )
+        flush();
+      size_t take = BUF - _len < n ? BUF - _len : n;
+      memcpy(&_buf[_len], s, take);
+      _len += take;
+      s += take;
+      n -= take;
+    }
+  } // write()
+
+  void print(const char* s) { write(s, strlen(s)); }
+
+  void print(int32_t v)
+  {
+    char digits[12];
+    size_t n = 0;
+    uint32_t u = v < 0 ? 0U - static_cast<uint32_t>(v) : static_cast<uint32_t>(v);
+    do
+    {
+      digits[n++] = static_cast<char>('0' + u % 10U);
+      u /= 10U;
+    } while ( u != 0 );
+    if ( v < 0 )
+      put('-');
+    while ( n > 0 )
+      put(digits[--n]);
+  } // print()
+
+  /// @brief Prints a value with a fixed number of decimal places (0-6).
+  void print(float v, unsigned decimals)
+  {
+    if ( decimals > 6 )
+      decimals = 6;
+    int32_t scale = 1;
+    for ( unsigned i = 0; i < decimals; ++i )
+      scale *= 10;
+    const bool neg = v < 0.0f;
+    const float mag = neg ? -v : v;
+    const int64_t fixed = static_cast<int64_t>(mag * scale + 0.5f);
+    if ( neg && fixed != 0 )
+      put('-');
+    print(static_cast<int32_t>(fixed / scale));
+    if ( decimals == 0 )
+      return;
+    put('.');
+    int32_t frac = static_cast<int32_t>(fixed % scale);
+    for ( int32_t d = scale / 10; d > 0; d /= 10 )
+    {
+      put(static_cast<char>('0' + frac / d));
+      frac %= d;
+    }
+  } // print()
+
+  void flush()
+  {
+    if ( _len > 0 )
+    {
+      _sink(_buf, _len);
+      _total += _len;
+      _len = 0;
+    }
+  } // flush()
+
+  /// @brief Bytes handed to the sink so far.
+  size_t total() const { return _total; }
+
+private:
+  Sink&  _sink;
+  char   _buf[BUF];
+  size_t _len {0};
+  size_t _total {0};
+}; // class ChunkWriter
+
+/// @brief A ChunkWriter sink that fills a fixed array. Output that does
+/// not fit is discarded and flagged.
+struct ArraySink
+{
+  char*  buf;
+  size_t cap;
+  size_t len {0};
+  bool   overflow {false};
+
+  ArraySink(char* b, size_t c) : buf(b), cap(c) {}
+
+  void operator()(const char* data, size_t n)
+  {
+    if ( n > cap - len )
+    {
+      n = cap - len;
+      overflow = true;
+    }
+    memcpy(buf + len, data, n);
+    len += n;
+  } // operator()
+}; // struct ArraySink
+
+/// @brief Longest placeholder name.
+static constexpr size_t TEMPLATE_MAX_NAME = 24;
+
+/// @brief Recognises a {{name}} placeholder at p.
+/// @param name: Receives the name, TEMPLATE_MAX_NAME bytes
+/// @param len: Receives the name length
+/// @return The template position after the closing "}}", or nullptr if
+///   p is not a well-formed placeholder (it is then plain text).
+inline const char* template_placeholder(const char* p, char* name, size_t& len)
+{
+  if ( static_cast<char>(pgm_read_byte(p)) != '{' || static_cast<char>(pgm_read_byte(p + 1)) != '{' )
+    return nullptr;
+  size_t n = 0;
+  const char* q = p + 2;
+  char d;
+  while ( (d = static_cast<char>(pgm_read_byte(q))) != '\0' && d != '}' && n < TEMPLATE_MAX_NAME )
+  {
+    name[n++] = d;
+    ++q;
+  }
+  if ( d != '}' || static_cast<char>(pgm_read_byte(q + 1)) != '}' )
+    return nullptr;
+  len = n;
+  return q + 2;
+} // template_placeholder()
+
+/// @brief Expands a PROGMEM template through a BUF-byte buffer.
+/// @param tmpl: Nul-terminated template in PROGMEM
+/// @param resolve: Called as resolve(name, name_len, writer) for each placeholder
+/// @param sink: Called as sink(data, len) for each chunk
+/// @return The number of bytes produced
+template <size_t BUF, typename Resolver, typename Sink>
+size_t render_page(const char* tmpl, Resolver&& resolve, Sink&& sink)
+{
+  ChunkWriter<BUF, typename std::remove_reference<Sink>::type> out(sink);
+
+  char name[TEMPLATE_MAX_NAME];
+  size_t len = 0;
+  const char* p = tmpl;
+  for ( ;; )
+  {
+    char c = static_cast<char>(pgm_read_byte(p));
+    if ( c == '\0' )
+      break;
+
+    const char* next = ( c == '{' ) ? template_placeholder(p, name, len) : nullptr;
+    if ( next != nullptr )
+    {
+      resolve(static_cast<const char*>(name), len, out);
+      p = next;
+      continue;
+    }
+    out.put(c);
+    ++p;
+  }
+
+  out.flush();
+  return out.total();
+} // render_page()
+
+/// @brief The writer a TemplateResolver prints into.
+using TemplateWriter = ChunkWriter<32, ArraySink>;
+
+/// @brief Fills in one placeholder. A captureless generic lambda taking
+/// (const char* name, size_t len, auto& out) converts to this.
+using TemplateResolver = void (*)(const char* name, size_t len, TemplateWriter& out);
+
+/// @class TemplateCursor
+/// @brief Resumable template expansion for servers that send a response
+/// a buffer at a time. Each fill() continues where the last one stopped.
+class TemplateCursor
+{
+public:
+  void begin(const char* tmpl, TemplateResolver resolve)
+  {
+    _p = tmpl;
+    _resolve = resolve;
+    _done = ( tmpl == nullptr );
+  } // begin()
+
+  bool done() const { return _done; }
+
+  /// @brief Expands as much of the template as fits.
+  /// @param buf: Output
+  /// @param cap: Size of buf
+  /// @param reserve: Room needed to expand a placeholder. Expansion stops
+  ///   at a placeholder with less room left, unless buf is empty, in which
+  ///   case the value is truncated to fit.
+  /// @return Bytes written to buf
+  size_t fill(char* buf, size_t cap, size_t reserve)
+  {
+    size_t n = 0;
+    char name[TEMPLATE_MAX_NAME];
+    size_t len = 0;
+    while ( !_done && n < cap )
+    {
+      char c = static_cast<char>(pgm_read_byte(_p));
+      if ( c == '\0' )
+      {
+        _done = true;
+        break;
+      }
+      const char* next = ( c == '{' ) ? template_placeholder(_p, name, len) : nullptr;
+      if ( next != nullptr )
+      {
+        if ( cap - n < reserve && n > 0 )
+          break;
+        ArraySink sink(buf + n, cap - n);
+        {
+          TemplateWriter out(sink);
+          if ( _resolve != nullptr )
+            _resolve(name, len, out);
+        }
+        n += sink.len;
+        _p = next;
+        continue;
+      }
+      buf[n++] = c;
+      ++_p;
+    }
+    return n;
+  } // fill()
+
+private:
+  const char* _p {nullptr};
+  TemplateResolver _resolve {nullptr};
+  bool _done {true};
+}; // class TemplateCursor
+
+/// @brief Compares a placeholder name with a literal.
+inline bool name_is(const char* name, size_t len, const char* literal)
+{
+  return strlen(literal) == len && memcmp(name, literal, len) == 0;
+} // name_is()
+
+} // namespace SSW
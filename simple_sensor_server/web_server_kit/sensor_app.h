@@ -0,0 +1,324 @@
+// The sensor server's web application: the state snapshot, the pages
+// and API built from it, and the route table.
+//
+// Nothing here touches a sensor or the network hardware. The sketch
+// fills the snapshot from the real sensors and serves it with the
+// ESP8266 backend; the host build in ../host fills it from fake sensors
+// and serves it over POSIX sockets, so the same request handling can be
+// load-tested on Linux.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "page_renderer.h"
+#include "snapshot_buffer.h"
+#include "http_server.h"
+#include "time_series.h"
+#include "history_stream.h"
+#include "assets.h"   // Generated by tools/make_assets.py from ../assets
+
+static constexpr uint8_t  MAX_PROBES = 4;             // Temperatures carried in a snapshot
+static constexpr uint32_t EVENT_KEEPALIVE_MS = 15000; // Time between keep-alive comments on /events
+
+// The web server. Each connection slot has a 512 byte request buffer
+// and a 512 byte response buffer; one slot is always kept for ordinary
+// requests, so up to MAX_CONNECTIONS - 1 browsers can follow /events.
+static constexpr size_t MAX_CONNECTIONS = 5;
+static constexpr uint8_t STATE_STREAM = 0; // The /events stream
+template <typename Backend>
+using SensorServer = SSW::HttpServer<Backend, MAX_CONNECTIONS, 512, 512, 8>;
+
+// Sensor history. Each series keeps raw samples plus 1-minute and 1-hour
+// roll-ups within a fixed RAM budget. Times are seconds since boot; the
+// access point has no wall clock.
+static constexpr size_t HISTORY_BYTES = 2048; // RAM budget for each sensor's history
+using History = SSW::BudgetedTimeSeries<HISTORY_BYTES>;
+static History temp_history(10);  // Tenths of a degree F
+static History light_history(1);  // ADC counts
+static History moisture_history(1); // ADC counts
+
+// The values served by the web page and the API. The sketch publishes
+// them from its sampling loop so that serving a request never waits on a
+// sensor. This is also the /api/state.bin format: little-endian, no
+// padding.
+static constexpr uint8_t SNAPSHOT_FORMAT = 1;
+struct Snapshot
+{
+   uint8_t  format;                       // SNAPSHOT_FORMAT
+   uint8_t  probes;                       // Number of valid entries in temp
+   uint8_t  relay_1;                      // 1 if on
+   uint8_t  relay_2;                      // 1 if on
+   uint8_t  is_dry;                       // 1 if the plant needs water
+   uint8_t  reserved;
+   int16_t  temp[MAX_PROBES];             // Hundredths of a degree F, one per probe
+   uint16_t vcc;                          // Supply voltage, millivolts
+   int16_t  light;                        // ADC counts
+   int16_t  moisture;                     // ADC counts
+}; // Snapshot
+static_assert(sizeof(Snapshot) == 20, "Snapshot must not contain padding");
+static SSW::SnapshotBuffer<Snapshot> state;
+
+// The root page. {{name}} placeholders are filled from the snapshot.
+// After that /app.js subscribes to /events and updates the page in place
+// with the fields that change.
+static const char ROOT_PAGE[] PROGMEM = R"EOF(<html><head>
+<script src="/app.js" defer></script>
+</head><body>
+{{temps}}<h1>Supply Voltage: <span id="vcc">{{vcc}}</span> V</h1>
+<h1>Light Level: <span id="light">{{light}}</span></h1>
+<h1>Soil moisture: <span id="moisture">{{moisture}}</span></h1>
+<h1>Relay 1: <span id="relay_1">{{relay_1}}</span></h1>
+<h1>Relay 2: <span id="relay_2">{{relay_2}}</span></h1>
+<h1>Plant moisture: <span id="dry">{{dry}}</span></h1>
+</body></html>)EOF";
+
+// /api/state
+static const char STATE_JSON[] PROGMEM = R"EOF({"temps":[{{temps_json}}],"vcc":{{vcc}},"light":{{light}},"moisture":{{moisture}},"relay_1":{{relay_1_json}},"relay_2":{{relay_2_json}},"dry":{{dry_json}}}
+)EOF";
+
+// Fills in the {{name}} placeholders of the page and JSON templates from
+// the current snapshot.
+static auto resolve_state = [](const char* name, size_t len, auto& out)
+{
+   using SSW::name_is;
+   const Snapshot& snap = state.current();
+   if ( name_is(name, len, "temps") )
+   {
+      // One line per probe, numbered only when there is more than one.
+      for ( uint8_t i = 0; i < snap.probes; ++i )
+      {
+         out.print("<h1>Temperature");
+         if ( snap.probes > 1 )
+         {
+            out.put(' ');
+            out.print(static_cast<int32_t>(i + 1));
+         }
+         out.print(": <span id=\"t");
+         out.print(static_cast<int32_t>(i));
+         out.print("\">");
+         out.print(snap.temp[i] / 100.0f, 2);
+         out.print("</span></h1>\n");
+      }
+   }
+   else if ( name_is(name, len, "temps_json") )
+   {
+      for ( uint8_t i = 0; i < snap.probes; ++i )
+      {
+         if ( i > 0 )
+            out.put(',');
+         out.print(snap.temp[i] / 100.0f, 2);
+      }
+   }
+   else if ( name_is(name, len, "vcc") )
+      out.print(snap.vcc / 1000.0f, 2);
+   else if ( name_is(name, len, "light") )
+      out.print(static_cast<int32_t>(snap.light));
+   else if ( name_is(name, len, "moisture") )
+      out.print(static_cast<int32_t>(snap.moisture));
+   else if ( name_is(name, len, "relay_1") )
+      out.print(snap.relay_1 ? "ON" : "OFF");
+   else if ( name_is(name, len, "relay_2") )
+      out.print(snap.relay_2 ? "ON" : "OFF");
+   else if ( name_is(name, len, "dry") )
+      out.print(snap.is_dry ? "DRY" : "OK");
+   else if ( name_is(name, len, "relay_1_json") )
+      out.print(snap.relay_1 ? "true" : "false");
+   else if ( name_is(name, len, "relay_2_json") )
+      out.print(snap.relay_2 ? "true" : "false");
+   else if ( name_is(name, len, "dry_json") )
+      out.print(snap.is_dry ? "true" : "false");
+};
+
+// The template resolver in the form the server stores.
+static const SSW::TemplateResolver state_resolver = resolve_state;
+
+// Adds the snapshot's ETag. Returns true, having responded 304 Not
+// Modified, if the client already has the current snapshot.
+static bool send_not_modified(const SSW::HttpRequest& req, SSW::HttpResponse& res)
+{
+   char etag[12];
+   state.format_etag(etag, sizeof(etag));
+   res.header("ETag", etag);
+   res.header("Cache-Control", "no-cache");
+   if ( !state.matches(req.if_none_match) )
+      return false;
+   res.not_modified();
+   return true;
+} // send_not_modified()
+
+// This function handles requests to http://192.168.4.1/
+inline void handleRoot(const SSW::HttpRequest&, SSW::HttpResponse& res)
+{
+   // Report our status
+   res.send_template(200, "text/html", ROOT_PAGE, state_resolver);
+}
+
+// Handles /api/state: the snapshot as JSON.
+inline void handleState(const SSW::HttpRequest& req, SSW::HttpResponse& res)
+{
+   if ( send_not_modified(req, res) )
+      return;
+   res.send_template(200, "application/json", STATE_JSON, state_resolver);
+}
+
+// Handles /api/state.bin: the packed Snapshot struct. Copied, since the
+// snapshot may be republished before the response is sent.
+inline void handleStateBin(const SSW::HttpRequest& req, SSW::HttpResponse& res)
+{
+   if ( send_not_modified(req, res) )
+      return;
+   res.send_copy(200, "application/octet-stream", &state.current(), sizeof(Snapshot));
+}
+
+// Serves the precompressed files in ASSETS, e.g. /app.js, and 404 for
+// anything else.
+inline void handleAsset(const SSW::HttpRequest& req, SSW::HttpResponse& res)
+{
+   const SSW::Asset* asset = SSW::find_asset(ASSETS, req.path);
+   if ( asset != nullptr )
+      SSW::serve_asset(*asset, req, res);
+   else
+      res.send(404, "text/plain", "Not Found\n");
+}
+
+// Handles /events: a Server-Sent Events stream of 'state' events. The
+// first event carries the whole state; later ones only what changed.
+inline void handleEvents(const SSW::HttpRequest&, SSW::HttpResponse& res)
+{
+   // Queued by the server as soon as this returns.
+   static char data[160];
+   SSW::ArraySink sink(data, sizeof(data) - 1);
+   SSW::render_page<64>(STATE_JSON, resolve_state, sink);
+   // Events are a single line; drop the template's trailing newline.
+   while ( sink.len > 0 && data[sink.len - 1] == '\n' )
+      --sink.len;
+   data[sink.len] = '\0';
+   res.send_events(STATE_STREAM, "state", data);
+}
+
+// Handles /api/history?sensor=temp|light|moisture&from=..&to=..&res=..
+// See history_stream.h. Relative times count back from the newest sample.
+inline void handleHistory(const SSW::HttpRequest& req, SSW::HttpResponse& res)
+{
+   char sensor[16] = "";
+   req.param("sensor", sensor, sizeof(sensor));
+   const History* series = nullptr;
+   if ( strcmp(sensor, "temp") == 0 )
+      series = &temp_history;
+   else if ( strcmp(sensor, "light") == 0 )
+      series = &light_history;
+   else if ( strcmp(sensor, "moisture") == 0 )
+      series = &moisture_history;
+   if ( series == nullptr )
+   {
+      res.send(400, "text/plain", "sensor must be temp, light or moisture\n");
+      return;
+   }
+
+   SSW::HistoryParams params;
+   const uint32_t now = series->has_data() ? series->latest().t : 0;
+   if ( !SSW::parse_history_params(req, now, params) )
+   {
+      res.send(400, "text/plain", "Bad from, to, res or format\n");
+      return;
+   }
+   SSW::send_history(*series, params, res);
+}
+
+// Registers the application's routes.
+template <typename Server>
+void attach_routes(Server& server)
+{
+   server.on("/", handleRoot);
+   server.on("/api/state", handleState);
+   server.on("/api/state.bin", handleStateBin);
+   server.on("/events", handleEvents);
+   server.on("/api/history", handleHistory);
+   server.on_not_found(handleAsset);
+} // attach_routes()
+
+// Pushes what changed since the last call to the /events subscribers,
+// and a keep-alive every EVENT_KEEPALIVE_MS. Call from the main loop.
+template <typename Server>
+void publish_changes(Server& server, uint32_t now)
+{
+   // The snapshot the subscribers have already been sent.
+   static Snapshot sent = state.current();
+   static uint32_t sent_version = state.version();
+   static uint32_t last_keepalive = 0;
+
+   if ( state.version() != sent_version )
+   {
+      const Snapshot& snap = state.current();
+      if ( server.subscribers(STATE_STREAM) > 0 )
+      {
+         // One event listing only the fields that changed.
+         char data[160];
+         SSW::ArraySink sink(data, sizeof(data) - 1);
+         {
+            SSW::ChunkWriter<64, SSW::ArraySink> out(sink);
+            char sep = '{';
+            if ( snap.probes != sent.probes || memcmp(snap.temp, sent.temp, sizeof(snap.temp)) != 0 )
+            {
+               out.put(sep); sep = ',';
+               out.print("\"temps\":[");
+               for ( uint8_t i = 0; i < snap.probes; ++i )
+               {
+                  if ( i > 0 )
+                     out.put(',');
+                  out.print(snap.temp[i] / 100.0f, 2);
+               }
+               out.put(']');
+            }
+            if ( snap.vcc != sent.vcc )
+            {
+               out.put(sep); sep = ',';
+               out.print("\"vcc\":");
+               out.print(snap.vcc / 1000.0f, 2);
+            }
+            if ( snap.light != sent.light )
+            {
+               out.put(sep); sep = ',';
+               out.print("\"light\":");
+               out.print(static_cast<int32_t>(snap.light));
+            }
+            if ( snap.moisture != sent.moisture )
+            {
+               out.put(sep); sep = ',';
+               out.print("\"moisture\":");
+               out.print(static_cast<int32_t>(snap.moisture));
+            }
+            if ( snap.relay_1 != sent.relay_1 )
+            {
+               out.put(sep); sep = ',';
+               out.print(snap.relay_1 ? "\"relay_1\":true" : "\"relay_1\":false");
+            }
+            if ( snap.relay_2 != sent.relay_2 )
+            {
+               out.put(sep); sep = ',';
+               out.print(snap.relay_2 ? "\"relay_2\":true" : "\"relay_2\":false");
+            }
+            if ( snap.is_dry != sent.is_dry )
+            {
+               out.put(sep); sep = ',';
+               out.print(snap.is_dry ? "\"dry\":true" : "\"dry\":false");
+            }
+            if ( sep == ',' )
+               out.put('}');
+         }
+         data[sink.len] = '\0';
+         if ( sink.len > 0 )
+            server.publish(STATE_STREAM, "state", data);
+      }
+      sent = snap;
+      sent_version = state.version();
+   }
+
+   if ( now - last_keepalive >= EVENT_KEEPALIVE_MS )
+   {
+      server.keep_alive();
+      last_keepalive = now;
+   }
+} // publish_changes()
\ No newline at end of file
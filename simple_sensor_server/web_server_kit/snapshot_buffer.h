@@ -0,0 +1,110 @@
+/////////////////////////////////////////////////////////////////////
+/// Double-buffered state snapshots
+///
+/// The sampling loop fills the back buffer with edit() and then calls
+/// publish(), which makes it the current snapshot in one step. Request
+/// handlers only read current(), so they never see a half-updated
+/// state and never touch the sensors.
+///
+/// publish() ignores a snapshot identical to the current one, so the
+/// ETag (a hash of the contents) only changes when the data does, and
+/// the same data gives the same ETag across restarts.
+/////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+namespace SSW
+{
+
+/// @brief 32-bit FNV-1a hash.
+inline uint32_t fnv1a(const void* data, size_t len, uint32_t h = 2166136261U)
+{
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  for ( size_t i = 0; i < len; ++i )
+  {
+    h ^= p[i];
+    h *= 16777619U;
+  }
+  return h;
+} // fnv1a()
+
+/// @class SnapshotBuffer
+/// @brief Two copies of T: the published one and the one being edited.
+/// T must be trivially copyable and free of padding, since snapshots are
+/// compared and hashed bytewise.
+template <typename T>
+class SnapshotBuffer
+{
+  static_assert(std::is_trivially_copyable<T>::value, "Snapshots are copied bytewise");
+
+public:
+  SnapshotBuffer()
+  {
+    memset(_buf, 0, sizeof(_buf));
+    _etag = fnv1a(&_buf[0], sizeof(T));
+  }
+
+  /// @brief The back buffer. Starts as a copy of the current snapshot.
+  T& edit() { return _buf[_front ^ 1U]; }
+
+  /// @brief Makes the back buffer current if it differs.
+  /// @return true if a new snapshot was published.
+  bool publish()
+  {
+    const unsigned back = _front ^ 1U;
+    if ( memcmp(&_buf[back], &_buf[_front], sizeof(T)) == 0 )
+      return false;
+    _etag = fnv1a(&_buf[back], sizeof(T));
+    _front = back;
+    _version = _version + 1;
+    // Keep the new back buffer in step so edits can be partial.
+    _buf[back ^ 1U] = _buf[back];
+    return true;
+  } // publish()
+
+  /// @brief The published snapshot. Only valid until the next publish()
+  /// on a preemptive system; use read() there.
+  const T& current() const { return _buf[_front]; }
+
+  /// @brief Copies the published snapshot, retrying if a publish
+  /// happened during the copy.
+  void read(T& out) const
+  {
+    uint32_t v;
+    do
+    {
+      v = _version;
+      out = _buf[_front];
+    } while ( v != _version );
+  } // read()
+
+  /// @brief Increments with each published snapshot.
+  uint32_t version() const { return _version; }
+
+  /// @brief Hash of the current snapshot.
+  uint32_t etag() const { return _etag; }
+
+  /// @brief Formats the ETag header value, quotes included. Needs 11 bytes.
+  void format_etag(char* out, size_t len) const { snprintf(out, len, "\"%08x\"", static_cast<unsigned>(_etag)); }
+
+  /// @brief True if an If-None-Match header value names the current snapshot.
+  bool matches(const char* if_none_match) const
+  {
+    char etag[12];
+    format_etag(etag, sizeof(etag));
+    return if_none_match != nullptr && strstr(if_none_match, etag) != nullptr;
+  } // matches()
+
+private:
+  T _buf[2];
+  volatile unsigned _front {0};
+  volatile uint32_t _version {0};
+  volatile uint32_t _etag {0};
+}; // class SnapshotBuffer
+
+} // namespace SSW
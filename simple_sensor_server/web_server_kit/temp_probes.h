@@ -0,0 +1,132 @@
+// Non-blocking DS18B20 temperature probes.
+//
+// All probes on the OneWire bus are converted together: service() starts
+// one conversion for the whole bus, returns immediately, and comes back
+// for the results once the conversion time for the configured
+// resolution has passed. Results are read one probe per call so loop()
+// never spends more than a single scratchpad read on the bus. Readers
+// get the cached value from RAM.
+//
+// Probe ROM addresses are found once in begin() and cached, so each
+// read is addressed directly rather than searching the bus by index.
+#pragma once
+
+#include <Arduino.h>
+#include <DallasTemperature.h>
+
+class TempProbes
+{
+public:
+   static constexpr uint8_t MAX_PROBES = 4;
+
+   // bus: The DallasTemperature instance for the OneWire bus
+   // resolution: 9 - 12 bits. 10 bits converts in about 188 ms.
+   // period_ms: Time between conversions. Never shorter than the conversion time.
+   TempProbes(DallasTemperature& bus, uint8_t resolution = 10, uint32_t period_ms = 1000) :
+      _bus(bus),
+      _resolution(resolution < 9 ? 9 : (resolution > 12 ? 12 : resolution)),
+      _period_ms(period_ms)
+   {}
+
+   // Finds the probes and starts the first conversion.
+   void begin()
+   {
+      _bus.begin();
+      _count = 0;
+      for ( uint8_t i = 0; i < _bus.getDeviceCount() && _count < MAX_PROBES; ++i )
+      {
+         if ( _bus.getAddress(_probes[_count].addr, i) )
+         {
+            _bus.setResolution(_probes[_count].addr, _resolution);
+            ++_count;
+         }
+      }
+      _bus.setWaitForConversion(false);
+      Serial.println("DS18B20 probes found: " + String(_count));
+      _start(millis());
+   } // begin()
+
+   // Advances the conversion state machine. Call from loop().
+   void service()
+   {
+      const uint32_t now = millis();
+      if ( _count == 0 )
+         return;
+
+      if ( _next_read < _count )
+      {
+         // Collecting. Wait out the conversion time before the first read.
+         if ( now - _started_ms < conversion_ms() )
+            return;
+         _read(_probes[_next_read], now);
+         ++_next_read;
+      }
+      else if ( now - _started_ms >= ( _period_ms < conversion_ms() ? conversion_ms() : _period_ms ) )
+      {
+         _start(now);
+      }
+   } // service()
+
+   // Time a conversion takes at the configured resolution.
+   uint32_t conversion_ms() const { return (750U >> (12 - _resolution)) + 1U; }
+
+   uint8_t count() const { return _count; }
+
+   // True once probe i has produced a good reading.
+   bool valid(uint8_t i = 0) const { return i < _count && _probes[i].seq != 0; }
+
+   // The latest reading of probe i in degrees F. 0.0 until valid().
+   float temp_f(uint8_t i = 0) const { return i < _count ? _probes[i].temp_f : 0.0f; }
+
+   // millis() time of the latest reading of probe i.
+   uint32_t read_ms(uint8_t i = 0) const { return i < _count ? _probes[i].read_ms : 0U; }
+
+   // Increments with each good reading of probe i.
+   uint32_t sequence(uint8_t i = 0) const { return i < _count ? _probes[i].seq : 0U; }
+
+   // Bad reads (disconnected or power-on value) of probe i.
+   uint32_t errors(uint8_t i = 0) const { return i < _count ? _probes[i].errors : 0U; }
+
+   const uint8_t* address(uint8_t i) const { return i < _count ? _probes[i].addr : nullptr; }
+
+private:
+   struct Probe
+   {
+      DeviceAddress addr;
+      float    temp_f {0.0f};
+      uint32_t read_ms {0};
+      uint32_t seq {0};
+      uint32_t errors {0};
+   };
+
+   void _start(uint32_t now)
+   {
+      // Skip ROM + Convert T: every probe on the bus converts at once.
+      _bus.requestTemperatures();
+      _started_ms = now;
+      _next_read = 0;
+   } // _start()
+
+   void _read(Probe& p, uint32_t now)
+   {
+      float temp_c = _bus.getTempC(p.addr);
+      // 85.0 C is the power-on value of the scratchpad, i.e. the
+      // conversion didn't happen. Keep the previous reading.
+      if ( temp_c == DEVICE_DISCONNECTED_C || temp_c == 85.0f )
+      {
+         ++p.errors;
+         return;
+      }
+      p.temp_f = DallasTemperature::toFahrenheit(temp_c);
+      p.read_ms = now;
+      ++p.seq;
+   } // _read()
+
+   DallasTemperature& _bus;
+   uint8_t  _resolution;
+   uint32_t _period_ms;
+   Probe    _probes[MAX_PROBES];
+   uint8_t  _count {0};
+   uint8_t  _next_read {0};   // Next probe to collect; _count when idle
+   uint32_t _started_ms {0};  // When the current conversion started
+}; // class TempProbes
@@ -6,14 +6,19 @@
 // Requires the following Arduino libraries:
 // DallasTemperature
 // Wire
-// Adafruit_ADS1X15
+// Adafruit_ADS1X15 (version 2.x)
 
 #include <ESP8266WiFi.h>
 #include <WiFiClient.h> 
-#include <ESP8266WebServer.h>
 #include <DallasTemperature.h>
 #include <Wire.h>  // For the I2C interface
-#include <Adafruit_ADS1015.h>
+#include <Adafruit_ADS1X15.h>
+
+#include "temp_probes.h"
+#include "ads_sampler.h"
+#include "hysteresis.h"
+#include "http_backend_esp8266.h"
+#include "sensor_app.h"
 
 ADC_MODE(ADC_VCC) // Set the on-board ADC to read supply voltage.
 
@@ -22,10 +27,12 @@ const char *ssid = "Sens_AP";  // SSID of the network the ESP8266 sets up.
 const char *password = nullptr; // "password";  // password is unused to create an 'open' network.
 
 // Setup some components
-ESP8266WebServer  server(80);         // Start web server on port 80
+SSW::Esp8266Backend http_backend(80); // Listens on port 80
 OneWire           onewire(D1);        // The OneWire libary instance, attached to pin D1
 DallasTemperature sensor(&onewire);   // The DallasTemperature instance.
+TempProbes        probes(sensor, 10U); // Non-blocking conversions for every probe on the bus, 10-bit
 Adafruit_ADS1115  ads;                // 16-bit ADS1115
+AdsSampler        ads_sampler(ads, AdsSampler::NO_RDY_PIN, 0x03); // Continuous sampling of AIN0 (light) and AIN1 (soil), polled: no free pin for ALERT/RDY
 
 // Setup some constants
 static auto LED_PIN = D4;     // The onboard LED pin
@@ -38,19 +45,23 @@ static float SET_TEMP = 70.0; // Set temperature for thermostat behavior
 static unsigned DUSK = 22000; // The light ADC counts value at which we consider it dark.
 static unsigned DRY = 12000;  // The soil moisture ADC counts value at which we consider the plant
 							  // dry. NOTE: Higher numbers for dryer soil.
+static unsigned HISTORY_PERIOD_MS = 5000; // Time between sensor history samples in milliseconds
+static uint32_t RELAY_DWELL_MS = 5000;    // Minimum time a relay stays on or off
+static uint32_t SNAPSHOT_PERIOD_MS = 1000; // Time between refreshes of the web page values
+static uint32_t VCC_PERIOD_MS = 10000;     // Time between supply voltage reads
 
 
 // Forward function declarations.  These functions are defined after the loop() function.
 static void do_flashing_led();
-static void do_thermostat();
-static void do_lamp_control();
-static void do_soil_moisture_monitor();
+static void do_controls();
+static void do_history();
+static void do_snapshot();
+static void do_events();
 static void init_sensor();
-static float read_temp();
+static float read_temp(uint8_t probe = 0);
 static float read_vcc();
 static void init_ads();
 static int16_t read_ads(unsigned input);
-static char const* get_header();
 
 // Some global state
 struct State
@@ -58,25 +69,86 @@ struct State
    bool relay_1;  // Thermostat
    bool relay_2;  // Lamp
    bool is_dry;   // Moisture LED
+   float temp;       // Latest temperature reading
+   int16_t light;    // Latest light level reading
+   int16_t moisture; // Latest soil moisture reading
 }; // State
 static State global_state;
 
-// This function handles requests to http://192.168.4.1/
-void handleRoot()
+// The web server, serving the pages and API in sensor_app.h.
+static SensorServer<SSW::Esp8266Backend> server(http_backend);
+static_assert(TempProbes::MAX_PROBES <= MAX_PROBES, "The snapshot must hold every probe");
+
+////////////////////////////////////////////////////////////////////////////////
+// Controllers
+////////////////////////////////////////////////////////////////////////////////
+
+// Sensor inputs for the controllers. They report no reading until the
+// sampler has one, and record the latest value in global_state for the
+// web page and the history.
+struct TempInput
 {
-   Serial.println("Serving request to /.");
-   // Report our status
-   String body = String("<html>"+String(get_header())+"<body>")
-	  + "<h1>Temperature: " + String(read_temp()) + "</h1>"
-      + "<h1>Supply Voltage: " + String(read_vcc()) + " V</h1>"
-	  + "<h1>Light Level: " + String(read_ads(0)) + "</h1>"
-	  + "<h1>Soil moisture: " + String(read_ads(1)) + "</h1>"
-	  + "<h1>Relay 1: " + String(global_state.relay_1 ? "ON" : "OFF") + "</h1>"
-	  + "<h1>Relay 2: " + String(global_state.relay_2 ? "ON" : "OFF") + "</h2>"
-	  + "<h1>Plant moisture: " + String(global_state.is_dry ? "DRY" : "OK") + "</h2>"
-	  + "</body></html>";
-   server.send(200, "text/html", body);
-}
+   using value_type = float;
+   bool read(float& v)
+   {
+	  if ( !probes.valid() )
+		 return false;
+	  v = global_state.temp = read_temp();
+	  return true;
+   }
+}; // TempInput
+
+struct AdsInput
+{
+   using value_type = int32_t;
+   unsigned input;
+   int16_t& latest;
+   bool read(int32_t& v)
+   {
+	  if ( !ads_sampler.available(input) )
+		 return false;
+	  v = latest = read_ads(input);
+	  return true;
+   }
+}; // AdsInput
+
+// Relays and the LED are on when their pin is LOW. Only written when the
+// controller changes state.
+struct ActiveLowPin
+{
+   uint8_t pin;
+   bool& state;
+   void write(bool on)
+   {
+	  state = on;
+	  digitalWrite(pin, on ? LOW : HIGH);
+   }
+}; // ActiveLowPin
+
+static TempInput    temp_input;
+static AdsInput     light_input {0, global_state.light};
+static AdsInput     moisture_input {1, global_state.moisture};
+static ActiveLowPin relay_1_output {static_cast<uint8_t>(RELAY_1), global_state.relay_1};
+static ActiveLowPin relay_2_output {static_cast<uint8_t>(RELAY_2), global_state.relay_2};
+static ActiveLowPin water_output {static_cast<uint8_t>(WATER_PIN), global_state.is_dry};
+
+// Relay 1 turns on when the temperature falls below the set temperature.
+// The band is 1% of the set temperature either side.
+static SSW::Hysteresis<TempInput, ActiveLowPin, SSW::ActiveBelow> thermostat(temp_input, relay_1_output,
+   {SET_TEMP, 0.01f * SET_TEMP, RELAY_DWELL_MS, RELAY_DWELL_MS});
+
+// Relay 2 turns on when the light level falls below DUSK.
+static SSW::Hysteresis<AdsInput, ActiveLowPin, SSW::ActiveBelow> lamp_control(light_input, relay_2_output,
+   {static_cast<int32_t>(DUSK), static_cast<int32_t>(DUSK / 100), RELAY_DWELL_MS, RELAY_DWELL_MS});
+
+// The water LED turns on when the moisture counts rise above DRY.
+// NOTE: Higher numbers mean dryer soil, lower numbers mean moister soil.
+static SSW::Hysteresis<AdsInput, ActiveLowPin, SSW::ActiveAbove> moisture_monitor(moisture_input, water_output,
+   {static_cast<int32_t>(DRY), static_cast<int32_t>(DRY / 100)});
+
+static SSW::ControllerTable<decltype(thermostat), decltype(lamp_control), decltype(moisture_monitor)>
+   controllers(thermostat, lamp_control, moisture_monitor);
+
 
 void setup()
 {
@@ -100,8 +172,8 @@ void setup()
 	IPAddress myIP = WiFi.softAPIP();
 	Serial.print("AP IP address: ");
 	Serial.println(myIP);
-	server.on("/", handleRoot);
-	server.begin();
+	attach_routes(server);
+	http_backend.begin();
 	Serial.println("HTTP server started");
 
 	// Initialize the I2C interface with our selected pins.
@@ -111,26 +183,36 @@ void setup()
 	// Initialize the DS18B20 temperature sensor.
 	init_sensor();
 
-	// Initialize the ADS1015 A/D Converter.  This reads the light-level
+	// Initialize the ADS1115 A/D Converter.  This reads the light-level
 	// and the soil moisture.
 	init_ads();
 } // setup()
 
 void loop() {
-   // This is where all of the heavy lifting occurs.
-   server.handleClient();
+   // Accept, read and write on every connection; never blocks.
+   server.poll(millis());
+
+   // Start or collect DS18B20 conversions. Never waits on the bus.
+   probes.service();
+
+   // Collect the latest ADS1115 conversion, if one is ready.
+   ads_sampler.service();
 
    // Flash the LED
    do_flashing_led();
 
-   // Check the temperature and control relay 1 based on the reading.
-   do_thermostat();
+   // Check the temperature, light and soil moisture and switch relay 1,
+   // relay 2 and the water LED.
+   do_controls();
+
+   // Record the latest readings in the sensor history
+   do_history();
 
-   // Check the light and control relay 2
-   do_lamp_control();
+   // Refresh the values served on the web page
+   do_snapshot();
 
-   // Check the soil moisture
-   do_soil_moisture_monitor();
+   // Push changes to the live page
+   do_events();
 
    // Take a 10msec rest
    delay(10);
@@ -160,117 +242,80 @@ void do_flashing_led()
    }
 } // do_flashing_led()
 
-void do_thermostat()
+void do_controls()
 {
-   auto temp = read_temp();
-   float hysteresis = 0.01 * SET_TEMP; // Set hysteresis to 1% of the set temp
-   if ( !global_state.relay_1 && (temp < ( SET_TEMP - hysteresis)) )
-   {
-	  // The relay is off and we've fallen far enough below the set temperature
-	  // to turn it on.
-	  global_state.relay_1 = true;
-   }
-   else if ( global_state.relay_1 && (temp > (SET_TEMP + hysteresis)) )
-   {
-	  // The relay is on and the temperature is risen far enough above teh set
-	  // temperature to turn it off.
-	  global_state.relay_1 = false;
-   }
-   
-   if ( global_state.relay_1 )
-	  digitalWrite(RELAY_1, LOW);
-   else
-	  digitalWrite(RELAY_1, HIGH);
-} // do_thermostat()
+   controllers.update(millis());
+} // do_controls()
 
-void do_lamp_control()
+void do_history()
 {
-   auto light = read_ads(0);
-//   Serial.println("Light: " + String(light));
-   unsigned hysteresis = static_cast<unsigned>(std::floor(0.01 * DUSK));
-
-   if ( !global_state.relay_2 && (light < ( DUSK - hysteresis)) )
-   {
-	  // The relay is off and we've fallen far enough below the set DUSK level
-	  // to turn it on.
-	  global_state.relay_2 = true;
-   }
-   else if ( global_state.relay_2 && (light > (DUSK + hysteresis)) )
+   // Sample the latest readings into the history buffers. Times are
+   // seconds since boot; the access point has no wall clock.
+   static unsigned next_sample_time = millis() + HISTORY_PERIOD_MS;
+   if ( static_cast<int32_t>(millis() - next_sample_time) >= 0 )
    {
-	  // The relay is on and the temperature is risen far enough above the set
-	  // DUSK level to turn it off.
-	  global_state.relay_2 = false;
+	  uint32_t now = millis() / 1000;
+	  temp_history.add_float(now, global_state.temp);
+	  light_history.add(now, global_state.light);
+	  moisture_history.add(now, global_state.moisture);
+	  next_sample_time = millis() + HISTORY_PERIOD_MS;
    }
-   
-   if ( global_state.relay_2 )
-	  digitalWrite(RELAY_2, LOW);
-   else
-	  digitalWrite(RELAY_2, HIGH);
-} // do_lamp_control()
+} // do_history()
 
-void do_soil_moisture_monitor()
+void do_snapshot()
 {
-   // Note that this is just like the lamp control function above. The
-   // right thing to do from a software development perspective is to
-   // factor out the common algorithm and use it for both.  However,
-   // I've left it like this to make it a little bit easier to understand
-   // and to make it easier to create different behaviors for the two
-   // controllers.
-   // NOTE:  The moister the soil, the lower the moisture counts will be.
-   // Higher numbers mean dryer soil, lower numbers mean moister soil.
-   auto moisture = read_ads(1);
-//   Serial.println("Moisture: " + String(moisture));
-   unsigned hysteresis = static_cast<unsigned>(std::floor(0.01 * DRY));
-
-   if ( !global_state.is_dry && (moisture > ( DRY - hysteresis)) )
-   {
-	  // The plant was moist and the moisture counts have risen far enough
-	  // above the DRY threshold to consider the plant dry.
-	  global_state.is_dry = true;
-   }
-   else if ( global_state.is_dry && (moisture < (DRY + hysteresis)) )
+   static uint32_t last_snapshot = 0;
+   static uint32_t last_vcc = 0;
+   static bool first = true;
+   const uint32_t now = millis();
+   if ( !first && now - last_snapshot < SNAPSHOT_PERIOD_MS )
+	  return;
+
+   // Fill the back buffer, then publish it in one step. Unchanged values
+   // leave the current snapshot, and its ETag, alone.
+   Snapshot& snap = state.edit();
+   snap.format = SNAPSHOT_FORMAT;
+
+   // read_vcc() takes about 20 ms, so the supply is read less often.
+   if ( first || now - last_vcc >= VCC_PERIOD_MS )
    {
-	  // The plant was dry and the moisture counts have fallen far enough below
-	  // the DRY threshold to set is_dry to false.
-	  global_state.is_dry = false;
+	  snap.vcc = static_cast<uint16_t>(read_vcc() * 1000.0f + 0.5f);
+	  last_vcc = now;
    }
-   
-   if ( global_state.is_dry )
-	  digitalWrite(WATER_PIN, LOW);
-   else
-	  digitalWrite(WATER_PIN, HIGH);
-} // do_soil_moisture_monitor()
+   snap.probes = probes.count();
+   for ( uint8_t i = 0; i < snap.probes; ++i )
+	  snap.temp[i] = static_cast<int16_t>(lroundf(read_temp(i) * 100.0f));
+   snap.light = global_state.light;
+   snap.moisture = global_state.moisture;
+   snap.relay_1 = global_state.relay_1;
+   snap.relay_2 = global_state.relay_2;
+   snap.is_dry = global_state.is_dry;
+   state.publish();
+
+   last_snapshot = now;
+   first = false;
+} // do_snapshot()
+
+void do_events()
+{
+   publish_changes(server, millis());
+} // do_events()
 
 ////////////////////////////////////////////////////////////////////////////////
 // DS18B20 Temperature Sensor
 ////////////////////////////////////////////////////////////////////////////////
 
-// Initializes the DS18B20 sensor
+// Initializes the DS18B20 sensors and starts the first conversion.
 void init_sensor()
 {
-   sensor.begin();
-
-   sensor.setResolution(10U);
+   probes.begin();
 } // initsensor()
 
-// Reads the temperature from the DS18B20 sensor.
-float read_temp()
+// Returns the latest temperature from a DS18B20 probe. This is the cached
+// result of the last conversion; it does not touch the bus.
+float read_temp(uint8_t probe)
 {
-   static constexpr unsigned READ_TIMEOUT = { 500U }; // Set the read timeout so we don't get stuck
-   bool dummy = false;
-   float tempF = 0.0;
-   float tempC = 0.0;
-   unsigned end_time = millis() + READ_TIMEOUT;
-	  
-   do
-   {
-	  sensor.requestTemperatures();
-	  delay(20);
-	  tempC = sensor.getTempCByIndex(0);
-	  tempF = sensor.getTempFByIndex(0);
-   } while ( ((tempC == 85.0) || (tempC == DEVICE_DISCONNECTED_C)) && (millis() < end_time) );
-	  
-   return tempF;
+   return probes.temp_f(probe);
 } // read_temp()
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -294,7 +339,7 @@ float read_vcc()
 } // read_vcc()
 
 ////////////////////////////////////////////////////////////////////////////////
-// ADS1015
+// ADS1115
 ////////////////////////////////////////////////////////////////////////////////
 
 void init_ads()
@@ -317,20 +362,15 @@ void init_ads()
    // ads.setGain(GAIN_SIXTEEN);    // 16x gain  +/- 0.256V  1 bit = 0.125mV  0.0078125mV
   
    ads.begin();
+
+   // Convert continuously, switching channels as each result is read.
+   ads_sampler.begin();
 } // init_ads()
 
 int16_t read_ads(unsigned input)
 {
-   // Reads one input (AIN0-AIN3) are (0-3), respectively
-   return ads.readADC_SingleEnded(input);
+   // Returns the latest sample of one input (AIN0-AIN3 are 0-3,
+   // respectively). The sampler keeps these up to date; no I2C traffic.
+   return ads_sampler.latest(input);
 } // read_ads()
 
-char const* get_header()
-{
-   // Returns the HTML header for the page.
-   static char const* hdr = R"EOF(<head>
-      <meta http-equiv="refresh" content="2; URL=http://192.168.4.1/">
-   </head>)EOF";
-   
-   return hdr;
-} // get_header()
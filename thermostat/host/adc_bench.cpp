@@ -0,0 +1,59 @@
+// Throughput of SSW::AdcDecimator, in nanoseconds per raw sample, for
+// each median window. The light sensor task filters 20000 samples a
+// second, so at a few ns/sample on the host the filter is a small
+// fraction of the task's time; run it on the device to get the real
+// figure.
+//
+// usage: adc_bench [--samples N]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "adc_filter.h"
+
+template <unsigned MEDIAN_N>
+static double bench(const std::vector<uint16_t>& samples, uint32_t& sink)
+{
+   SSW::AdcDecimator<MEDIAN_N, 4> f;
+   const size_t CHUNK = 1024; // Samples per DMA read, as LightSensor drains them
+   const auto start = std::chrono::steady_clock::now();
+   for ( size_t i = 0; i < samples.size(); i += CHUNK )
+   {
+      f.push(&samples[i], samples.size() - i < CHUNK ? samples.size() - i : CHUNK);
+      sink += f.take();
+   }
+   const auto end = std::chrono::steady_clock::now();
+   return std::chrono::duration<double, std::nano>(end - start).count() / samples.size();
+}
+
+int main(int argc, char** argv)
+{
+   size_t n = 20000000;
+   for ( int i = 1; i < argc; ++i )
+   {
+      if ( strcmp(argv[i], "--samples") == 0 && i + 1 < argc )
+         n = static_cast<size_t>(atol(argv[++i]));
+      else
+      {
+         fprintf(stderr, "usage: %s [--samples N]\n", argv[0]);
+         return 2;
+      }
+   }
+
+   // A noisy level with occasional spikes, like the light sensor
+   std::mt19937 rng(1);
+   std::normal_distribution<float> noise(1500.0f, 20.0f);
+   std::vector<uint16_t> samples(n);
+   for ( size_t i = 0; i < n; ++i )
+      samples[i] = rng() % 1000 == 0 ? 4095 : static_cast<uint16_t>(noise(rng));
+
+   uint32_t sink = 0;
+   printf("%-10s %12s\n", "median", "ns/sample");
+   printf("%-10s %12.2f\n", "none", bench<1>(samples, sink));
+   printf("%-10s %12.2f\n", "3", bench<3>(samples, sink));
+   printf("%-10s %12.2f\n", "5", bench<5>(samples, sink));
+   return sink == 1 ? 1 : 0;
+}
@@ -0,0 +1,83 @@
+#!/bin/sh
+# Builds LVGL for Linux with the thermostat's lv_conf.h, and the UI
+# tools against it, into ./build.
+#
+#   ./build.sh                       Fetches LVGL on first use
+#   LVGL_DIR=~/src/lvgl ./build.sh   Uses an existing v8.3 checkout
+#   UPDATE_GOLDEN=1 ./build.sh       Records screen1's frame hashes
+#   CFLAGS="-O1 -g -fsanitize=address" CXXFLAGS="-O1 -g -fsanitize=address" ./build.sh
+set -e
+cd "$(dirname "$0")"
+CC=${CC:-gcc}
+CXX=${CXX:-g++}
+CFLAGS=${CFLAGS:--O2 -g}
+CXXFLAGS=${CXXFLAGS:--O2 -g}
+LVGL_VERSION=v8.3.11
+LVGL_DIR=${LVGL_DIR:-build/lvgl}
+# Compressed fonts are supported here, off or not on the device, so
+# font_bench can compare them
+INC="-I../include -Ishims -I$LVGL_DIR/.. -DLV_CONF_INCLUDE_SIMPLE -DLV_LVGL_H_INCLUDE_SIMPLE -I$LVGL_DIR -DLV_USE_FONT_COMPRESSED=1"
+mkdir -p build/obj
+
+if [ ! -f "$LVGL_DIR/lvgl.h" ]; then
+   git clone --depth 1 --branch $LVGL_VERSION https://github.com/lvgl/lvgl.git "$LVGL_DIR"
+fi
+
+# LVGL itself, once
+if [ ! -f build/liblvgl.a ]; then
+   find "$LVGL_DIR/src" -name '*.c' | while read -r src; do
+      obj=build/obj/lvgl_$(echo "$src" | sed 's|.*/src/||; s|/|_|g; s|\.c$|.o|')
+      $CC $CFLAGS $INC -c "$src" -o "$obj"
+   done
+   ar rcs build/liblvgl.a build/obj/lvgl_*.o
+fi
+
+# The reduced screen fonts, and compressed copies of them, if
+# lv_font_conv is available
+TTF="$LVGL_DIR/scripts/built_in_font/Montserrat-Medium.ttf"
+FONTS=""
+FONT_DEFS=""
+if python3 ../tools/fonts/make_fonts.py --ttf "$TTF"; then
+   for src in ../src/fonts/*.c; do
+      obj=build/obj/$(basename "$src" .c).o
+      $CC $CFLAGS $INC -c "$src" -o "$obj"
+      FONTS="$FONTS $obj"
+   done
+   FONT_DEFS="-DHAVE_SUBSET_FONTS=1 -DUI_SUBSET_FONTS=1"
+   if python3 ../tools/fonts/make_fonts.py --ttf "$TTF" --compress --suffix _z --out build/fonts_z; then
+      for src in build/fonts_z/*.c; do
+         obj=build/obj/$(basename "$src" .c).o
+         $CC $CFLAGS $INC -c "$src" -o "$obj"
+         FONTS="$FONTS $obj"
+      done
+      FONT_DEFS="$FONT_DEFS -DHAVE_COMPRESSED_FONTS=1"
+   fi
+   # Flash cost of each font: text + data
+   size build/obj/lvgl_font_lv_font_montserrat_18.o build/obj/lvgl_font_lv_font_montserrat_22.o \
+      build/obj/lvgl_font_lv_font_montserrat_42.o $FONTS
+else
+   echo "build.sh: benchmarking the stock fonts only"
+fi
+
+CXXALL="$CXX -std=c++17 -Wall -Wextra $CXXFLAGS $INC $FONT_DEFS"
+$CXXALL -o build/font_bench font_bench.cpp shims/arduino.cpp $FONTS build/liblvgl.a
+$CXXALL -o build/screen_render screen_render.cpp ../src/screen1.cpp shims/arduino.cpp $FONTS build/liblvgl.a
+echo "Built build/font_bench and build/screen_render"
+
+# Check screen1's frames against the committed hashes for this font set.
+# A missing file is an error. After an intended change to the screen, or
+# a new LVGL version or font set, record them with UPDATE_GOLDEN=1,
+# review build/frames and commit the file.
+GOLDEN=scripts/screen1.golden
+if [ -n "$FONT_DEFS" ]; then
+   GOLDEN=scripts/screen1.subset.golden
+fi
+if [ -n "$UPDATE_GOLDEN" ]; then
+   build/screen_render --out build/frames --golden "$GOLDEN" --update scripts/screen1.txt
+   echo "build.sh: recorded $GOLDEN from LVGL $LVGL_VERSION; review build/frames and commit it"
+elif [ -f "$GOLDEN" ]; then
+   build/screen_render --out build/frames --golden "$GOLDEN" scripts/screen1.txt
+else
+   echo "build.sh: $GOLDEN is missing; record it with UPDATE_GOLDEN=1 ./build.sh" >&2
+   exit 1
+fi
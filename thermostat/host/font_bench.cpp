@@ -0,0 +1,132 @@
+// Render benchmarks for the temperature readout fonts.
+//
+// Runs LVGL headless on a 320x240 RGB565 display, as on the device, and
+// times two things for each font:
+//   glyph   lv_font_get_glyph_bitmap() for the digits, i.e. the cost of
+//           fetching (and for compressed fonts decompressing) a glyph
+//   label   A 42 pt label changing value and the screen refreshing,
+//           as the temperature readout does
+//
+// The fonts are the stock lv_font_montserrat_42, the reduced ui_font_42
+// from tools/fonts/fonts.json when build.sh could generate it, and its
+// compressed copy ui_font_42_z.
+//
+// usage: font_bench [--iterations N]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <lvgl.h>
+
+#if HAVE_SUBSET_FONTS
+LV_FONT_DECLARE(ui_font_42);
+#endif
+#if HAVE_COMPRESSED_FONTS
+LV_FONT_DECLARE(ui_font_42_z);
+#endif
+
+static const int SCREEN_WIDTH = 320;
+static const int SCREEN_HEIGHT = 240;
+static const char DIGITS[] = "0123456789.";
+
+static lv_color_t framebuffer[ SCREEN_WIDTH * SCREEN_HEIGHT ];
+
+static void flush(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color_p)
+{
+   // Copy the area as a panel would receive it
+   const int32_t w = area->x2 - area->x1 + 1;
+   for ( int32_t y = area->y1; y <= area->y2; ++y )
+   {
+      memcpy(&framebuffer[ y * SCREEN_WIDTH + area->x1 ], color_p, w * sizeof(lv_color_t));
+      color_p += w;
+   }
+   lv_disp_flush_ready(disp);
+}
+
+static double now_us()
+{
+   using namespace std::chrono;
+   return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count() / 1000.0;
+}
+
+static double bench_glyph(const lv_font_t* font, unsigned iterations)
+{
+   uintptr_t sink = 0;
+   const double start = now_us();
+   for ( unsigned i = 0; i < iterations; ++i )
+      for ( const char* p = DIGITS; *p != '\0'; ++p )
+         sink += reinterpret_cast<uintptr_t>(lv_font_get_glyph_bitmap(font, static_cast<uint32_t>(*p)));
+   const double elapsed = now_us() - start;
+   if ( sink == 1 )
+      puts("");
+   return elapsed * 1000.0 / (iterations * (sizeof(DIGITS) - 1));
+}
+
+static double bench_label(const lv_font_t* font, unsigned iterations)
+{
+   lv_obj_t* label = lv_label_create(lv_scr_act());
+   lv_obj_set_style_text_font(label, font, LV_PART_MAIN);
+   lv_obj_set_width(label, 200);
+   lv_obj_set_style_text_align(label, LV_TEXT_ALIGN_CENTER, 0);
+   lv_obj_center(label);
+   lv_label_set_text(label, "00.0");
+   lv_refr_now(nullptr);
+
+   const double start = now_us();
+   for ( unsigned i = 0; i < iterations; ++i )
+   {
+      lv_label_set_text_fmt(label, "%u.%u", 60U + (i / 10U) % 30U, i % 10U);
+      lv_refr_now(nullptr);
+   }
+   const double elapsed = now_us() - start;
+   lv_obj_del(label);
+   lv_refr_now(nullptr);
+   return elapsed / iterations;
+}
+
+static void run(const char* name, const lv_font_t* font, unsigned iterations)
+{
+   const double glyph_ns = bench_glyph(font, iterations * 10U);
+   const double label_us = bench_label(font, iterations);
+   printf("%-24s %10.1f %12.1f\n", name, glyph_ns, label_us);
+}
+
+int main(int argc, char** argv)
+{
+   unsigned iterations = 2000;
+   for ( int i = 1; i < argc; ++i )
+   {
+      if ( strcmp(argv[i], "--iterations") == 0 && i + 1 < argc )
+         iterations = static_cast<unsigned>(atoi(argv[++i]));
+      else
+      {
+         fprintf(stderr, "usage: %s [--iterations N]\n", argv[0]);
+         return 2;
+      }
+   }
+
+   lv_init();
+   static lv_disp_draw_buf_t draw_buf;
+   static lv_color_t buf[ SCREEN_WIDTH * 20 ];
+   lv_disp_draw_buf_init(&draw_buf, buf, nullptr, SCREEN_WIDTH * 20);
+   static lv_disp_drv_t disp_drv;
+   lv_disp_drv_init(&disp_drv);
+   disp_drv.hor_res = SCREEN_WIDTH;
+   disp_drv.ver_res = SCREEN_HEIGHT;
+   disp_drv.flush_cb = flush;
+   disp_drv.draw_buf = &draw_buf;
+   lv_disp_drv_register(&disp_drv);
+
+   printf("%-24s %10s %12s\n", "font", "glyph_ns", "label_us");
+   run("lv_font_montserrat_42", &lv_font_montserrat_42, iterations);
+#if HAVE_SUBSET_FONTS
+   run("ui_font_42", &ui_font_42, iterations);
+#else
+   puts("ui_font_42 was not generated; see tools/fonts/make_fonts.py");
+#endif
+#if HAVE_COMPRESSED_FONTS
+   run("ui_font_42_z", &ui_font_42_z, iterations);
+#endif
+   return 0;
+}
@@ -0,0 +1,101 @@
+// Minimal PNG writer: 8-bit RGB, no filtering, zlib "stored" (uncompressed)
+// blocks. The files are larger than they need be but any viewer or image
+// diff tool reads them, and there is no dependency on zlib or libpng.
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace png
+{
+
+inline uint32_t crc32(const uint8_t* data, size_t len, uint32_t crc = 0)
+{
+   static uint32_t table[256];
+   if ( table[1] == 0 )
+   {
+      for ( uint32_t n = 0; n < 256; ++n )
+      {
+         uint32_t c = n;
+         for ( int k = 0; k < 8; ++k )
+            c = ( c & 1U ) ? 0xEDB88320U ^ ( c >> 1 ) : c >> 1;
+         table[n] = c;
+      }
+   }
+   crc = ~crc;
+   for ( size_t i = 0; i < len; ++i )
+      crc = table[( crc ^ data[i] ) & 0xFFU] ^ ( crc >> 8 );
+   return ~crc;
+}
+
+inline void put32(std::vector<uint8_t>& out, uint32_t v)
+{
+   out.push_back(static_cast<uint8_t>(v >> 24));
+   out.push_back(static_cast<uint8_t>(v >> 16));
+   out.push_back(static_cast<uint8_t>(v >> 8));
+   out.push_back(static_cast<uint8_t>(v));
+}
+
+inline void chunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data)
+{
+   put32(out, static_cast<uint32_t>(data.size()));
+   const size_t start = out.size();
+   out.insert(out.end(), type, type + 4);
+   out.insert(out.end(), data.begin(), data.end());
+   put32(out, crc32(&out[start], out.size() - start));
+}
+
+/// @brief Writes rows of 8-bit RGB.
+/// @return false on an I/O error
+inline bool write_rgb(const char* path, int width, int height, const uint8_t* rgb)
+{
+   // Raw scanlines, each preceded by filter type 0
+   std::vector<uint8_t> raw;
+   raw.reserve(static_cast<size_t>(height) * (width * 3 + 1));
+   for ( int y = 0; y < height; ++y )
+   {
+      raw.push_back(0);
+      raw.insert(raw.end(), rgb + y * width * 3, rgb + (y + 1) * width * 3);
+   }
+
+   // zlib stream of stored blocks, at most 65535 bytes each
+   std::vector<uint8_t> z {0x78, 0x01};
+   for ( size_t pos = 0; pos < raw.size() || pos == 0; )
+   {
+      const size_t n = raw.size() - pos < 65535U ? raw.size() - pos : 65535U;
+      z.push_back(pos + n == raw.size() ? 1 : 0);
+      z.push_back(static_cast<uint8_t>(n));
+      z.push_back(static_cast<uint8_t>(n >> 8));
+      z.push_back(static_cast<uint8_t>(~n));
+      z.push_back(static_cast<uint8_t>(~n >> 8));
+      z.insert(z.end(), raw.begin() + pos, raw.begin() + pos + n);
+      pos += n;
+      if ( n == 0 )
+         break;
+   }
+   uint32_t a = 1, b = 0;
+   for ( uint8_t c : raw )
+   {
+      a = (a + c) % 65521U;
+      b = (b + a) % 65521U;
+   }
+   put32(z, (b << 16) | a);
+
+   std::vector<uint8_t> out {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+   std::vector<uint8_t> ihdr;
+   put32(ihdr, static_cast<uint32_t>(width));
+   put32(ihdr, static_cast<uint32_t>(height));
+   ihdr.insert(ihdr.end(), {8, 2, 0, 0, 0}); // 8-bit, RGB, deflate, no filter, no interlace
+   chunk(out, "IHDR", ihdr);
+   chunk(out, "IDAT", z);
+   chunk(out, "IEND", {});
+
+   FILE* f = fopen(path, "wb");
+   if ( f == nullptr )
+      return false;
+   const bool ok = fwrite(out.data(), 1, out.size(), f) == out.size();
+   return fclose(f) == 0 && ok;
+}
+
+} // namespace png
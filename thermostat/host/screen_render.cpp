@@ -0,0 +1,342 @@
+// Headless renderer for screen1.
+//
+// Builds src/screen1.cpp for Linux and runs it on LVGL with an in-memory
+// 320x240 RGB565 display, the same size, colour format and draw buffers
+// as the device. A script drives the screen's update functions and the
+// clock; LVGL time is virtual, so animations play out identically on
+// every run. Frames can be dumped as PNG and their hashes checked
+// against a golden file.
+//
+// usage: screen_render [--out DIR] [--csv FILE] [--golden FILE [--update]] [SCRIPT]
+//   SCRIPT     Script file (scripts/screen1.txt)
+//   --out      Directory for the 'frame' PNGs (build/frames)
+//   --csv      Per-refresh statistics, one row per refresh
+//   --golden   File of 'name hash' lines; each frame's framebuffer hash
+//              must match. Exits 1 on a mismatch.
+//   --update   Write the golden file instead of checking it
+//
+// Script commands, one per line ('#' starts a comment):
+//   clock YYYY-MM-DD HH:MM        Sets the wall clock; update_time_label()
+//   temp DEG_F HUMID              update_temp_humid_display()
+//   set_temp DEG_F                lr_set_temp_DE.update()
+//   outside DEG_F HUMID BARO      update_outside_temp()
+//   fam_room DEG_F                update_fam_room_temp()
+//   stale outside|fam_room 0|1    set_outside_temp_stale() and so on
+//   lamp 0|1                      set_lamp_button_state()
+//   run MS                        Runs the main loop's GUI step for MS
+//   frame NAME                    Writes NAME.png and checks its hash
+//
+// Per refresh it records the render time (wall clock), the invalidated
+// areas LVGL redrew and their size, and the flushes to the display.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include <Arduino.h>
+#include <lvgl.h>
+
+#include "screen1.h"
+#include "png_writer.h"
+
+static const int SCREEN_WIDTH = 320;
+static const int SCREEN_HEIGHT = 240;
+static const int DISP_BUF_LINES = 20; // As main.cpp
+
+static lv_color_t framebuffer[ SCREEN_WIDTH * SCREEN_HEIGHT ];
+
+/// @brief One display refresh.
+struct Refresh
+{
+   uint32_t t_ms;
+   double   render_us;
+   uint32_t areas;     ///< Invalidated areas after LVGL joined them
+   uint32_t area_px;
+   uint32_t flushes;
+   uint32_t flush_px;
+};
+static Refresh current;
+static bool refreshed = false;
+
+static void flush(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color_p)
+{
+   const int32_t w = area->x2 - area->x1 + 1;
+   for ( int32_t y = area->y1; y <= area->y2; ++y )
+   {
+      memcpy(&framebuffer[ y * SCREEN_WIDTH + area->x1 ], color_p, w * sizeof(lv_color_t));
+      color_p += w;
+   }
+   current.flushes++;
+   current.flush_px += w * ( area->y2 - area->y1 + 1 );
+   lv_disp_flush_ready(disp);
+}
+
+static void render_start(lv_disp_drv_t *)
+{
+   const lv_disp_t* disp = _lv_refr_get_disp_refreshing();
+   for ( uint16_t i = 0; i < disp->inv_p; ++i )
+   {
+      if ( disp->inv_area_joined[i] )
+         continue;
+      current.areas++;
+      current.area_px += lv_area_get_size(&disp->inv_areas[i]);
+   }
+   refreshed = true;
+}
+
+static uint32_t fnv1a(const void* data, size_t len)
+{
+   const uint8_t* p = static_cast<const uint8_t*>(data);
+   uint32_t h = 2166136261U;
+   for ( size_t i = 0; i < len; ++i )
+   {
+      h ^= p[i];
+      h *= 16777619U;
+   }
+   return h;
+}
+
+static bool write_frame(const std::string& path)
+{
+   static uint8_t rgb[ SCREEN_WIDTH * SCREEN_HEIGHT * 3 ];
+   for ( int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; ++i )
+   {
+      uint16_t v = framebuffer[i].full;
+#if LV_COLOR_16_SWAP
+      v = static_cast<uint16_t>( ( v >> 8 ) | ( v << 8 ) );
+#endif
+      const uint8_t r = ( v >> 11 ) & 0x1F, g = ( v >> 5 ) & 0x3F, b = v & 0x1F;
+      rgb[i * 3] = static_cast<uint8_t>( ( r << 3 ) | ( r >> 2 ) );
+      rgb[i * 3 + 1] = static_cast<uint8_t>( ( g << 2 ) | ( g >> 4 ) );
+      rgb[i * 3 + 2] = static_cast<uint8_t>( ( b << 3 ) | ( b >> 2 ) );
+   }
+   return png::write_rgb(path.c_str(), SCREEN_WIDTH, SCREEN_HEIGHT, rgb);
+}
+
+/// @brief The GUI part of loop(): commit the view model, run LVGL.
+static void step(std::vector<Refresh>& log)
+{
+   current = Refresh();
+   current.t_ms = host_millis;
+   refreshed = false;
+   commit_screen();
+   const auto start = std::chrono::steady_clock::now();
+   lv_timer_handler();
+   const auto end = std::chrono::steady_clock::now();
+   if ( refreshed )
+   {
+      current.render_us = std::chrono::duration<double, std::micro>(end - start).count();
+      log.push_back(current);
+   }
+}
+
+static std::map<std::string, uint32_t> read_golden(const char* path)
+{
+   std::map<std::string, uint32_t> golden;
+   FILE* f = fopen(path, "r");
+   if ( f == nullptr )
+      return golden;
+   char name[128];
+   unsigned hash;
+   while ( fscanf(f, "%127s %x", name, &hash) == 2 )
+      golden[name] = hash;
+   fclose(f);
+   return golden;
+}
+
+static double percentile(std::vector<double> v, double p)
+{
+   if ( v.empty() )
+      return 0.0;
+   std::sort(v.begin(), v.end());
+   return v[std::min(v.size() - 1, static_cast<size_t>(p / 100.0 * v.size()))];
+}
+
+int main(int argc, char** argv)
+{
+   const char* script_path = "scripts/screen1.txt";
+   std::string out_dir = "build/frames";
+   const char* csv_path = nullptr;
+   const char* golden_path = nullptr;
+   bool update = false;
+   for ( int i = 1; i < argc; ++i )
+   {
+      const bool has_value = i + 1 < argc;
+      if ( strcmp(argv[i], "--out") == 0 && has_value )
+         out_dir = argv[++i];
+      else if ( strcmp(argv[i], "--csv") == 0 && has_value )
+         csv_path = argv[++i];
+      else if ( strcmp(argv[i], "--golden") == 0 && has_value )
+         golden_path = argv[++i];
+      else if ( strcmp(argv[i], "--update") == 0 )
+         update = true;
+      else if ( argv[i][0] != '-' )
+         script_path = argv[i];
+      else
+      {
+         fprintf(stderr, "usage: %s [--out DIR] [--csv FILE] [--golden FILE [--update]] [SCRIPT]\n", argv[0]);
+         return 2;
+      }
+   }
+   FILE* script = fopen(script_path, "r");
+   if ( script == nullptr )
+   {
+      perror(script_path);
+      return 2;
+   }
+   mkdir(out_dir.c_str(), 0755);
+   setenv("TZ", "UTC0", 1); // Same clock text on every machine
+   tzset();
+
+   lv_init();
+   static lv_disp_draw_buf_t draw_buf;
+   static lv_color_t buf_1[ SCREEN_WIDTH * DISP_BUF_LINES ];
+   static lv_color_t buf_2[ SCREEN_WIDTH * DISP_BUF_LINES ];
+   lv_disp_draw_buf_init(&draw_buf, buf_1, buf_2, SCREEN_WIDTH * DISP_BUF_LINES);
+   static lv_disp_drv_t disp_drv;
+   lv_disp_drv_init(&disp_drv);
+   disp_drv.hor_res = SCREEN_WIDTH;
+   disp_drv.ver_res = SCREEN_HEIGHT;
+   disp_drv.flush_cb = flush;
+   disp_drv.render_start_cb = render_start;
+   disp_drv.draw_buf = &draw_buf;
+   lv_disp_drv_register(&disp_drv);
+
+   std::vector<Refresh> log;
+   setup_screen();
+   step(log);
+
+   const std::map<std::string, uint32_t> golden = golden_path && !update ? read_golden(golden_path) : std::map<std::string, uint32_t>();
+   std::vector<std::pair<std::string, uint32_t>> frames;
+   int mismatches = 0;
+   char line[256];
+   int line_no = 0;
+   while ( fgets(line, sizeof(line), script) != nullptr )
+   {
+      ++line_no;
+      if ( char* hash = strchr(line, '#') )
+         *hash = '\0';
+      char cmd[32] = "", a[64] = "", b[64] = "", c[64] = "";
+      const int n = sscanf(line, "%31s %63s %63s %63s", cmd, a, b, c);
+      if ( n <= 0 )
+         continue;
+      bool ok = true;
+      if ( strcmp(cmd, "clock") == 0 && n == 3 )
+      {
+         struct tm t = {};
+         ok = sscanf(a, "%d-%d-%d", &t.tm_year, &t.tm_mon, &t.tm_mday) == 3 &&
+              sscanf(b, "%d:%d", &t.tm_hour, &t.tm_min) == 2;
+         t.tm_year -= 1900;
+         t.tm_mon -= 1;
+         host_wall_clock = timegm(&t);
+         update_time_label();
+      }
+      else if ( strcmp(cmd, "temp") == 0 && n == 3 )
+         update_temp_humid_display(strtof(a, nullptr), strtof(b, nullptr));
+      else if ( strcmp(cmd, "set_temp") == 0 && n == 2 )
+         lr_set_temp_DE.update(strtof(a, nullptr));
+      else if ( strcmp(cmd, "outside") == 0 && n == 4 )
+         update_outside_temp(strtof(a, nullptr), strtof(b, nullptr), strtof(c, nullptr));
+      else if ( strcmp(cmd, "fam_room") == 0 && n == 2 )
+         update_fam_room_temp(strtof(a, nullptr));
+      else if ( strcmp(cmd, "stale") == 0 && n == 3 && strcmp(a, "outside") == 0 )
+         set_outside_temp_stale(atoi(b) != 0);
+      else if ( strcmp(cmd, "stale") == 0 && n == 3 && strcmp(a, "fam_room") == 0 )
+         set_fam_room_temp_stale(atoi(b) != 0);
+      else if ( strcmp(cmd, "lamp") == 0 && n == 2 )
+         set_lamp_button_state(atoi(a) != 0);
+      else if ( strcmp(cmd, "run") == 0 && n == 2 )
+      {
+         const uint32_t end = host_millis + static_cast<uint32_t>(atoi(a));
+         while ( host_millis < end )
+         {
+            host_millis += LV_DISP_DEF_REFR_PERIOD;
+            step(log);
+         }
+      }
+      else if ( strcmp(cmd, "frame") == 0 && n == 2 )
+      {
+         const uint32_t hash = fnv1a(framebuffer, sizeof(framebuffer));
+         frames.emplace_back(a, hash);
+         if ( !write_frame(out_dir + "/" + a + ".png") )
+            fprintf(stderr, "screen_render: cannot write %s/%s.png\n", out_dir.c_str(), a);
+         auto g = golden.find(a);
+         if ( golden_path && !update && ( g == golden.end() || g->second != hash ) )
+         {
+            if ( g == golden.end() )
+               printf("MISMATCH %s: %08x, not in the golden file\n", a, hash);
+            else
+               printf("MISMATCH %s: %08x, golden %08x\n", a, hash, g->second);
+            ++mismatches;
+         }
+      }
+      else
+         ok = false;
+      if ( !ok )
+      {
+         fprintf(stderr, "%s:%d: bad command\n", script_path, line_no);
+         return 2;
+      }
+   }
+   fclose(script);
+
+   if ( golden_path && update )
+   {
+      FILE* f = fopen(golden_path, "w");
+      if ( f == nullptr )
+      {
+         perror(golden_path);
+         return 2;
+      }
+      for ( const auto& fr : frames )
+         fprintf(f, "%s %08x\n", fr.first.c_str(), fr.second);
+      fclose(f);
+      printf("Wrote %zu frame hashes to %s\n", frames.size(), golden_path);
+   }
+
+   if ( csv_path != nullptr )
+   {
+      FILE* f = fopen(csv_path, "w");
+      if ( f == nullptr )
+      {
+         perror(csv_path);
+         return 2;
+      }
+      fprintf(f, "t_ms,render_us,areas,area_px,flushes,flush_px\n");
+      for ( const Refresh& r : log )
+         fprintf(f, "%u,%.1f,%u,%u,%u,%u\n", r.t_ms, r.render_us, r.areas, r.area_px, r.flushes, r.flush_px);
+      fclose(f);
+   }
+
+   std::vector<double> render;
+   uint64_t area_px = 0, flush_px = 0, areas = 0, flushes = 0;
+   for ( const Refresh& r : log )
+   {
+      render.push_back(r.render_us);
+      areas += r.areas;
+      area_px += r.area_px;
+      flushes += r.flushes;
+      flush_px += r.flush_px;
+   }
+   double sum = 0.0;
+   for ( double v : render )
+      sum += v;
+   printf("refreshes %zu over %u ms; render_us mean %.0f p50 %.0f p99 %.0f max %.0f\n",
+      log.size(), host_millis, log.empty() ? 0.0 : sum / log.size(),
+      percentile(render, 50), percentile(render, 99), percentile(render, 100));
+   printf("areas %llu (%llu px), flushes %llu (%llu px, %llu KB over SPI)\n",
+      static_cast<unsigned long long>(areas), static_cast<unsigned long long>(area_px),
+      static_cast<unsigned long long>(flushes), static_cast<unsigned long long>(flush_px),
+      static_cast<unsigned long long>(flush_px * 2 / 1024));
+   printf("frames %zu", frames.size());
+   if ( golden_path && !update )
+      printf(", %d golden mismatch(es)", mismatches);
+   printf("\n");
+   return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,45 @@
+// Host stand-in for the parts of Arduino.h that lv_conf.h and screen1.cpp
+// use. Time is virtual: millis() returns host_millis, which the program
+// advances, so animations and timers run the same on every run.
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern uint32_t host_millis;
+#ifdef __cplusplus
+}
+#endif
+
+static inline uint32_t millis(void)
+{
+   return host_millis;
+}
+
+#ifdef __cplusplus
+extern time_t host_wall_clock; // For getLocalTime(); 0 means not yet set
+
+struct HostSerial
+{
+   void println(const char* s) { puts(s); }
+   template <typename... Args>
+   int printf(const char* fmt, Args... args) { return ::printf(fmt, args...); }
+};
+extern HostSerial Serial;
+
+// As the ESP32 core: false until the clock has been set
+inline bool getLocalTime(struct tm* info, uint32_t ms = 5000)
+{
+   (void)ms;
+   if ( host_wall_clock == 0 )
+      return false;
+   localtime_r(&host_wall_clock, info);
+   return true;
+}
+#endif
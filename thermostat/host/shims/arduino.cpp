@@ -0,0 +1,6 @@
+// Definitions for shims/Arduino.h
+#include "Arduino.h"
+
+uint32_t host_millis = 0; // extern "C" by the declaration
+time_t host_wall_clock = 0;
+HostSerial Serial;
@@ -0,0 +1,37 @@
+#!/bin/sh
+# Builds and runs the host unit tests into ./build/tests. They need only
+# a C++17 compiler; LVGL is not involved.
+#
+#   ./test.sh
+#   CXXFLAGS="-O1 -g -fsanitize=address,undefined" ./test.sh
+set -e
+cd "$(dirname "$0")"
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:--O2 -g}
+CXXALL="$CXX -std=c++17 -Wall -Wextra $CXXFLAGS -I../include -Ishims -Itests"
+mkdir -p build/tests
+failed=0
+
+# run NAME [SOURCES...]: builds tests/NAME.cpp with SOURCES and runs it
+run()
+{
+   name=$1
+   shift
+   if $CXXALL -o "build/tests/$name" "tests/$name.cpp" "$@"; then
+      "build/tests/$name" || failed=1
+   else
+      failed=1
+   fi
+}
+
+run time_series_test
+run data_logger_test ../src/data_logger.cpp
+run adc_filter_test
+run occupancy_test
+run sensor_freshness_test
+run filter_test
+
+# Benchmarks: built, not run
+$CXXALL -o build/adc_bench adc_bench.cpp || failed=1
+
+exit $failed
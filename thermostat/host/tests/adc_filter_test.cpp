@@ -0,0 +1,92 @@
+// SSW::median3/median5 against std::sort, and SSW::AdcDecimator.
+#include <algorithm>
+#include <cstdint>
+#include <random>
+
+#include "adc_filter.h"
+#include "check.h"
+
+static uint16_t sorted_median(uint16_t* v, size_t n)
+{
+   std::sort(v, v + n);
+   return v[n / 2];
+}
+
+static void test_medians_exhaustive()
+{
+   // Every ordering of every multiset over 8 levels covers all the
+   // compare-exchange paths, ties included.
+   const uint16_t LEVELS[8] = { 0, 1, 2, 3, 1000, 2047, 4094, 65535 };
+   unsigned bad3 = 0;
+   for ( unsigned i = 0; i < 8 * 8 * 8; ++i )
+   {
+      uint16_t v[3] = { LEVELS[i & 7], LEVELS[(i >> 3) & 7], LEVELS[(i >> 6) & 7] };
+      const uint16_t m = SSW::median3(v[0], v[1], v[2]);
+      bad3 += m != sorted_median(v, 3) ? 1U : 0U;
+   }
+   CHECK_EQ(bad3, 0);
+
+   unsigned bad5 = 0;
+   for ( unsigned i = 0; i < 8 * 8 * 8 * 8 * 8; ++i )
+   {
+      uint16_t v[5] = { LEVELS[i & 7], LEVELS[(i >> 3) & 7], LEVELS[(i >> 6) & 7],
+         LEVELS[(i >> 9) & 7], LEVELS[(i >> 12) & 7] };
+      const uint16_t m = SSW::median5(v[0], v[1], v[2], v[3], v[4]);
+      bad5 += m != sorted_median(v, 5) ? 1U : 0U;
+   }
+   CHECK_EQ(bad5, 0);
+
+   // And a million random full-range sets
+   std::mt19937 rng(1);
+   unsigned bad_random = 0;
+   for ( unsigned i = 0; i < 1000000; ++i )
+   {
+      uint16_t v[5];
+      for ( uint16_t& x : v )
+         x = static_cast<uint16_t>(rng());
+      const uint16_t m = SSW::median5(v[0], v[1], v[2], v[3], v[4]);
+      bad_random += m != sorted_median(v, 5) ? 1U : 0U;
+   }
+   CHECK_EQ(bad_random, 0);
+}
+
+static void test_decimator()
+{
+   SSW::AdcDecimator<5, 4> f;
+   CHECK_EQ(f.take(), 0);
+
+   // A steady level with a spike in every window: the spikes vanish
+   for ( unsigned i = 0; i < 100; ++i )
+      f.push(i % 5 == 2 ? 4095 : 1000);
+   CHECK_EQ(f.count(), 20);
+   CHECK_EQ(f.take(), 1000 << 4);
+   CHECK_EQ(f.count(), 0);
+
+   // Averaging two levels gains the fractional bits: 1000.5 in 1/16ths
+   for ( unsigned i = 0; i < 10; ++i )
+      f.push(i < 5 ? 1000 : 1001);
+   CHECK_EQ(f.take(), (1000 << 4) + 8);
+
+   // A partial window is carried over, and reset() drops it
+   SSW::AdcDecimator<3, 0> g;
+   const uint16_t block[4] = { 7, 7, 7, 9 };
+   g.push(block, 4);
+   CHECK_EQ(g.count(), 1);
+   g.push(9);
+   g.push(9);
+   CHECK_EQ(g.count(), 2);
+   CHECK_EQ(g.take(), 8);
+   g.push(5);
+   g.reset();
+   g.push(1);
+   g.push(1);
+   g.push(1);
+   CHECK_EQ(g.take(), 1);
+}
+
+int main()
+{
+   test_medians_exhaustive();
+   test_decimator();
+   return check_result("adc_filter_test");
+}
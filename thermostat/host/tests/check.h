@@ -0,0 +1,48 @@
+// Minimal checks for the host tests. CHECK() reports a failed
+// expression and carries on, so one run shows every failure;
+// check_result() is main()'s exit status.
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+
+static int check_failures = 0;
+
+#define CHECK(cond) \
+   do { \
+      if ( !(cond) ) \
+      { \
+         ++check_failures; \
+         fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      } \
+   } while ( 0 )
+
+#define CHECK_EQ(a, b) \
+   do { \
+      const long long check_a = static_cast<long long>(a); \
+      const long long check_b = static_cast<long long>(b); \
+      if ( check_a != check_b ) \
+      { \
+         ++check_failures; \
+         fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", \
+            __FILE__, __LINE__, #a, #b, check_a, check_b); \
+      } \
+   } while ( 0 )
+
+#define CHECK_NEAR(a, b, tol) \
+   do { \
+      const double check_a = (a); \
+      const double check_b = (b); \
+      if ( !(std::fabs(check_a - check_b) <= (tol)) ) \
+      { \
+         ++check_failures; \
+         fprintf(stderr, "%s:%d: CHECK_NEAR(%s, %s, %s) failed: %g vs %g\n", \
+            __FILE__, __LINE__, #a, #b, #tol, check_a, check_b); \
+      } \
+   } while ( 0 )
+
+static inline int check_result(const char* name)
+{
+   printf("%s: %s\n", name, check_failures == 0 ? "ok" : "FAILED");
+   return check_failures == 0 ? 0 : 1;
+}
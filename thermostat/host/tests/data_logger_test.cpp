@@ -0,0 +1,276 @@
+// SSW::DataLogger against files in a temporary directory: clean close,
+// power loss with a torn tail, a damaged index block and rotation.
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "data_logger.h"
+#include "check.h"
+
+using namespace SSW;
+
+SSW::DataLogger data_logger("/nonexistent"); // Declared by data_logger.h; unused here
+
+/// @brief Reads a log file back as a reader would: stops at the first
+/// block that fails its check, and collects the data records.
+struct LogScan
+{
+   std::vector<LogRecord> records;
+   uint32_t blocks {0};
+   uint32_t index_blocks {0};
+   bool footer {false};
+   LogFooter footer_data {};
+};
+
+static LogScan scan(const char* path)
+{
+   LogScan out;
+   BlockFile f;
+   if ( !f.open(path, false) )
+      return out;
+   LogBlock blk;
+   for ( uint32_t pos = 0; f.read_block(pos, blk) && log_block_valid(blk, pos); ++pos )
+   {
+      out.blocks = pos + 1;
+      switch ( static_cast<LogBlockType>(blk.hdr.type) )
+      {
+         case LogBlockType::Data:
+            out.records.insert(out.records.end(), blk.records, blk.records + blk.hdr.count);
+            break;
+         case LogBlockType::Index:
+            ++out.index_blocks;
+            break;
+         case LogBlockType::Footer:
+            out.footer = true;
+            out.footer_data = blk.footer;
+            break;
+         default:
+            break;
+      }
+   }
+   return out;
+}
+
+static std::string make_dir()
+{
+   char tmpl[] = "/tmp/data_logger_test.XXXXXX";
+   const char* dir = mkdtemp(tmpl);
+   return dir != nullptr ? dir : "";
+}
+
+static void remove_dir(const std::string& dir)
+{
+   const std::string cmd = "rm -rf '" + dir + "'";
+   if ( system(cmd.c_str()) != 0 )
+      fprintf(stderr, "could not remove %s\n", dir.c_str());
+}
+
+/// @brief Logs 'n' samples with times t0, t0+1, ..., writing each block
+/// as soon as it fills.
+static void log_n(DataLogger& log, uint32_t t0, uint32_t n)
+{
+   for ( uint32_t i = 0; i < n; ++i )
+   {
+      CHECK(log.log_sample(t0 + i, LogChannel::Temp, 70.0f + i % 10));
+      log.service(t0 + i);
+   }
+}
+
+static bool times_sequential(const std::vector<LogRecord>& recs, uint32_t t0)
+{
+   for ( size_t i = 0; i < recs.size(); ++i )
+      if ( recs[i].t != t0 + i )
+         return false;
+   return true;
+}
+
+static void test_clean_close()
+{
+   const std::string dir = make_dir();
+   {
+      DataLogger log(dir.c_str());
+      CHECK(log.begin(1000));
+      CHECK_EQ(log.file_no(), 1);
+      log_n(log, 1000, 100);
+      log.end(2000);
+   }
+   char path[128];
+   DataLogger(dir.c_str()).file_path(1, path, sizeof(path));
+   const LogScan s = scan(path);
+   CHECK_EQ(s.records.size(), 100);
+   CHECK(times_sequential(s.records, 1000));
+   CHECK(s.footer);
+   CHECK_EQ(s.footer_data.records, 100);
+   CHECK_EQ(s.footer_data.first_t, 1000);
+   CHECK_EQ(s.footer_data.last_t, 1099);
+   CHECK_EQ(s.footer_data.dropped, 0);
+
+   // A cleanly closed file is not reopened: logging moves to the next one
+   DataLogger log(dir.c_str());
+   CHECK(log.begin(3000));
+   CHECK_EQ(log.file_no(), 2);
+   log.end(3000);
+   remove_dir(dir);
+}
+
+static void test_power_loss()
+{
+   const std::string dir = make_dir();
+   const uint32_t n = 3 * LOG_GROUP_BLOCKS * LOG_RECORDS_PER_BLOCK / 2; // 1.5 groups of full blocks
+   char path[128];
+   {
+      DataLogger log(dir.c_str());
+      CHECK(log.begin(0));
+      log_n(log, 0, n);
+      log.file_path(log.file_no(), path, sizeof(path));
+      // No end(): power is lost. Leave a torn half block behind the last one.
+      FILE* f = fopen(path, "ab");
+      CHECK(f != nullptr);
+      if ( f != nullptr )
+      {
+         char junk[LOG_BLOCK_SIZE / 2];
+         memset(junk, 0xA5, sizeof(junk));
+         fwrite(junk, sizeof(junk), 1, f);
+         fclose(f);
+      }
+   }
+   const uint32_t written = static_cast<uint32_t>(scan(path).records.size());
+   CHECK_EQ(written, n / LOG_RECORDS_PER_BLOCK * LOG_RECORDS_PER_BLOCK);
+
+   {
+      DataLogger log(dir.c_str());
+      CHECK(log.begin(n));
+      CHECK_EQ(log.file_no(), 1); // Continues the same file
+      log_n(log, written, 200);
+      log.end(n + 200);
+   }
+   const LogScan s = scan(path);
+   CHECK_EQ(s.records.size(), written + 200);
+   CHECK(times_sequential(s.records, 0));
+   CHECK(s.footer);
+   CHECK_EQ(s.footer_data.records, written + 200);
+   CHECK_EQ(s.footer_data.first_t, 0);
+   remove_dir(dir);
+}
+
+static void test_damaged_index()
+{
+   // Three groups and a bit, then the first index block is corrupted.
+   // Recovery must walk the data blocks of every later group without
+   // overrunning its pending index, and carry on in the same file.
+   const std::string dir = make_dir();
+   const uint32_t n = (3 * (LOG_GROUP_BLOCKS - 1) + 2) * LOG_RECORDS_PER_BLOCK;
+   char path[128];
+   {
+      DataLogger log(dir.c_str());
+      CHECK(log.begin(0));
+      log_n(log, 0, n);
+      log.file_path(log.file_no(), path, sizeof(path));
+   }
+   {
+      BlockFile f;
+      CHECK(f.open(path, false));
+      LogBlock blk;
+      CHECK(f.read_block(LOG_GROUP_BLOCKS, blk));
+      CHECK_EQ(blk.hdr.type, static_cast<uint8_t>(LogBlockType::Index));
+      blk.index[0].count ^= 1; // The CRC no longer matches
+      CHECK(f.write_block(LOG_GROUP_BLOCKS, blk));
+   }
+
+   DataLogger log(dir.c_str());
+   CHECK(log.begin(n));
+   CHECK_EQ(log.file_no(), 1);
+   CHECK_EQ(log.next_block(), 1 + 3 * LOG_GROUP_BLOCKS + 2);
+   log_n(log, n, LOG_RECORDS_PER_BLOCK);
+   log.end(n + LOG_RECORDS_PER_BLOCK);
+
+   // Readers stop at the damaged index block; the rest is still there and
+   // the footer counts every record.
+   BlockFile f;
+   CHECK(f.open(path, false));
+   LogBlock blk;
+   const uint32_t last = f.block_count() - 1;
+   CHECK(f.read_block(last, blk) && log_block_valid(blk, last));
+   CHECK_EQ(blk.hdr.type, static_cast<uint8_t>(LogBlockType::Footer));
+   CHECK_EQ(blk.footer.records, n + LOG_RECORDS_PER_BLOCK);
+   CHECK_EQ(blk.footer.last_t, n + LOG_RECORDS_PER_BLOCK - 1);
+   remove_dir(dir);
+}
+
+static void test_rotation()
+{
+   const std::string dir = make_dir();
+   const uint32_t max_blocks = 3 * LOG_GROUP_BLOCKS;
+   const uint32_t n = 4 * LOG_GROUP_BLOCKS * LOG_RECORDS_PER_BLOCK;
+   {
+      DataLogger log(dir.c_str(), max_blocks);
+      CHECK(log.begin(0));
+      log_n(log, 0, n);
+      CHECK(log.file_no() >= 2);
+      log.end(n);
+   }
+   // Every record is in exactly one file, in order
+   std::vector<LogRecord> all;
+   DataLogger names(dir.c_str());
+   for ( uint32_t no = 1; ; ++no )
+   {
+      char path[128];
+      names.file_path(no, path, sizeof(path));
+      if ( access(path, F_OK) != 0 )
+         break;
+      const LogScan s = scan(path);
+      CHECK(s.footer);
+      CHECK(s.blocks <= max_blocks);
+      all.insert(all.end(), s.records.begin(), s.records.end());
+   }
+   CHECK_EQ(all.size(), n);
+   CHECK(times_sequential(all, 0));
+   remove_dir(dir);
+}
+
+static void test_not_started()
+{
+   // Records before begin() are ignored, not staged for the first block
+   const std::string dir = make_dir();
+   DataLogger log(dir.c_str());
+   CHECK(!log.log_sample(5, LogChannel::Temp, 70.0f));
+   CHECK(log.begin(1000));
+   log_n(log, 1000, 10);
+   log.end(2000);
+   char path[128];
+   log.file_path(log.file_no(), path, sizeof(path));
+   const LogScan s = scan(path);
+   CHECK_EQ(s.records.size(), 10);
+   CHECK(times_sequential(s.records, 1000));
+   CHECK_EQ(s.footer_data.first_t, 1000);
+   remove_dir(dir);
+}
+
+static void test_writer_behind()
+{
+   const std::string dir = make_dir();
+   DataLogger log(dir.c_str());
+   CHECK(log.begin(0));
+   // Without service() only the two staging blocks fill
+   uint32_t accepted = 0;
+   for ( uint32_t i = 0; i < 3 * LOG_RECORDS_PER_BLOCK; ++i )
+      accepted += log.log_sample(i, LogChannel::Light, 1.0f) ? 1U : 0U;
+   CHECK_EQ(accepted, 2 * LOG_RECORDS_PER_BLOCK);
+   CHECK_EQ(log.dropped(), LOG_RECORDS_PER_BLOCK);
+   log.end(0);
+   remove_dir(dir);
+}
+
+int main()
+{
+   test_clean_close();
+   test_power_loss();
+   test_damaged_index();
+   test_rotation();
+   test_not_started();
+   test_writer_behind();
+   return check_result("data_logger_test");
+}
@@ -0,0 +1,185 @@
+// SSW::Filter step, ramp and noise responses against double-precision
+// reference implementations of the same recurrences. The fixed-point
+// filters must stay within a count of the reference.
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "filter.h"
+#include "check.h"
+
+using SSW::FilterKind;
+using SSW::q16;
+
+/// @brief A step from 'lo' to 'hi' after 'at' samples, 'n' long.
+static std::vector<int32_t> step_input(int32_t lo, int32_t hi, size_t at, size_t n)
+{
+   std::vector<int32_t> x(n, hi);
+   for ( size_t i = 0; i < at && i < n; ++i )
+      x[i] = lo;
+   return x;
+}
+
+/// @brief Largest difference between the filter and the reference.
+template <typename F, typename R>
+static double max_error(F& filter, R& ref, const std::vector<int32_t>& x)
+{
+   double worst = 0;
+   for ( int32_t v : x )
+   {
+      const double e = std::fabs(filter.step(v) - ref.step(v));
+      if ( e > worst )
+         worst = e;
+   }
+   return worst;
+}
+
+struct EmaRef
+{
+   double alpha;
+   double y {0};
+   bool init {false};
+
+   double step(double x)
+   {
+      y = init ? y + alpha * (x - y) : x;
+      init = true;
+      return y;
+   }
+};
+
+struct AlphaBetaRef
+{
+   double alpha, beta;
+   double x {0}, v {0};
+   bool init {false};
+
+   double step(double m)
+   {
+      if ( !init )
+      {
+         x = m;
+         v = 0;
+         init = true;
+         return x;
+      }
+      const double predicted = x + v;
+      const double residual = m - predicted;
+      x = predicted + alpha * residual;
+      v += beta * residual;
+      return x;
+   }
+};
+
+struct KalmanRef
+{
+   double q, r, p;
+   double x {0};
+   bool init {false};
+
+   double step(double m)
+   {
+      if ( !init )
+      {
+         x = m;
+         init = true;
+         return x;
+      }
+      p += q;
+      const double k = p / (p + r);
+      x += k * (m - x);
+      p *= 1 - k;
+      return x;
+   }
+};
+
+static void test_ema()
+{
+   // The humidity filter: alpha 0.25, tenths of a percent
+   for ( const int32_t hi : {1, 10, 250, 100000, -100000} )
+   {
+      SSW::Filter<FilterKind::EMA> f({q16(0.25)});
+      EmaRef ref {0.25};
+      CHECK(max_error(f, ref, step_input(0, hi, 5, 200)) <= 0.5 + 1e-9);
+      CHECK_EQ(f.value(), hi); // Settles on the step
+   }
+
+   // A small alpha still converges in Q16 instead of sticking short
+   SSW::Filter<FilterKind::EMA> slow({q16(0.01)});
+   EmaRef slow_ref {q16(0.01) / 65536.0};
+   CHECK(max_error(slow, slow_ref, step_input(0, 1000, 1, 2000)) <= 0.5 + 1e-9);
+   CHECK_EQ(slow.value(), 1000);
+
+   // Lower Q: coarser state, still within a count
+   SSW::Filter<FilterKind::EMA, 8> coarse({q16(0.25)});
+   EmaRef coarse_ref {0.25};
+   CHECK(max_error(coarse, coarse_ref, step_input(-300, 700, 3, 100)) <= 1.0);
+}
+
+static void test_alpha_beta()
+{
+   const double a = 0.5, b = 0.1;
+   SSW::Filter<FilterKind::AlphaBeta> f({q16(a), q16(b)});
+   AlphaBetaRef ref {q16(a) / 65536.0, q16(b) / 65536.0};
+   CHECK(max_error(f, ref, step_input(0, 1000, 10, 300)) <= 1.0);
+   CHECK_EQ(f.value(), 1000);
+
+   // On a ramp it converges to the ramp, with no steady lag
+   SSW::Filter<FilterKind::AlphaBeta> g({q16(a), q16(b)});
+   AlphaBetaRef gref {q16(a) / 65536.0, q16(b) / 65536.0};
+   std::vector<int32_t> ramp;
+   for ( int32_t i = 0; i < 300; ++i )
+      ramp.push_back(7000 + 3 * i);
+   CHECK(max_error(g, gref, ramp) <= 1.0);
+   CHECK_EQ(g.value(), ramp.back());
+   CHECK_NEAR(g.rate_fixed() / 65536.0, 3.0, 1e-3);
+}
+
+static void test_kalman()
+{
+   // The room temperature filter, in hundredths of a degree
+   const double q = 9.0, r = 324.0, p0 = 324.0;
+   SSW::Filter<FilterKind::Kalman> f({q16(q), q16(r), q16(p0)});
+   KalmanRef ref {q, r, p0};
+   CHECK(max_error(f, ref, step_input(7000, 7200, 20, 400)) <= 1.0);
+   CHECK_EQ(f.value(), 7200);
+   CHECK_NEAR(f.variance() / 65536.0, ref.p, 0.01); // Q16 rounding per step
+
+   // Noisy readings around a constant: tracks the reference, and smooths
+   SSW::Filter<FilterKind::Kalman> n({q16(q), q16(r), q16(p0)});
+   KalmanRef nref {q, r, p0};
+   std::mt19937 rng(1);
+   std::normal_distribution<double> noise(0.0, 18.0);
+   double worst = 0, in_sq = 0, out_sq = 0;
+   for ( int i = 0; i < 5000; ++i )
+   {
+      const int32_t x = 7000 + static_cast<int32_t>(std::lround(noise(rng)));
+      const int32_t y = n.step(x);
+      worst = std::fmax(worst, std::fabs(y - nref.step(x)));
+      if ( i >= 100 )
+      {
+         in_sq += (x - 7000.0) * (x - 7000.0);
+         out_sq += (y - 7000.0) * (y - 7000.0);
+      }
+   }
+   CHECK(worst <= 1.0);
+   CHECK(out_sq < in_sq / 4);
+}
+
+static void test_reset()
+{
+   SSW::Filter<FilterKind::EMA> f({q16(0.25)});
+   f.step(100);
+   f.step(0);
+   f.reset();
+   CHECK_EQ(f.step(-50), -50); // The first sample after reset() initialises
+}
+
+int main()
+{
+   test_ema();
+   test_alpha_beta();
+   test_kalman();
+   test_reset();
+   return check_result("filter_test");
+}
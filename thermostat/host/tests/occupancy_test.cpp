@@ -0,0 +1,159 @@
+// SSW::EdgeQueue and SSW::OccupancyTracker replaying synthetic PIR edge
+// traces: hold times, re-triggering, queue overflow and millis() wrap.
+#include <vector>
+
+#include "occupancy.h"
+#include "check.h"
+
+using SSW::Occupancy;
+using SSW::PirEdge;
+
+static const uint32_t HOLD_MS = 60000;
+static const uint32_t AWAY_MS = 10 * 60000;
+
+/// @brief Replays 'trace' from 't0' to 't_end' as loop() would: edges are
+/// pushed when their time comes, and the tracker is updated every
+/// 'step_ms'. Records each state change.
+struct Replay
+{
+   std::vector<std::pair<uint32_t, Occupancy>> changes;
+   uint32_t dropped {0};
+};
+
+static Replay replay(SSW::OccupancyTracker& occ, const std::vector<PirEdge>& trace,
+                     uint32_t t0, uint32_t t_end, uint32_t step_ms = 100)
+{
+   SSW::EdgeQueue<16> q;
+   Replay out;
+   size_t next = 0;
+   for ( uint32_t t = t0; t - t0 <= t_end - t0; t += step_ms )
+   {
+      while ( next < trace.size() && trace[next].t_ms - t0 <= t - t0 )
+         q.push(trace[next].t_ms, trace[next].high), ++next;
+      if ( occ.update(q, t) )
+         out.changes.push_back({t, occ.state()});
+   }
+   out.dropped = q.dropped();
+   return out;
+}
+
+static void test_queue()
+{
+   SSW::EdgeQueue<4> q;
+   PirEdge e {};
+   CHECK(!q.pop(e));
+   for ( uint32_t i = 0; i < 6; ++i )
+      CHECK_EQ(q.push(i, i % 2 == 0), i < 4);
+   CHECK_EQ(q.dropped(), 2);
+   for ( uint32_t i = 0; i < 4; ++i )
+   {
+      CHECK(q.pop(e));
+      CHECK_EQ(e.t_ms, i);
+      CHECK_EQ(e.high, i % 2 == 0);
+   }
+   CHECK(!q.pop(e));
+   CHECK(q.push(9, true)); // Room again after draining
+}
+
+static void test_single_visit()
+{
+   // Motion for 5 s at t = 1 s, then nothing. begin() counts as motion,
+   // so the room reads Present from the start.
+   SSW::OccupancyTracker occ(HOLD_MS, AWAY_MS);
+   occ.begin(false, 0);
+   const Replay r = replay(occ, {{1000, true}, {6000, false}}, 0, 20 * 60000);
+   CHECK_EQ(r.changes.size(), 3);
+   if ( r.changes.size() == 3 )
+   {
+      CHECK(r.changes[0] == std::make_pair(0U, Occupancy::Present));
+      CHECK(r.changes[1] == std::make_pair(6000U + HOLD_MS, Occupancy::RecentlyLeft));
+      CHECK(r.changes[2] == std::make_pair(6000U + AWAY_MS, Occupancy::Away));
+   }
+   CHECK_EQ(occ.motion_events(), 1);
+   CHECK(!occ.motion());
+}
+
+static void test_retrigger_and_long_high()
+{
+   // A PIR held high for longer than the away time stays Present; motion
+   // while RecentlyLeft goes straight back to Present.
+   SSW::OccupancyTracker occ(HOLD_MS, AWAY_MS);
+   occ.begin(true, 0);
+   const std::vector<PirEdge> trace {
+      {AWAY_MS * 2, false},
+      {AWAY_MS * 2 + HOLD_MS + 5000, true},
+      {AWAY_MS * 2 + HOLD_MS + 6000, false},
+   };
+   const Replay r = replay(occ, trace, 0, AWAY_MS * 4);
+   CHECK_EQ(r.changes.size(), 5);
+   if ( r.changes.size() == 5 )
+   {
+      CHECK(r.changes[0] == std::make_pair(0U, Occupancy::Present));
+      CHECK(r.changes[1].second == Occupancy::RecentlyLeft);
+      CHECK_EQ(r.changes[1].first, AWAY_MS * 2 + HOLD_MS);
+      CHECK(r.changes[2].second == Occupancy::Present);
+      CHECK_EQ(r.changes[2].first, AWAY_MS * 2 + HOLD_MS + 5000);
+      CHECK(r.changes[3].second == Occupancy::RecentlyLeft);
+      CHECK(r.changes[4].second == Occupancy::Away);
+      CHECK_EQ(r.changes[4].first, AWAY_MS * 3 + HOLD_MS + 6000);
+   }
+}
+
+static void test_burst_overflow()
+{
+   // A chattering PIR fills the queue between two updates: the extra
+   // edges are dropped and counted, and the room is still Present.
+   SSW::OccupancyTracker occ(HOLD_MS, AWAY_MS);
+   occ.begin(false, 0);
+   std::vector<PirEdge> trace;
+   for ( uint32_t i = 0; i < 40; ++i )
+      trace.push_back({1001 + i, i % 2 == 0});
+   const Replay r = replay(occ, trace, 0, 2000, 1000);
+   CHECK_EQ(r.dropped, 24);
+   CHECK(occ.present());
+   CHECK_EQ(occ.motion_events(), 8);
+}
+
+static void test_millis_wrap()
+{
+   // The same single visit as above, straddling the 32-bit millis() wrap
+   const uint32_t t0 = UINT32_MAX - 30000;
+   SSW::OccupancyTracker occ(HOLD_MS, AWAY_MS);
+   occ.begin(false, t0);
+   const Replay r = replay(occ, {{t0 + 1000, true}, {t0 + 6000, false}}, t0, t0 + 20 * 60000);
+   CHECK_EQ(r.changes.size(), 3);
+   if ( r.changes.size() == 3 )
+   {
+      CHECK(r.changes[0].second == Occupancy::Present);
+      CHECK(r.changes[1].second == Occupancy::RecentlyLeft);
+      CHECK_EQ(r.changes[1].first, t0 + 6000 + HOLD_MS);
+      CHECK(r.changes[2].second == Occupancy::Away);
+      CHECK_EQ(r.changes[2].first, t0 + 6000 + AWAY_MS);
+   }
+}
+
+static void test_wake_edge()
+{
+   // After a light sleep idle_wait() pushes the rising edge itself; a
+   // duplicate from a late interrupt must not change the outcome.
+   SSW::OccupancyTracker occ(HOLD_MS, AWAY_MS);
+   occ.begin(false, 0);
+   const Replay r = replay(occ, {{AWAY_MS + 500, true}, {AWAY_MS + 500, true},
+                                 {AWAY_MS + 2500, false}}, 0, AWAY_MS * 3);
+   CHECK_EQ(r.changes.size(), 6); // Present, RecentlyLeft, Away, twice
+   if ( r.changes.size() == 6 )
+      CHECK(r.changes[3] == std::make_pair(AWAY_MS + 500, Occupancy::Present));
+   CHECK(occ.state() == Occupancy::Away);
+   CHECK_EQ(occ.last_motion_ms(), AWAY_MS + 2500);
+}
+
+int main()
+{
+   test_queue();
+   test_single_visit();
+   test_retrigger_and_long_high();
+   test_burst_overflow();
+   test_millis_wrap();
+   test_wake_edge();
+   return check_result("occupancy_test");
+}
@@ -0,0 +1,144 @@
+// SSW::FreshSource and SSW::FreshnessIndex against a simulated clock:
+// adaptive periods, staleness, failure back-off and overdue ordering.
+#include <vector>
+
+#include "sensor_freshness.h"
+#include "check.h"
+
+static const uint32_t MIN_MS = 15000;
+static const uint32_t MAX_MS = 5 * 60000;
+static const uint32_t STALE_MS = 30 * 60000;
+
+/// @brief Runs the main loop's once-a-second poll from 't0' for 'secs'
+/// seconds. 'answer' returns false for a failed poll, or true with the
+/// reading. Returns the times polled.
+template <typename F>
+static std::vector<uint32_t> run(SSW::FreshSource& src, uint32_t t0, uint32_t secs, F answer)
+{
+   SSW::FreshnessIndex<1> index;
+   index.add(src);
+   std::vector<uint32_t> polls;
+   for ( uint32_t i = 0; i < secs; ++i )
+   {
+      const uint32_t now = t0 + i * 1000;
+      if ( index.next_due(now) != &src )
+         continue;
+      polls.push_back(now);
+      float v = 0.0f;
+      if ( answer(now, v) )
+         src.update(v, now, now);
+      else
+         src.failed(now);
+   }
+   return polls;
+}
+
+static void test_never_answers()
+{
+   // A source that never answers must back off, not be polled every pass
+   SSW::FreshSource src("dead", MIN_MS, MAX_MS, STALE_MS, 0.5f);
+   src.begin(0);
+   const std::vector<uint32_t> polls = run(src, 0, 3600, [](uint32_t, float&) { return false; });
+   CHECK(polls.size() >= 3);
+   if ( polls.size() >= 3 )
+   {
+      CHECK_EQ(polls[0], 0);
+      CHECK_EQ(polls[1], MIN_MS);
+      CHECK_EQ(polls[2], MIN_MS + 2 * MIN_MS);
+   }
+   for ( size_t i = 1; i < polls.size(); ++i )
+      CHECK(polls[i] - polls[i - 1] >= MIN_MS && polls[i] - polls[i - 1] <= MAX_MS);
+   // 0, 15, 45, 105, 225 s, then every 300 s: 16 polls in the hour
+   CHECK_EQ(polls.size(), 16);
+   CHECK(src.stale(3600 * 1000));
+   CHECK_EQ(src.value().seq, 0);
+}
+
+static void test_steady_then_changing()
+{
+   SSW::FreshSource src("temp", MIN_MS, MAX_MS, STALE_MS, 0.5f);
+   src.begin(1000);
+   CHECK(!src.due(0));
+   CHECK(src.due(1000));
+
+   // Steady readings stretch the period by half each poll, up to the max
+   std::vector<uint32_t> polls = run(src, 0, 3600, [](uint32_t, float& v) { v = 20.0f; return true; });
+   CHECK(polls.size() >= 3);
+   if ( polls.size() >= 3 )
+   {
+      CHECK_EQ(polls[0], 1000);
+      CHECK_EQ(polls[1] - polls[0], MIN_MS);
+      CHECK_EQ(polls[2] - polls[1], MIN_MS * 3 / 2 + 500); // Next whole second
+      CHECK_EQ(polls.back() - polls[polls.size() - 2], MAX_MS);
+   }
+   CHECK_EQ(src.period(), MAX_MS);
+   CHECK(!src.stale(polls.back()));
+
+   // A reading that moves by the threshold halves it
+   const uint32_t t = polls.back();
+   src.update(21.0f, t + MAX_MS, t + MAX_MS);
+   CHECK_EQ(src.period(), MAX_MS / 2);
+}
+
+static void test_recovers_after_failures()
+{
+   SSW::FreshSource src("flaky", MIN_MS, MAX_MS, STALE_MS, 0.5f);
+   src.begin(0);
+   src.update(20.0f, 0, 0);
+   for ( uint32_t i = 0; i < 10; ++i )
+      src.failed(i * 1000);
+   CHECK(src.stale(10000));
+   CHECK_EQ(src.failures(), 10);
+   CHECK(!src.due(9000 + MAX_MS - 1));
+   CHECK(src.due(9000 + MAX_MS));
+   src.update(20.0f, 9000 + MAX_MS, 9000 + MAX_MS);
+   CHECK_EQ(src.failures(), 0);
+   CHECK(!src.stale(9000 + MAX_MS));
+}
+
+static void test_old_reading_is_stale()
+{
+   // The source answers, but its reading never advances: stale once it is
+   // older than STALE_MS, then polled at the fastest period
+   SSW::FreshSource src("stuck", MIN_MS, MAX_MS, STALE_MS, 0.5f);
+   src.begin(0);
+   src.update(20.0f, 0, 0);
+   src.update(20.0f, 0, STALE_MS - 1000); // Same reading, still fresh
+   CHECK(!src.stale(STALE_MS - 1000));
+   CHECK(!src.due(STALE_MS - 1000 + MIN_MS - 1));
+   src.update(20.0f, 0, STALE_MS + 1);
+   CHECK(src.stale(STALE_MS + 1));
+   CHECK_EQ(src.value().seq, 1);
+   CHECK(!src.due(STALE_MS + MIN_MS));
+   CHECK(src.due(STALE_MS + 1 + MIN_MS));
+}
+
+static void test_index_order_and_wrap()
+{
+   // Sources due across the millis() wrap; the most overdue is chosen
+   const uint32_t t0 = UINT32_MAX - 5000;
+   SSW::FreshSource a("a", MIN_MS, MAX_MS, STALE_MS, 0.5f);
+   SSW::FreshSource b("b", MIN_MS, MAX_MS, STALE_MS, 0.5f);
+   a.begin(t0 + 8000);
+   b.begin(t0 + 2000);
+   SSW::FreshnessIndex<2> index;
+   CHECK(index.add(a));
+   CHECK(index.add(b));
+   CHECK(!index.add(a));
+   CHECK(index.next_due(t0) == nullptr);
+   CHECK(index.next_due(t0 + 3000) == &b);
+   CHECK(index.next_due(t0 + 9000) == &b);
+   b.update(1.0f, t0 + 9000, t0 + 9000);
+   CHECK(index.next_due(t0 + 9000) == &a);
+   CHECK_EQ(index.stale_count(t0 + 9000), 1);
+}
+
+int main()
+{
+   test_never_answers();
+   test_steady_then_changing();
+   test_recovers_after_failures();
+   test_old_reading_is_stale();
+   test_index_order_and_wrap();
+   return check_result("sensor_freshness_test");
+}
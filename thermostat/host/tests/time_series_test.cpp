@@ -0,0 +1,157 @@
+// SSW::TimeSeries: roll-ups, queries, tier selection, ring wrap and the
+// accumulator limits.
+#include <vector>
+
+#include "time_series.h"
+#include "check.h"
+
+using SSW::TSRecord;
+using SSW::TSTier;
+
+template <typename TS>
+static std::vector<TSRecord> collect(const TS& ts, TSTier tier, uint32_t from, uint32_t to)
+{
+   std::vector<TSRecord> out;
+   ts.query(tier, from, to, [&](const TSRecord& r) { out.push_back(r); });
+   return out;
+}
+
+static void test_ring_buffer()
+{
+   SSW::RingBuffer<SSW::TSSample, 4> ring;
+   CHECK(ring.empty());
+   for ( uint32_t t = 1; t <= 6; ++t )
+      ring.push({t * 10, static_cast<int16_t>(t)});
+   CHECK_EQ(ring.size(), 4);
+   CHECK_EQ(ring[0].t, 30);
+   CHECK_EQ(ring.newest().t, 60);
+   CHECK_EQ(ring.lower_bound(0), 0);
+   CHECK_EQ(ring.lower_bound(45), 2);
+   CHECK_EQ(ring.lower_bound(60), 3);
+   CHECK_EQ(ring.lower_bound(61), 4);
+}
+
+static void test_rollups()
+{
+   SSW::TimeSeries<32, 8, 4> ts(10);
+   CHECK(!ts.has_data());
+
+   // Two minutes of samples every 10 s: 0..5 then 10..15
+   for ( uint32_t i = 0; i < 12; ++i )
+      ts.add(i * 10, static_cast<int16_t>(i < 6 ? i : i + 4));
+   CHECK(ts.has_data());
+   CHECK_EQ(ts.latest().t, 110);
+
+   const std::vector<TSRecord> minutes = collect(ts, TSTier::Minute, 0, 1000);
+   CHECK_EQ(minutes.size(), 2);
+   CHECK_EQ(minutes[0].t, 0);
+   CHECK_EQ(minutes[0].min, 0);
+   CHECK_EQ(minutes[0].max, 5);
+   CHECK_EQ(minutes[0].mean, 3); // 2.5 rounds away from zero
+   CHECK_EQ(minutes[0].count, 6);
+   CHECK_EQ(minutes[1].t, 60);    // Still being filled, reported last
+   CHECK_EQ(minutes[1].min, 10);
+   CHECK_EQ(minutes[1].count, 6);
+   CHECK_EQ(ts.size(TSTier::Minute), 1);
+
+   const std::vector<TSRecord> hours = collect(ts, TSTier::Hour, 0, 1000);
+   CHECK_EQ(hours.size(), 1);
+   CHECK_EQ(hours[0].count, 12);
+   CHECK_EQ(hours[0].max, 15);
+
+   // Raw window and count agree
+   CHECK_EQ(collect(ts, TSTier::Raw, 20, 50).size(), 3);
+   CHECK_EQ(ts.count(TSTier::Raw, 20, 50), 3);
+   CHECK_EQ(ts.count(TSTier::Minute, 0, 60), 1);
+   CHECK_EQ(ts.count(TSTier::Minute, 0, 61), 2);
+   CHECK_EQ(ts.count(TSTier::Raw, 50, 50), 0);
+
+   // A visitor returning false stops the walk
+   size_t seen = 0;
+   ts.query(TSTier::Raw, 0, 1000, [&](const TSRecord&) { return ++seen < 3; });
+   CHECK_EQ(seen, 3);
+
+   // Negative means round away from zero too
+   SSW::TimeSeries<4, 4, 4> neg;
+   neg.add(0, -1);
+   neg.add(1, -2);
+   CHECK_EQ(collect(neg, TSTier::Minute, 0, 60)[0].mean, -2);
+}
+
+static void test_out_of_order_and_fixed_point()
+{
+   SSW::TimeSeries<8, 4, 4> ts(10);
+   ts.add(100, 1);
+   ts.add(90, 2); // Clamped to 100
+   CHECK_EQ(ts.latest().t, 100);
+   CHECK_EQ(ts.to_fixed(21.26f), 213);
+   CHECK_EQ(ts.to_fixed(-21.26f), -213);
+   CHECK_EQ(ts.to_fixed(1e6f), INT16_MAX);
+   CHECK_EQ(ts.to_fixed(-1e6f), INT16_MIN);
+   CHECK_NEAR(ts.to_float(213), 21.3, 1e-5);
+}
+
+static void test_wrap_and_select_tier()
+{
+   SSW::TimeSeries<16, 8, 4> ts;
+   // 2 hours at one sample every 30 s
+   for ( uint32_t i = 0; i < 240; ++i )
+      ts.add(i * 30, static_cast<int16_t>(i));
+   CHECK_EQ(ts.size(TSTier::Raw), 16);
+   CHECK_EQ(ts.oldest(TSTier::Raw), 224 * 30);
+   CHECK_EQ(ts.size(TSTier::Minute), 8);
+   CHECK_EQ(ts.oldest(TSTier::Minute), 111 * 60);
+   CHECK_EQ(ts.size(TSTier::Hour), 1);
+
+   // Few enough raw samples: raw. Too many: minute. Older than the
+   // minute ring holds: hour.
+   CHECK(ts.select_tier(113 * 60, 120 * 60, 14) == TSTier::Raw);
+   CHECK(ts.select_tier(113 * 60, 120 * 60, 10) == TSTier::Minute);
+   CHECK(ts.select_tier(100 * 60, 120 * 60, 100) == TSTier::Hour);
+
+   ts.clear();
+   CHECK(!ts.has_data());
+   CHECK_EQ(collect(ts, TSTier::Hour, 0, UINT32_MAX).size(), 0);
+}
+
+static void test_accumulator_saturation()
+{
+   SSW::TSAccumulator acc;
+   acc.reset(0);
+   for ( uint32_t i = 0; i < UINT16_MAX; ++i )
+      acc.add(100);
+   // Past the count limit the mean must not drift, while min and max still follow
+   for ( uint32_t i = 0; i < 1000; ++i )
+      acc.add(-30000);
+   const TSRecord r = acc.record();
+   CHECK_EQ(r.count, UINT16_MAX);
+   CHECK_EQ(r.mean, 100);
+   CHECK_EQ(r.min, -30000);
+   CHECK_EQ(r.max, 100);
+
+   // Extremes for a full bucket fit the 32-bit sum
+   acc.reset(0);
+   for ( uint32_t i = 0; i < UINT16_MAX + 10U; ++i )
+      acc.add(INT16_MAX);
+   CHECK_EQ(acc.record().mean, INT16_MAX);
+}
+
+static void test_budget()
+{
+   using TS = SSW::BudgetedTimeSeries<8192>;
+   CHECK(sizeof(TS) <= 8192);
+   CHECK(TS::capacity(TSTier::Raw) > 0);
+   CHECK(TS::capacity(TSTier::Minute) > TS::capacity(TSTier::Hour));
+   // BudgetedTimeSeries<64> would fail to compile: the budget is below TS_OVERHEAD
+}
+
+int main()
+{
+   test_ring_buffer();
+   test_rollups();
+   test_out_of_order_and_fixed_point();
+   test_wrap_and_select_tier();
+   test_accumulator_saturation();
+   test_budget();
+   return check_result("time_series_test");
+}
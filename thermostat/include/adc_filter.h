@@ -0,0 +1,123 @@
+/////////////////////////////////////////////////////////////////////
+/// ADC decimation filter
+///
+/// Integer-only filter for oversampled ADC streams. Each group of
+/// MEDIAN_N raw samples is reduced to its median, which removes single
+/// sample spikes, and the medians are summed. take() returns the mean of
+/// the medians since the last take() with FRAC_BITS extra bits of
+/// resolution gained from the oversampling.
+///
+/// push() is O(1) and branch-light so it can keep up with the ADC DMA
+/// stream. No Arduino dependencies; this compiles on the host.
+/////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace SSW
+{
+
+/// @brief Orders a pair so that a <= b.
+inline void sort2(uint16_t& a, uint16_t& b)
+{
+  if ( a > b )
+  {
+    uint16_t t = a;
+    a = b;
+    b = t;
+  }
+} // sort2()
+
+/// @brief Median of three, using compare-exchange.
+inline uint16_t median3(uint16_t a, uint16_t b, uint16_t c)
+{
+  sort2(a, b);
+  sort2(b, c);
+  sort2(a, b);
+  return b;
+} // median3()
+
+/// @brief Median of five, using a seven compare-exchange network.
+inline uint16_t median5(uint16_t a, uint16_t b, uint16_t c, uint16_t d, uint16_t e)
+{
+  sort2(a, b);
+  sort2(d, e);
+  sort2(a, d);
+  sort2(b, e);
+  sort2(b, c);
+  sort2(c, d);
+  sort2(b, c);
+  return c;
+} // median5()
+
+/// @class AdcDecimator
+///
+/// @brief
+/// Median pre-filter followed by an averaging decimator.
+///
+/// @param MEDIAN_N: Median window, 1 (none), 3 or 5 samples.
+/// @param FRAC_BITS: Fractional bits in the result of take().
+template <unsigned MEDIAN_N = 3, unsigned FRAC_BITS = 4>
+class AdcDecimator
+{
+  static_assert(MEDIAN_N == 1 || MEDIAN_N == 3 || MEDIAN_N == 5, "Median window must be 1, 3 or 5");
+  static_assert(FRAC_BITS <= 8, "At most 8 fractional bits");
+
+public:
+  static constexpr unsigned frac_bits = FRAC_BITS;
+
+  /// @brief Adds one raw sample.
+  void push(uint16_t s)
+  {
+    _window[_n++] = s;
+    if ( _n == MEDIAN_N )
+    {
+      _sum += _median();
+      ++_count;
+      _n = 0;
+    }
+  } // push()
+
+  /// @brief Adds a block of raw samples.
+  void push(const uint16_t* s, size_t n)
+  {
+    for ( size_t i = 0; i < n; ++i )
+      push(s[i]);
+  } // push()
+
+  /// @brief Number of medians accumulated since the last take().
+  uint32_t count() const { return _count; }
+
+  /// @brief Returns the filtered value, scaled by 2^FRAC_BITS, and
+  /// starts a new averaging period. Returns 0 if nothing was accumulated.
+  uint32_t take()
+  {
+    if ( _count == 0 )
+      return 0;
+    uint32_t v = static_cast<uint32_t>(((_sum << FRAC_BITS) + _count / 2) / _count);
+    _sum = 0;
+    _count = 0;
+    return v;
+  } // take()
+
+  void reset() { _sum = 0; _count = 0; _n = 0; }
+
+private:
+  uint16_t _median() const
+  {
+    switch ( MEDIAN_N )
+    {
+      case 5: return median5(_window[0], _window[1], _window[2], _window[3], _window[4]);
+      case 3: return median3(_window[0], _window[1], _window[2]);
+      default: return _window[0];
+    }
+  } // _median()
+
+  uint16_t _window[MEDIAN_N];
+  unsigned _n {0};      ///< Samples in the median window
+  uint64_t _sum {0};    ///< Sum of medians
+  uint32_t _count {0};  ///< Number of medians summed
+}; // class AdcDecimator
+
+} // namespace SSW
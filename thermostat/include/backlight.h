@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace SSW
+{
+
+/// @brief A point on the ambient light to backlight level curve.
+struct AmbientPoint
+{
+  uint16_t light; ///< Light sensor level, ADC counts
+  uint8_t  level; ///< Perceptual backlight level, 0 - 255
+}; // struct AmbientPoint
+
+/// @class AmbientCurve
+///
+/// @brief
+/// Maps the light sensor level to a backlight level by interpolating
+/// between points sorted by light, and holding the end levels outside
+/// them. The output only moves when it changes by at least 'hysteresis'
+/// levels, so sensor noise and flicker do not keep restarting fades.
+/// No Arduino dependencies.
+class AmbientCurve
+{
+public:
+  template <size_t N>
+  explicit AmbientCurve(const AmbientPoint (&points)[N], uint8_t hysteresis = 8) :
+    _points(points),
+    _n(N),
+    _hysteresis(hysteresis)
+  {
+    static_assert(N >= 1, "AmbientCurve needs at least one point");
+  }
+
+  /// @brief The level for 'light', without hysteresis.
+  uint8_t map(uint16_t light) const
+  {
+    if ( light <= _points[0].light )
+      return _points[0].level;
+    for ( size_t i = 1; i < _n; ++i )
+    {
+      const AmbientPoint& a = _points[i - 1];
+      const AmbientPoint& b = _points[i];
+      if ( light <= b.light )
+        return static_cast<uint8_t>(a.level + (static_cast<int32_t>(b.level) - a.level) *
+          static_cast<int32_t>(light - a.light) / static_cast<int32_t>(b.light - a.light));
+    }
+    return _points[_n - 1].level;
+  } // map()
+
+  /// @brief Updates the output from a new light reading.
+  /// @return The output level
+  uint8_t update(uint16_t light)
+  {
+    const uint8_t level = map(light);
+    const int diff = static_cast<int>(level) - _level;
+    if ( !_valid || diff >= _hysteresis || -diff >= _hysteresis ||
+         level == _points[0].level || level == _points[_n - 1].level )
+    {
+      _level = level;
+      _valid = true;
+    }
+    return _level;
+  } // update()
+
+  /// @brief The output level; the last point's level before the first
+  /// update().
+  uint8_t level() const { return _valid ? _level : _points[_n - 1].level; }
+
+private:
+  const AmbientPoint* _points;
+  size_t _n;
+  uint8_t _hysteresis;
+  uint8_t _level {0};
+  bool _valid {false};
+}; // class AmbientCurve
+
+} // namespace SSW
+
+/// @class Backlight
+///
+/// @brief
+/// Backlight brightness on an LEDC PWM channel, with fades done by the
+/// LEDC hardware. Levels are perceptual (0 - 255); a CIE 1976 lightness
+/// table converts them to a 10-bit duty, so equal steps look equal and
+/// the bottom of the range is not one or two duty counts.
+///
+/// set_target() only records where to go. update(), called from loop(),
+/// starts the hardware fades: a fade is split into segments of at most
+/// SEGMENT_MS that are linear in perceptual level, and within a segment
+/// the LEDC steps the duty itself. Nothing is written to the LEDC while
+/// the level is steady. A new target takes effect at the end of the
+/// current segment, because the ESP-IDF fade cannot be interrupted.
+///
+/// Takes over the channel LovyanGFX's Light_PWM set up, at a higher
+/// resolution, so tft.setBrightness() must not be used afterwards.
+///
+/// @param pin: Backlight GPIO
+/// @param channel: Arduino LEDC channel number (0 - 15)
+/// @param freq_hz: PWM frequency
+class Backlight
+{
+public:
+  static constexpr unsigned DUTY_BITS = 10;
+  static constexpr uint32_t SEGMENT_MS = 200; ///< Longest hardware fade
+
+  Backlight(unsigned pin, unsigned channel, uint32_t freq_hz) :
+    _pin(pin),
+    _channel(channel),
+    _freq_hz(freq_hz)
+  {}
+
+  /// @brief Configures the channel and sets 'level' at once.
+  /// @return true for success
+  bool begin(uint8_t level);
+
+  /// @brief Fades to 'level' over 'fade_ms' (0 for a step), starting at
+  /// the end of the current segment. Setting the current target again
+  /// does nothing.
+  void set_target(uint8_t level, uint32_t fade_ms, uint32_t now_ms);
+
+  /// @brief Starts the next fade segment when one is due.
+  void update(uint32_t now_ms);
+
+  /// @brief The level the current segment ends at.
+  uint8_t level() const { return _level; }
+  uint8_t target() const { return _to; }
+  /// @brief True while a fade is under way. Always false if begin()
+  /// failed, since nothing will ever fade.
+  bool fading() const { return _ok && ( _level != _to || _in_segment ); }
+
+  /// @brief Duty for a perceptual level, 0 - (1 << DUTY_BITS) - 1.
+  static uint16_t duty(uint8_t level);
+
+private:
+  void _write(uint8_t level, uint32_t fade_ms);
+
+  unsigned _pin;
+  unsigned _channel;
+  uint32_t _freq_hz;
+  bool _ok {false};
+
+  uint8_t _from {0};        ///< Level the fade started from
+  uint8_t _to {0};          ///< Target level
+  uint8_t _level {0};       ///< Level at the end of the current segment
+  uint32_t _start_ms {0};   ///< Start of the fade
+  uint32_t _fade_ms {0};    ///< Length of the fade
+  uint32_t _seg_end_ms {0}; ///< End of the current segment
+  bool _in_segment {false}; ///< A hardware fade is running
+}; // class Backlight
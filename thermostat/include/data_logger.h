@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+#include "log_format.h"
+
+namespace SSW
+{
+
+/// @class BlockFile
+///
+/// @brief
+/// A file accessed only in whole LOG_BLOCK_SIZE blocks. Uses stdio, which
+/// the ESP32 routes through the VFS to the SD card (mounted at "/sd" by
+/// SD.begin()), so the same code runs against an ordinary file on the host.
+class BlockFile
+{
+public:
+  BlockFile() = default;
+  ~BlockFile() { close(); }
+
+  /// @brief Opens a file.
+  /// @param path: File path
+  /// @param create: If true, creates (or empties) the file.
+  /// @return true for success
+  bool open(const char* path, bool create);
+  void close();
+  bool is_open() const { return _fp != nullptr; }
+
+  /// @brief Number of whole blocks in the file. A trailing partial block
+  /// is not counted.
+  uint32_t block_count();
+
+  bool read_block(uint32_t pos, LogBlock& blk);
+  bool write_block(uint32_t pos, const LogBlock& blk);
+
+  /// @brief Flushes buffered data and the directory entry to the media.
+  bool sync();
+
+  /// @brief Discards everything from block 'blocks' onwards. Not every
+  /// file system supports this; callers must not depend on it succeeding.
+  bool truncate(uint32_t blocks);
+
+private:
+  FILE* _fp {nullptr};
+
+  BlockFile(const BlockFile&) = delete;
+  BlockFile& operator=(const BlockFile&) = delete;
+}; // class BlockFile
+
+/// @class DataLogger
+///
+/// @brief
+/// Append-only binary logger for sensor samples, set-point changes and
+/// network latency. See log_format.h for the file layout.
+///
+/// Records are staged in two RAM blocks. log() only copies a record into
+/// the active block and never touches the card, so it is safe to call
+/// from the control path. When the active block fills it is handed to
+/// the writer and the other block becomes active. service() writes the
+/// handed-over block as a single whole block, followed by an index
+/// block when a group completes. If the writer falls behind, records are
+/// dropped and counted rather than blocking the caller.
+///
+/// begin() recovers from power loss: trailing blocks that fail their
+/// CRC or sequence check are discarded and logging continues in the same
+/// file. Files are rotated when they reach max_blocks.
+///
+/// log() and service() must be called from the same task.
+///
+/// @param dir: Directory for the log files (e.g. "/sd/log")
+/// @param max_blocks: Rotation size of each file, in blocks
+/// @param flush_period_s: A partially filled block is written once it
+///   holds records older than this.
+class DataLogger
+{
+public:
+  static constexpr uint32_t DEFAULT_MAX_BLOCKS = 8U * 1024U; ///< 4 MB files
+  static constexpr uint32_t DEFAULT_FLUSH_PERIOD_S = 300U;
+
+  DataLogger(const char* dir, uint32_t max_blocks = DEFAULT_MAX_BLOCKS,
+    uint32_t flush_period_s = DEFAULT_FLUSH_PERIOD_S) :
+    _dir(dir),
+    _max_blocks(max_blocks < 3 * LOG_GROUP_BLOCKS ? 3 * LOG_GROUP_BLOCKS : max_blocks),
+    _flush_period_s(flush_period_s)
+  {}
+  ~DataLogger() {}
+
+  /// @brief Opens the newest log file in the directory, recovering it if
+  /// it was not closed cleanly, or creates the first one.
+  /// @param now: Current time in seconds
+  /// @return true if logging is possible.
+  bool begin(uint32_t now);
+
+  /// @brief Writes any staged records and a footer, then closes the file.
+  void end(uint32_t now);
+
+  bool ready() const { return _file.is_open(); }
+
+  /// @brief Stages a record. Never performs I/O. Records are ignored
+  /// until begin() has succeeded, so none carry times from before it.
+  /// @return false if the record was dropped or ignored.
+  bool log(const LogRecord& rec);
+
+  bool log_sample(uint32_t t, LogChannel ch, float value);
+  bool log_set_point(uint32_t t, float old_temp, float new_temp);
+  bool log_latency(uint32_t t, LogChannel ch, uint32_t latency_ms, bool ok);
+
+  /// @brief Writer side. Call from loop(). Writes at most one staged
+  /// block (and the index block following it, if any).
+  /// @param now: Current time in seconds
+  void service(uint32_t now);
+
+  uint32_t file_no() const { return _file_no; }
+  uint32_t dropped() const { return _dropped; }
+  uint32_t next_block() const { return _next_pos; }
+
+  /// @brief Builds the path of log file 'file_no' into 'buf'.
+  void file_path(uint32_t file_no, char* buf, size_t len) const;
+
+private:
+  bool _open_new(uint32_t file_no, uint32_t now);
+  bool _recover(uint32_t file_no, uint32_t now);
+  void _close_file();
+  void _hand_over();
+  bool _write_data_block(LogBlock& blk, uint16_t count, uint32_t now);
+  bool _write_index_block();
+  uint32_t _newest_file_no() const;
+
+  const char* _dir;           ///< Log directory
+  uint32_t _max_blocks;       ///< Rotation size in blocks
+  uint32_t _flush_period_s;   ///< Age at which a partial block is written
+
+  BlockFile _file;            ///< The current log file
+  uint32_t _file_no {0};      ///< Rotation number of the current file
+  uint32_t _next_pos {0};     ///< Position of the next block to write
+
+  LogBlock _stage[2];         ///< Double-buffered staging blocks
+  uint8_t  _active {0};       ///< Staging block receiving records
+  uint16_t _fill {0};         ///< Records in the active block
+  uint32_t _active_since {0}; ///< Time of the first record in the active block
+  bool     _pending {false};  ///< The other block is waiting to be written
+  uint16_t _pending_count {0};///< Records in the pending block
+
+  LogIndexEntry _index[LOG_INDEX_PER_BLOCK]; ///< Entries for the current group
+  uint16_t _index_count {0};  ///< Entries in _index
+
+  LogFooter _summary {};      ///< Running totals for the footer
+  uint32_t  _dropped {0};     ///< Records dropped since begin()
+}; // class DataLogger
+
+} // namespace SSW
+
+extern SSW::DataLogger data_logger; ///< The thermostat's SD card logger
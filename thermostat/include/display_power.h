@@ -0,0 +1,102 @@
+/////////////////////////////////////////////////////////////////////
+/// Display power state
+///
+/// Decides how much of the display pipeline runs, from room presence
+/// (OccupancyTracker) and user input (touch, the encoder and its
+/// button):
+///
+///   Active     Presence or input within dim_ms: full backlight,
+///              rendering
+///   Dim        No presence or input for dim_ms .. suspend_ms: dim
+///              backlight, still rendering
+///   Suspended  Nothing for suspend_ms or longer: backlight off, panel
+///              asleep, no rendering, flushing or touch reads
+///
+/// Any presence or input goes straight to Active, from any state.
+/// Times are milliseconds from millis() and may wrap. No Arduino
+/// dependencies.
+/////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+
+namespace SSW
+{
+
+enum class DisplayState : uint8_t
+{
+  Active = 0,
+  Dim = 1,
+  Suspended = 2
+}; // enum class DisplayState
+
+inline const char* display_state_name(DisplayState s)
+{
+  switch ( s )
+  {
+    case DisplayState::Active: return "active";
+    case DisplayState::Dim: return "dim";
+    case DisplayState::Suspended:
+    default: return "suspended";
+  }
+} // display_state_name()
+
+/// @class DisplayPower
+///
+/// @brief Display power state machine.
+/// @param dim_ms: Time without presence or input before dimming.
+/// @param suspend_ms: Time without presence or input before suspending.
+class DisplayPower
+{
+public:
+  DisplayPower(uint32_t dim_ms, uint32_t suspend_ms) :
+    _dim_ms(dim_ms),
+    _suspend_ms(suspend_ms < dim_ms ? dim_ms : suspend_ms)
+  {}
+
+  void begin(uint32_t now_ms)
+  {
+    _last_activity_ms = now_ms;
+    _state = DisplayState::Active;
+  } // begin()
+
+  /// @brief Records user input. Takes effect on the next update().
+  void input(uint32_t now_ms)
+  {
+    _last_activity_ms = now_ms;
+  } // input()
+
+  /// @brief Re-evaluates the state.
+  /// @param present: The room is occupied, i.e. OccupancyTracker::present()
+  /// @return true if the state changed since the last call.
+  bool update(bool present, uint32_t now_ms)
+  {
+    if ( present )
+      _last_activity_ms = now_ms;
+
+    const uint32_t idle = now_ms - _last_activity_ms;
+    DisplayState next = DisplayState::Active;
+    if ( idle >= _suspend_ms )
+      next = DisplayState::Suspended;
+    else if ( idle >= _dim_ms )
+      next = DisplayState::Dim;
+    // Keep 'idle' from wrapping back to Active during a long absence
+    if ( next == DisplayState::Suspended )
+      _last_activity_ms = now_ms - _suspend_ms;
+
+    const bool changed = ( next != _state );
+    _state = next;
+    return changed;
+  } // update()
+
+  DisplayState state() const { return _state; }
+  bool suspended() const { return _state == DisplayState::Suspended; }
+
+private:
+  uint32_t _dim_ms;
+  uint32_t _suspend_ms;
+  uint32_t _last_activity_ms {0};
+  DisplayState _state {DisplayState::Active};
+}; // class DisplayPower
+
+} // namespace SSW
@@ -0,0 +1,189 @@
+/////////////////////////////////////////////////////////////////////
+/// Integer-only signal filters
+///
+/// SSW::Filter<Kind, Q> smooths a stream of integer sensor readings
+/// (e.g. hundredths of a degree) without any floating point, so it runs
+/// in constant time on both the ESP8266 and the ESP32. Internal state is
+/// kept in Q fractional bits in 64-bit integers. Coefficients are Q16
+/// fractions: 65536 represents 1.0 (use SSW::q16() to convert a
+/// constant at compile time).
+///
+///   FilterKind::EMA        y += alpha * (x - y)
+///   FilterKind::AlphaBeta  Constant-rate tracker: position and rate,
+///                          corrected by alpha and beta.
+///   FilterKind::Kalman     1-D random-walk Kalman filter with process
+///                          noise q and measurement noise r.
+///
+/// The first sample initialises the state, so there is no start-up ramp.
+/////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+
+namespace SSW
+{
+
+enum class FilterKind : uint8_t
+{
+  EMA,
+  AlphaBeta,
+  Kalman
+}; // enum class FilterKind
+
+/// @brief Converts a fraction to Q16 at compile time.
+constexpr uint32_t q16(double f)
+{
+  return static_cast<uint32_t>(f * 65536.0 + 0.5);
+} // q16()
+
+/// @brief Divides by 2^bits, rounding to nearest (half away from zero).
+inline int64_t fx_round_shift(int64_t v, unsigned bits)
+{
+  const int64_t half = static_cast<int64_t>(1) << (bits - 1);
+  return v >= 0 ? (v + half) >> bits : -((-v + half) >> bits);
+} // fx_round_shift()
+
+template <FilterKind K, unsigned Q = 16>
+class Filter;
+
+/// @brief Exponential moving average.
+template <unsigned Q>
+class Filter<FilterKind::EMA, Q>
+{
+  static_assert(Q >= 1 && Q <= 24, "Q must be 1..24");
+
+public:
+  struct Config
+  {
+    uint32_t alpha; ///< Q16 smoothing factor, 0 < alpha <= 1.0
+  };
+
+  explicit Filter(const Config& cfg) : _cfg(cfg) {}
+
+  int32_t step(int32_t x)
+  {
+    const int64_t xq = static_cast<int64_t>(x) * (static_cast<int64_t>(1) << Q);
+    if ( !_init )
+    {
+      _y = xq;
+      _init = true;
+    }
+    else
+    {
+      _y += fx_round_shift((xq - _y) * static_cast<int64_t>(_cfg.alpha), 16);
+    }
+    return value();
+  } // step()
+
+  int32_t value() const { return static_cast<int32_t>(fx_round_shift(_y, Q)); }
+  void reset() { _init = false; }
+
+private:
+  Config  _cfg;
+  int64_t _y {0};
+  bool    _init {false};
+}; // class Filter<EMA>
+
+/// @brief Alpha-beta (g-h) tracker. Follows a steady trend without the
+/// lag of an EMA.
+template <unsigned Q>
+class Filter<FilterKind::AlphaBeta, Q>
+{
+  static_assert(Q >= 1 && Q <= 24, "Q must be 1..24");
+
+public:
+  struct Config
+  {
+    uint32_t alpha; ///< Q16 position correction gain
+    uint32_t beta;  ///< Q16 rate correction gain
+  };
+
+  explicit Filter(const Config& cfg) : _cfg(cfg) {}
+
+  int32_t step(int32_t x)
+  {
+    const int64_t xq = static_cast<int64_t>(x) * (static_cast<int64_t>(1) << Q);
+    if ( !_init )
+    {
+      _x = xq;
+      _v = 0;
+      _init = true;
+    }
+    else
+    {
+      const int64_t predicted = _x + _v;
+      const int64_t residual = xq - predicted;
+      _x = predicted + fx_round_shift(residual * static_cast<int64_t>(_cfg.alpha), 16);
+      _v += fx_round_shift(residual * static_cast<int64_t>(_cfg.beta), 16);
+    }
+    return value();
+  } // step()
+
+  int32_t value() const { return static_cast<int32_t>(fx_round_shift(_x, Q)); }
+
+  /// @brief Estimated rate of change per sample, Q fractional bits.
+  int64_t rate_fixed() const { return _v; }
+
+  void reset() { _init = false; }
+
+private:
+  Config  _cfg;
+  int64_t _x {0};
+  int64_t _v {0};
+  bool    _init {false};
+}; // class Filter<AlphaBeta>
+
+/// @brief One-dimensional Kalman filter for a slowly wandering value.
+/// The gain adapts from the noise figures and settles at a constant.
+template <unsigned Q>
+class Filter<FilterKind::Kalman, Q>
+{
+  static_assert(Q >= 1 && Q <= 24, "Q must be 1..24");
+
+public:
+  struct Config
+  {
+    uint32_t q;  ///< Process noise variance per sample, input units squared, Q16
+    uint32_t r;  ///< Measurement noise variance, input units squared, Q16
+    uint32_t p0; ///< Initial estimate variance, input units squared, Q16
+  };
+
+  explicit Filter(const Config& cfg) : _cfg(cfg) {}
+
+  int32_t step(int32_t x)
+  {
+    const int64_t xq = static_cast<int64_t>(x) * (static_cast<int64_t>(1) << Q);
+    if ( !_init )
+    {
+      _x = xq;
+      _p = _cfg.p0;
+      _init = true;
+    }
+    else
+    {
+      // Predict: the value may have wandered by q.
+      _p += _cfg.q;
+      // Update: gain k = p / (p + r), Q16.
+      const int64_t denom = _p + static_cast<int64_t>(_cfg.r);
+      const int64_t k = denom > 0 ? ((_p << 16) + denom / 2) / denom : 0;
+      _x += fx_round_shift((xq - _x) * k, 16);
+      _p = fx_round_shift((65536 - k) * _p, 16);
+    }
+    return value();
+  } // step()
+
+  int32_t value() const { return static_cast<int32_t>(fx_round_shift(_x, Q)); }
+
+  /// @brief Current estimate variance, Q16.
+  int64_t variance() const { return _p; }
+
+  void reset() { _init = false; }
+
+private:
+  Config  _cfg;
+  int64_t _x {0};
+  int64_t _p {0};  ///< Estimate variance, Q16
+  bool    _init {false};
+}; // class Filter<Kalman>
+
+} // namespace SSW
@@ -0,0 +1,122 @@
+/////////////////////////////////////////////////////////////////////
+/// BSD sockets backend for SSW::HttpServer
+///
+/// Works with any POSIX sockets implementation: Linux and macOS on the
+/// host, and lwIP on the ESP32. Every socket is non-blocking, so
+/// HttpServer::poll() never waits.
+/////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(ESP_PLATFORM)
+#include <fcntl.h>
+#include <lwip/sockets.h>
+#include <unistd.h>
+#else
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace SSW
+{
+
+class PosixBackend
+{
+public:
+  using Socket = int;
+
+  ~PosixBackend() { end(); }
+
+  /// @brief Opens the listening socket.
+  /// @return false if the port could not be bound
+  bool begin(uint16_t port, int backlog = 8)
+  {
+    _listen = socket(AF_INET, SOCK_STREAM, 0);
+    if ( _listen < 0 )
+      return false;
+
+    int one = 1;
+    setsockopt(_listen, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if ( bind(_listen, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(_listen, backlog) < 0 )
+    {
+      end();
+      return false;
+    }
+    _nonblocking(_listen);
+    return true;
+  } // begin()
+
+  void end()
+  {
+    if ( _listen >= 0 )
+      ::close(_listen);
+    _listen = -1;
+  } // end()
+
+  bool accept(Socket& s)
+  {
+    if ( _listen < 0 )
+      return false;
+    int fd = ::accept(_listen, nullptr, nullptr);
+    if ( fd < 0 )
+      return false;
+    _nonblocking(fd);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    s = fd;
+    return true;
+  } // accept()
+
+  static int recv(Socket& s, char* buf, size_t n)
+  {
+    ssize_t r = ::recv(s, buf, n, 0);
+    if ( r > 0 )
+      return static_cast<int>(r);
+    if ( r < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ) )
+      return 0;
+    return -1; // Closed by the peer, or failed
+  } // recv()
+
+  static int send(Socket& s, const char* buf, size_t n)
+  {
+    ssize_t r = ::send(s, buf, n, MSG_NOSIGNAL);
+    if ( r >= 0 )
+      return static_cast<int>(r);
+    if ( errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR )
+      return 0;
+    return -1;
+  } // send()
+
+  static void close(Socket& s)
+  {
+    if ( s >= 0 )
+      ::close(s);
+    s = -1;
+  } // close()
+
+private:
+  static void _nonblocking(int fd)
+  {
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+  } // _nonblocking()
+
+  int _listen {-1};
+}; // class PosixBackend
+
+} // namespace SSW
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+
+#include "adc_filter.h"
+
+/// @class LightSensor
+///
+/// @brief
+/// Continuous-mode ADC1 sampling of the light sensor. The ADC digital
+/// controller streams conversions into a DMA ring buffer at
+/// SAMPLE_RATE_HZ without CPU involvement. A low-priority task drains the
+/// ring, median-filters and averages the samples (SSW::AdcDecimator) and
+/// publishes a clean level every publish_period_ms.
+///
+/// level() only reads the last published value, so it is cheap enough
+/// to call from loop() or the GUI as often as needed.
+///
+/// @param channel: ADC1 channel number (0 for GPIO36)
+/// @param publish_period_ms: Time between published levels
+/// @remarks analogRead() must not be used on ADC1 while this is running.
+class LightSensor
+{
+public:
+  static constexpr uint32_t SAMPLE_RATE_HZ = 20000; ///< Lowest rate the ESP32 digital controller supports
+  static constexpr uint16_t MAX_LEVEL = 4095;       ///< Full scale, 12-bit ADC counts
+  using Filter = SSW::AdcDecimator<5, 4>;
+
+  LightSensor(unsigned channel, unsigned publish_period_ms = 1000) :
+    _channel(channel),
+    _publish_period_ms(publish_period_ms)
+  {}
+  ~LightSensor() { end(); }
+
+  /// @brief Starts the DMA sampling and the filter task.
+  /// @return true for success
+  bool begin();
+
+  /// @brief Stops sampling.
+  void end();
+
+  /// @brief Changes the time between published levels.
+  void set_publish_period(unsigned ms) { _publish_period_ms = ms; }
+
+  /// @brief True once the first level has been published.
+  bool available() const { return _seq != 0; }
+
+  /// @brief The latest published level in ADC counts (0 - MAX_LEVEL).
+  uint16_t level() const { return static_cast<uint16_t>((_level_q + (1U << (Filter::frac_bits - 1))) >> Filter::frac_bits); }
+
+  /// @brief The latest published level with Filter::frac_bits fractional bits.
+  uint32_t level_fixed() const { return _level_q; }
+
+  /// @brief Increments each time a new level is published.
+  uint32_t sequence() const { return _seq; }
+
+private:
+  static void _task_entry(void* arg);
+  void _run();
+
+  unsigned _channel;                 ///< ADC1 channel
+  volatile unsigned _publish_period_ms;
+  volatile uint32_t _level_q {0};    ///< Published level, fixed point
+  volatile uint32_t _seq {0};        ///< Publish counter
+  volatile bool _running {false};
+  void* volatile _task {nullptr};    ///< FreeRTOS task handle
+  Filter _filter;
+}; // class LightSensor
@@ -0,0 +1,207 @@
+/////////////////////////////////////////////////////////////////////
+/// Thermostat binary log format
+///
+/// Shared by the device logger (data_logger.h) and the host analysis
+/// tools. A log file is a sequence of 512-byte blocks:
+///
+///   block 0               File header
+///   blocks 1..31          Data blocks (31 records each)
+///   block 32              Index block describing blocks 1..31
+///   blocks 33..63         Data blocks
+///   block 64              Index block describing blocks 33..63
+///   ...
+///   last block            Footer (only if the file was closed cleanly)
+///
+/// Every block starts with a LogBlockHeader whose 'seq' is the block's
+/// position in the file and whose CRC covers the whole block. Index
+/// blocks always sit at positions that are multiples of LOG_GROUP_BLOCKS,
+/// so a reader can seek straight to them. Anything after the last block
+/// with a valid CRC and matching sequence number is the remains of an
+/// interrupted write and is ignored.
+///
+/// All fields are little-endian (native on both the ESP32 and x86).
+/////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace SSW
+{
+
+static constexpr size_t   LOG_BLOCK_SIZE = 512U;
+static constexpr uint32_t LOG_MAGIC = 0x4C575353U; ///< "SSWL"
+static constexpr uint8_t  LOG_VERSION = 1U;
+
+enum class LogBlockType : uint8_t
+{
+  FileHeader = 1,
+  Data = 2,
+  Index = 3,
+  Footer = 4
+}; // enum class LogBlockType
+
+enum class LogRecordType : uint8_t
+{
+  Sample = 1,     ///< Sensor sample. a = value * 100.
+  SetPoint = 2,   ///< Set-point change. a = old, b = new, tenths of a degree.
+  NetLatency = 3  ///< Network request. a = latency in ms, b = 1 for success, 0 for failure.
+}; // enum class LogRecordType
+
+/// @brief Sensor channels for LogRecordType::Sample records.
+enum class LogChannel : uint8_t
+{
+  Temp = 1,         ///< Living room temperature, degrees F
+  Humidity = 2,     ///< Living room humidity, percent
+  Light = 3,        ///< Light level, ADC counts
+  OutsideTemp = 4,  ///< Outside temperature, degrees F
+  FamRoomTemp = 5,  ///< Family room temperature, degrees F
+  CtrlServer = 16,  ///< Network latency: control server
+  OtherDevice = 17  ///< Network latency: any other device
+}; // enum class LogChannel
+
+/// @brief Scale applied to sample values stored in LogRecord::a.
+static constexpr int32_t LOG_SAMPLE_SCALE = 100;
+
+struct LogBlockHeader
+{
+  uint32_t magic;   ///< LOG_MAGIC
+  uint32_t seq;     ///< Position of the block in the file
+  uint8_t  type;    ///< LogBlockType
+  uint8_t  version; ///< LOG_VERSION
+  uint16_t count;   ///< Number of records or index entries in the block
+  uint32_t crc;     ///< CRC-32 of the whole block, computed with this field zero
+}; // struct LogBlockHeader
+
+struct LogRecord
+{
+  uint32_t t;       ///< Time, seconds since the epoch
+  uint8_t  type;    ///< LogRecordType
+  uint8_t  channel; ///< LogChannel
+  uint16_t flags;   ///< Reserved, zero
+  int32_t  a;       ///< First value, meaning depends on type
+  int32_t  b;       ///< Second value, meaning depends on type
+}; // struct LogRecord
+
+/// @brief Describes one data block. Index blocks hold one per data
+/// block in the preceding group.
+struct LogIndexEntry
+{
+  uint32_t block;   ///< Position of the data block
+  uint32_t first_t; ///< Time of the first record in the block
+  uint32_t last_t;  ///< Time of the last record in the block
+  uint16_t count;   ///< Records in the block
+  uint16_t reserved;
+}; // struct LogIndexEntry
+
+struct LogFileInfo
+{
+  uint32_t file_no;        ///< Rotation number of this file
+  uint32_t created_t;      ///< Time the file was created
+  uint32_t max_blocks;     ///< Rotation size of the file in blocks
+  uint16_t group_blocks;   ///< LOG_GROUP_BLOCKS
+  uint16_t record_size;    ///< sizeof(LogRecord)
+}; // struct LogFileInfo
+
+struct LogFooter
+{
+  uint32_t first_t;     ///< Time of the first record in the file
+  uint32_t last_t;      ///< Time of the last record in the file
+  uint32_t records;     ///< Records in the file
+  uint32_t data_blocks; ///< Data blocks in the file
+  uint32_t dropped;     ///< Records dropped because the writer fell behind
+}; // struct LogFooter
+
+static constexpr size_t LOG_PAYLOAD_SIZE = LOG_BLOCK_SIZE - sizeof(LogBlockHeader);
+static constexpr size_t LOG_RECORDS_PER_BLOCK = LOG_PAYLOAD_SIZE / sizeof(LogRecord);
+static constexpr size_t LOG_INDEX_PER_BLOCK = LOG_PAYLOAD_SIZE / sizeof(LogIndexEntry);
+/// Blocks per group: the data blocks plus the index block that ends the group.
+static constexpr uint32_t LOG_GROUP_BLOCKS = LOG_INDEX_PER_BLOCK + 1;
+
+static_assert(sizeof(LogBlockHeader) == 16, "LogBlockHeader layout changed");
+static_assert(sizeof(LogRecord) == 16, "LogRecord layout changed");
+static_assert(sizeof(LogIndexEntry) == 16, "LogIndexEntry layout changed");
+static_assert(LOG_RECORDS_PER_BLOCK == 31, "Unexpected records per block");
+
+/// @brief A block as laid out in the file.
+union LogBlock
+{
+  uint8_t bytes[LOG_BLOCK_SIZE];
+  struct
+  {
+    LogBlockHeader hdr;
+    union
+    {
+      LogRecord     records[LOG_RECORDS_PER_BLOCK];
+      LogIndexEntry index[LOG_INDEX_PER_BLOCK];
+      LogFileInfo   info;
+      LogFooter     footer;
+      uint8_t       payload[LOG_PAYLOAD_SIZE];
+    };
+  };
+}; // union LogBlock
+
+static_assert(sizeof(LogBlock) == LOG_BLOCK_SIZE, "LogBlock must be exactly one block");
+
+/// @brief True if the position holds an index block.
+inline bool log_is_index_pos(uint32_t pos)
+{
+  return pos > 0 && (pos % LOG_GROUP_BLOCKS) == 0;
+} // log_is_index_pos()
+
+/// @brief Lookup table for log_crc32().
+struct LogCrcTable
+{
+  uint32_t entry[256];
+
+  LogCrcTable()
+  {
+    for ( uint32_t i = 0; i < 256; ++i )
+    {
+      uint32_t c = i;
+      for ( int k = 0; k < 8; ++k )
+        c = (c & 1U) ? (0xEDB88320U ^ (c >> 1)) : (c >> 1);
+      entry[i] = c;
+    }
+  }
+}; // struct LogCrcTable
+
+/// @brief CRC-32 (IEEE 802.3, reflected). The table is built on first use.
+inline uint32_t log_crc32(const uint8_t* data, size_t len, uint32_t crc = 0)
+{
+  static const LogCrcTable table;
+
+  crc = ~crc;
+  for ( size_t i = 0; i < len; ++i )
+    crc = table.entry[(crc ^ data[i]) & 0xFFU] ^ (crc >> 8);
+  return ~crc;
+} // log_crc32()
+
+/// @brief Fills in the header of a block and computes its CRC.
+inline void log_seal_block(LogBlock& blk, uint32_t seq, LogBlockType type, uint16_t count)
+{
+  blk.hdr.magic = LOG_MAGIC;
+  blk.hdr.seq = seq;
+  blk.hdr.type = static_cast<uint8_t>(type);
+  blk.hdr.version = LOG_VERSION;
+  blk.hdr.count = count;
+  blk.hdr.crc = 0;
+  blk.hdr.crc = log_crc32(blk.bytes, LOG_BLOCK_SIZE);
+} // log_seal_block()
+
+/// @brief Checks magic, position and CRC of a block read from a file.
+inline bool log_block_valid(const LogBlock& blk, uint32_t seq)
+{
+  if ( blk.hdr.magic != LOG_MAGIC || blk.hdr.seq != seq || blk.hdr.version != LOG_VERSION )
+    return false;
+  // The CRC was computed with the crc field zeroed.
+  static const uint8_t zero[sizeof(blk.hdr.crc)] = {0};
+  const size_t crc_ofs = offsetof(LogBlockHeader, crc);
+  uint32_t crc = log_crc32(blk.bytes, crc_ofs);
+  crc = log_crc32(zero, sizeof(zero), crc);
+  crc = log_crc32(blk.bytes + crc_ofs + sizeof(zero), LOG_BLOCK_SIZE - crc_ofs - sizeof(zero), crc);
+  return crc == blk.hdr.crc;
+} // log_block_valid()
+
+} // namespace SSW
@@ -13,6 +13,13 @@
 
 static const unsigned TFT_HEIGHT = 320U;
 static const unsigned TFT_WIDTH = 240U;
+static const unsigned TFT_BL_PIN = 5U;            ///< Backlight
+static const unsigned TFT_BL_PWM_CHANNEL = 7U;    ///< LEDC channel; Backlight takes it over after begin()
+static const uint32_t TFT_BL_PWM_HZ = 44100U;
+/// XPT2046 PENIRQ for PenIrqTouch, or -1 to poll the panel. Opt-in: set it
+/// to the GPIO T_IRQ is wired to (e.g. 34). GPIOs 34-39 have no internal
+/// pull-up, so they need the module's or an external one (10k to 3.3V).
+static const int TOUCH_IRQ_PIN = -1;
 
 class LGFX : public lgfx::LGFX_Device
 {
@@ -68,10 +75,10 @@ public:
       // Backlight LED control
       auto cfg = _light_instance.config();    // バックライト設定用の構造体を取得します。
 
-      cfg.pin_bl = 5;              // バックライトが接続されているピン番号
+      cfg.pin_bl = TFT_BL_PIN;            // バックライトが接続されているピン番号
       cfg.invert = false;           // バックライトの輝度を反転させる場合 true
-      cfg.freq   = 44100;           // バックライトのPWM周波数
-      cfg.pwm_channel = 7;          // 使用するPWMのチャンネル番号
+      cfg.freq   = TFT_BL_PWM_HZ;         // バックライトのPWM周波数
+      cfg.pwm_channel = TFT_BL_PWM_CHANNEL;        // 使用するPWMのチャンネル番号
 
       _light_instance.config(cfg);
       _panel_instance.setLight(&_light_instance);  // バックライトをパネルにセットします。
@@ -83,7 +90,7 @@ public:
       cfg.x_max      = TFT_WIDTH-1;  // タッチスクリーンから得られる最大のX値(生の値)
       cfg.y_min      = 0;    // タッチスクリーンから得られる最小のY値(生の値)
       cfg.y_max      = TFT_HEIGHT-1;  // タッチスクリーンから得られる最大のY値(生の値)
-      cfg.pin_int    = -1;   // INTが接続されているピン番号
+      cfg.pin_int    = -1;   // INTが接続されているピン番号 (PENIRQ is TOUCH_IRQ_PIN, handled by PenIrqTouch)
       cfg.bus_shared = true; // 画面と共通のバスを使用している場合 trueを設定
       cfg.offset_rotation = 0;// 表示とタッチの向きのが一致しない場合の調整 0~7の値で設定
       cfg.spi_host = VSPI_HOST;// 使用するSPIを選択 (HSPI_HOST or VSPI_HOST)
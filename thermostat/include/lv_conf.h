@@ -28,7 +28,7 @@
 #define LV_COLOR_DEPTH 16
 
 /*Swap the 2 bytes of RGB565 color. Useful if the display has an 8-bit interface (e.g. SPI)*/
-#define LV_COLOR_16_SWAP 0
+#define LV_COLOR_16_SWAP 1
 
 /*Enable features to draw on transparent background.
  *It's required if opa, and transform_* style properties are used.
@@ -349,6 +349,14 @@
  *   FONT USAGE
  *===================*/
 
+/*Reduced fonts for the screen labels, generated before the build by
+ *tools/fonts/make_fonts.py, which defines UI_SUBSET_FONTS=1 once they exist
+ *(custom_ui_fonts in platformio.ini). The stock fonts they replace are then
+ *left out.*/
+#ifndef UI_SUBSET_FONTS
+#define UI_SUBSET_FONTS 0
+#endif
+
 /*Montserrat fonts with ASCII range and some symbols using bpp = 4
  *https://fonts.google.com/specimen/Montserrat*/
 #define LV_FONT_MONTSERRAT_8  0
@@ -356,9 +364,9 @@
 #define LV_FONT_MONTSERRAT_12 0
 #define LV_FONT_MONTSERRAT_14 1
 #define LV_FONT_MONTSERRAT_16 0
-#define LV_FONT_MONTSERRAT_18 1
+#define LV_FONT_MONTSERRAT_18 (!UI_SUBSET_FONTS)
 #define LV_FONT_MONTSERRAT_20 0
-#define LV_FONT_MONTSERRAT_22 1
+#define LV_FONT_MONTSERRAT_22 (!UI_SUBSET_FONTS)
 #define LV_FONT_MONTSERRAT_24 1
 #define LV_FONT_MONTSERRAT_26 0
 #define LV_FONT_MONTSERRAT_28 1
@@ -368,7 +376,7 @@
 #define LV_FONT_MONTSERRAT_36 0
 #define LV_FONT_MONTSERRAT_38 0
 #define LV_FONT_MONTSERRAT_40 0
-#define LV_FONT_MONTSERRAT_42 1
+#define LV_FONT_MONTSERRAT_42 (!UI_SUBSET_FONTS)
 #define LV_FONT_MONTSERRAT_44 0
 #define LV_FONT_MONTSERRAT_46 0
 #define LV_FONT_MONTSERRAT_48 0
@@ -386,7 +394,11 @@
 /*Optionally declare custom fonts here.
  *You can use these fonts as default font too and they will be available globally.
  *E.g. #define LV_FONT_CUSTOM_DECLARE   LV_FONT_DECLARE(my_font_1) LV_FONT_DECLARE(my_font_2)*/
+#if UI_SUBSET_FONTS
+#define LV_FONT_CUSTOM_DECLARE LV_FONT_DECLARE(ui_font_18) LV_FONT_DECLARE(ui_font_22) LV_FONT_DECLARE(ui_font_42)
+#else
 #define LV_FONT_CUSTOM_DECLARE
+#endif
 
 /*Always set a default font*/
 #define LV_FONT_DEFAULT &lv_font_montserrat_14
@@ -396,8 +408,12 @@
  *Compiler error will be triggered if a font needs it.*/
 #define LV_FONT_FMT_TXT_LARGE 0
 
-/*Enables/disables support for compressed fonts.*/
+/*Enables/disables support for compressed fonts.
+ *Off until compressing a screen font measures as a saving (host/build.sh
+ *prints the sizes, host/font_bench the draw times)*/
+#ifndef LV_USE_FONT_COMPRESSED
 #define LV_USE_FONT_COMPRESSED 0
+#endif
 
 /*Enable subpixel rendering*/
 #define LV_USE_FONT_SUBPX 0
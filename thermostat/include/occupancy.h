@@ -0,0 +1,191 @@
+/////////////////////////////////////////////////////////////////////
+/// Occupancy tracking from PIR motion edges
+///
+/// The PIR interrupt handler timestamps each edge and pushes it into an
+/// EdgeQueue. loop() drains the queue into an OccupancyTracker, which
+/// turns the edges into a room state with configurable hold times:
+///
+///   Present        PIR output high, or low for less than present_hold_ms
+///   RecentlyLeft   No motion for present_hold_ms .. away_ms
+///   Away           No motion for away_ms or longer
+///
+/// Times are milliseconds from millis() and may wrap. No Arduino
+/// dependencies, so edge traces can be replayed on the host.
+/////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace SSW
+{
+
+/// @brief A timestamped PIR output transition.
+struct PirEdge
+{
+  uint32_t t_ms; ///< millis() at the edge
+  bool     high; ///< Level after the edge
+}; // struct PirEdge
+
+/// @class EdgeQueue
+/// @brief Single-producer (ISR), single-consumer (loop) queue. When full,
+/// new edges are dropped and counted; the consumer still sees the level
+/// the PIR settled to on the next edge.
+template <size_t N>
+class EdgeQueue
+{
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "EdgeQueue size must be a power of two");
+
+public:
+  /// @brief Called from the ISR.
+  bool push(uint32_t t_ms, bool high)
+  {
+    uint32_t head = _head;
+    if ( head - _tail == N )
+    {
+      _dropped = _dropped + 1;
+      return false;
+    }
+    _edges[head & (N - 1)].t_ms = t_ms;
+    _edges[head & (N - 1)].high = high;
+    _head = head + 1;
+    return true;
+  } // push()
+
+  /// @brief Called from loop().
+  bool pop(PirEdge& e)
+  {
+    uint32_t tail = _tail;
+    if ( tail == _head )
+      return false;
+    e.t_ms = _edges[tail & (N - 1)].t_ms;
+    e.high = _edges[tail & (N - 1)].high;
+    _tail = tail + 1;
+    return true;
+  } // pop()
+
+  uint32_t dropped() const { return _dropped; }
+
+private:
+  volatile PirEdge  _edges[N];
+  volatile uint32_t _head {0};    ///< Written only by the producer
+  volatile uint32_t _tail {0};    ///< Written only by the consumer
+  volatile uint32_t _dropped {0};
+}; // class EdgeQueue
+
+enum class Occupancy : uint8_t
+{
+  Away = 0,
+  Present = 1,
+  RecentlyLeft = 2
+}; // enum class Occupancy
+
+inline const char* occupancy_name(Occupancy o)
+{
+  switch ( o )
+  {
+    case Occupancy::Present: return "present";
+    case Occupancy::RecentlyLeft: return "recently left";
+    case Occupancy::Away:
+    default: return "away";
+  }
+} // occupancy_name()
+
+/// @class OccupancyTracker
+///
+/// @brief Room occupancy state machine driven by PIR edges.
+/// @param present_hold_ms: How long the room stays Present after the
+///   PIR output drops.
+/// @param away_ms: How long after the last motion the room is Away.
+class OccupancyTracker
+{
+public:
+  OccupancyTracker(uint32_t present_hold_ms, uint32_t away_ms) :
+    _present_hold_ms(present_hold_ms),
+    _away_ms(away_ms < present_hold_ms ? present_hold_ms : away_ms)
+  {}
+
+  void set_hold_times(uint32_t present_hold_ms, uint32_t away_ms)
+  {
+    _present_hold_ms = present_hold_ms;
+    _away_ms = away_ms < present_hold_ms ? present_hold_ms : away_ms;
+  } // set_hold_times()
+
+  /// @brief Sets the initial PIR level, e.g. from digitalRead() at startup.
+  void begin(bool high, uint32_t now_ms)
+  {
+    _high = high;
+    _last_motion_ms = now_ms;
+    _state = high ? Occupancy::Present : Occupancy::Away;
+  } // begin()
+
+  /// @brief Applies one edge. Edges must be applied in order.
+  void edge(const PirEdge& e)
+  {
+    _high = e.high;
+    // Any activity (rising or falling) counts as motion at that time.
+    _last_motion_ms = e.t_ms;
+    if ( e.high )
+    {
+      ++_motion_events;
+      _state = Occupancy::Present;
+    }
+  } // edge()
+
+  /// @brief Re-evaluates the hold timers.
+  /// @return true if the state changed since the last call.
+  bool update(uint32_t now_ms)
+  {
+    Occupancy next = _state;
+    if ( _high )
+    {
+      next = Occupancy::Present;
+    }
+    else
+    {
+      uint32_t idle = now_ms - _last_motion_ms;
+      if ( idle >= _away_ms )
+        next = Occupancy::Away;
+      else if ( idle >= _present_hold_ms )
+        next = Occupancy::RecentlyLeft;
+      else
+        next = Occupancy::Present;
+    }
+
+    bool changed = ( next != _reported );
+    _state = next;
+    _reported = next;
+    return changed;
+  } // update()
+
+  /// @brief Drains a queue of edges and re-evaluates the state.
+  /// @return true if the state changed.
+  template <size_t N>
+  bool update(EdgeQueue<N>& q, uint32_t now_ms)
+  {
+    PirEdge e;
+    while ( q.pop(e) )
+      edge(e);
+    return update(now_ms);
+  } // update()
+
+  Occupancy state() const { return _state; }
+  bool present() const { return _state == Occupancy::Present; }
+
+  /// @brief True while the PIR output is high.
+  bool motion() const { return _high; }
+
+  uint32_t last_motion_ms() const { return _last_motion_ms; }
+  uint32_t motion_events() const { return _motion_events; }
+
+private:
+  uint32_t  _present_hold_ms;
+  uint32_t  _away_ms;
+  bool      _high {false};
+  uint32_t  _last_motion_ms {0};
+  uint32_t  _motion_events {0};
+  Occupancy _state {Occupancy::Away};
+  Occupancy _reported {Occupancy::Away};
+}; // class OccupancyTracker
+
+} // namespace SSW
@@ -19,7 +19,24 @@ void update_outside_temp(const float temp, const float humid, const float baro);
 
 void update_fam_room_temp(const float temp);
 
-void update_temp_humid_display(float temp_fahren, float temp_set);
+/// @brief Shows or clears the stale indicator on the outside temperature.
+/// @param stale: true if the reading is out of date
+void set_outside_temp_stale(bool stale);
+
+/// @brief Shows or clears the stale indicator on the family room temperature.
+/// @param stale: true if the reading is out of date
+void set_fam_room_temp_stale(bool stale);
+
+void update_temp_humid_display(float temp_fahren, float humid);
+
+/// @brief Shows the values changed since the last call. Call once per
+/// frame, before lv_timer_handler(). The update functions above only
+/// record their values; nothing is invalidated until this runs, and then
+/// only the widgets whose displayed text or value actually changed.
+void commit_screen();
+
+/// @brief Widget changes handed to LVGL by commit_screen() since boot.
+uint32_t screen_widget_updates();
 
 class DisplayElemIfc
 {
@@ -39,10 +56,6 @@ public:
   ~SetTempDE() override {};
 
   virtual void update(float set_temp) override;
-
-private:
-  int _prev_tset {0};
-
 }; // class SetTempDE
 
 extern SetTempDE lr_set_temp_DE;
@@ -0,0 +1,194 @@
+/////////////////////////////////////////////////////////////////////
+/// Sensor freshness and adaptive polling
+///
+/// Each remote sensor value carries the time it was taken at the source
+/// and a sequence number that increments when a new reading arrives. A
+/// FreshSource decides when its sensor should be polled next:
+///
+/// - A reading that moved by at least change_threshold halves the poll
+///   period (down to min_period_ms); a steady reading stretches it by
+///   half (up to max_period_ms).
+/// - A source whose newest reading is older than stale_ms, or that has
+///   failed to respond, is marked stale and polled at min_period_ms until
+///   it recovers. Consecutive failures double the wait, up to
+///   max_period_ms, so a source that never answers is not hammered.
+///
+/// FreshnessIndex holds all of the sources and hands out the most
+/// overdue one, so at most one blocking server request is made per pass.
+///
+/// Times are milliseconds supplied by the caller, so the policy can be
+/// run against a simulated clock on the host.
+/////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace SSW
+{
+
+/// @brief A sensor reading with its provenance.
+struct SensorValue
+{
+  float    value {0.0f};     ///< The reading
+  uint32_t source_ms {0};    ///< When the reading was taken, local millis() time
+  uint32_t seq {0};          ///< Increments for every new reading; 0 means never read
+}; // struct SensorValue
+
+/// @class FreshSource
+/// @brief Freshness state and adaptive poll period for one sensor.
+class FreshSource
+{
+public:
+  /// @param name: Short name for diagnostics
+  /// @param min_period_ms: Fastest poll period
+  /// @param max_period_ms: Slowest poll period
+  /// @param stale_ms: Age at which a reading is considered stale
+  /// @param change_threshold: Change between readings that counts as 'fast-changing'
+  FreshSource(const char* name, uint32_t min_period_ms, uint32_t max_period_ms,
+    uint32_t stale_ms, float change_threshold) :
+    _name(name),
+    _min_period_ms(min_period_ms),
+    _max_period_ms(max_period_ms < min_period_ms ? min_period_ms : max_period_ms),
+    _stale_ms(stale_ms),
+    _change_threshold(change_threshold),
+    _period_ms(min_period_ms)
+  {}
+
+  const char* name() const { return _name; }
+  const SensorValue& value() const { return _value; }
+  uint32_t period() const { return _period_ms; }
+
+  /// @brief Makes the first poll due at 'now_ms'.
+  void begin(uint32_t now_ms)
+  {
+    _next_poll_ms = now_ms;
+  } // begin()
+
+  /// @brief True if the source is due for a poll.
+  bool due(uint32_t now_ms) const
+  {
+    return static_cast<int32_t>(now_ms - _next_poll_ms) >= 0;
+  } // due()
+
+  /// @brief How far past its poll time the source is. Negative if not due.
+  int32_t overdue(uint32_t now_ms) const { return static_cast<int32_t>(now_ms - _next_poll_ms); }
+
+  /// @brief Age of the newest reading.
+  uint32_t age(uint32_t now_ms) const { return now_ms - _value.source_ms; }
+
+  /// @brief True if there is no reading, the newest reading is older
+  /// than stale_ms, or the last poll failed.
+  bool stale(uint32_t now_ms) const
+  {
+    return _value.seq == 0 || _failures > 0 || age(now_ms) > _stale_ms;
+  } // stale()
+
+  /// @brief Records a successful poll.
+  /// @param value: The reading
+  /// @param source_ms: When the source took the reading, in local millis()
+  ///   time. Pass now_ms if the source does not say.
+  /// @param now_ms: The current time
+  void update(float value, uint32_t source_ms, uint32_t now_ms)
+  {
+    _failures = 0;
+    const bool first = ( _value.seq == 0 );
+    const bool is_new = first || static_cast<int32_t>(source_ms - _value.source_ms) > 0;
+
+    if ( is_new )
+    {
+      float delta = value - _value.value;
+      if ( delta < 0.0f )
+        delta = -delta;
+
+      if ( !first && delta >= _change_threshold )
+        _period_ms = _period_ms / 2 < _min_period_ms ? _min_period_ms : _period_ms / 2;
+      else if ( !first )
+        _period_ms = _period_ms + _period_ms / 2 > _max_period_ms ? _max_period_ms : _period_ms + _period_ms / 2;
+
+      _value.value = value;
+      _value.source_ms = source_ms;
+      _value.seq++;
+    }
+
+    // A reading that has not advanced is polled quickly while stale.
+    _schedule(now_ms);
+  } // update()
+
+  /// @brief Records a failed poll, and backs off: min_period_ms after
+  /// the first failure, doubling with each further one up to
+  /// max_period_ms.
+  void failed(uint32_t now_ms)
+  {
+    ++_failures;
+    uint32_t wait = _min_period_ms;
+    for ( uint32_t i = 1; i < _failures && wait < _max_period_ms; ++i )
+      wait *= 2;
+    _next_poll_ms = now_ms + ( wait > _max_period_ms ? _max_period_ms : wait );
+  } // failed()
+
+  uint32_t failures() const { return _failures; }
+
+private:
+  void _schedule(uint32_t now_ms)
+  {
+    _next_poll_ms = now_ms + ( stale(now_ms) ? _min_period_ms : _period_ms );
+  } // _schedule()
+
+  const char* _name;
+  uint32_t _min_period_ms;
+  uint32_t _max_period_ms;
+  uint32_t _stale_ms;
+  float    _change_threshold;
+  uint32_t _period_ms;          ///< Current adaptive period
+  uint32_t _next_poll_ms {0};   ///< When the next poll is due
+  uint32_t _failures {0};       ///< Consecutive failed polls
+  SensorValue _value;
+}; // class FreshSource
+
+/// @class FreshnessIndex
+/// @brief The set of polled sources.
+template <size_t N>
+class FreshnessIndex
+{
+public:
+  /// @brief Adds a source. Returns false if the index is full.
+  bool add(FreshSource& src)
+  {
+    if ( _count == N )
+      return false;
+    _sources[_count++] = &src;
+    return true;
+  } // add()
+
+  /// @brief The most overdue source, or nullptr if none is due.
+  FreshSource* next_due(uint32_t now_ms)
+  {
+    FreshSource* best = nullptr;
+    for ( size_t i = 0; i < _count; ++i )
+    {
+      if ( _sources[i]->due(now_ms) && (best == nullptr || _sources[i]->overdue(now_ms) > best->overdue(now_ms)) )
+        best = _sources[i];
+    }
+    return best;
+  } // next_due()
+
+  /// @brief Number of stale sources.
+  size_t stale_count(uint32_t now_ms) const
+  {
+    size_t n = 0;
+    for ( size_t i = 0; i < _count; ++i )
+      if ( _sources[i]->stale(now_ms) )
+        ++n;
+    return n;
+  } // stale_count()
+
+  size_t size() const { return _count; }
+  FreshSource& operator[](size_t i) { return *_sources[i]; }
+
+private:
+  FreshSource* _sources[N] {};
+  size_t _count {0};
+}; // class FreshnessIndex
+
+} // namespace SSW
@@ -75,6 +75,10 @@ public:
 
   float set_temp() const { return _set_temp; }
 
+  /// @brief Puts the encoder back to the set temp, dropping any turn
+  /// since the last update().
+  void discard_input();
+
 protected:
   float _set_temp; ///< The current set temp for the controller
   ESP32Encoder& _encoder; ///< The rotary encoder being used.
@@ -85,6 +89,7 @@ protected:
   SSW::Timer _position_changing_tmr { POSITION_CHANGING_MS }; ///< Timeout to accept encoder position as set position (rotation has stopped)
   SSW::Timer _temp_srvr_req_tmr; ///< The server request timer to update set_temp from the server.
   const char* _controller_name; ///< The controller name on the server.
+  float _logged_set_temp {0.0}; ///< The set temp last written to the data log
 
 private:
   /// @brief Returns the encoder counts associated with the input temperature
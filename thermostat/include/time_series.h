@@ -0,0 +1,423 @@
+/////////////////////////////////////////////////////////////////////
+/// Multi-resolution sensor history
+///
+/// A fixed-memory time-series store with three tiers: raw samples,
+/// 1-minute roll-ups and 1-hour roll-ups. Each tier is a ring buffer
+/// of compact fixed-point records. The minute and hour tiers are rolled
+/// up incrementally (min/max/mean/count) as samples arrive, so adding a
+/// sample is O(1) regardless of the buffer depths.
+///
+/// Values are stored as int16_t in caller-chosen units (e.g. tenths of
+/// a degree). Times are uint32_t seconds and are expected to be
+/// non-decreasing; an out-of-order sample is clamped to the last time.
+///
+/// This header has no Arduino dependencies so it can be compiled and
+/// exercised on the host.
+/////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+
+namespace SSW
+{
+
+/// @brief A roll-up record. Raw samples are reported through the same
+/// record type with min == max == mean and count == 1.
+struct TSRecord
+{
+  uint32_t t;     ///< Start of the bucket in seconds (sample time for raw)
+  int16_t  min;   ///< Minimum value in the bucket
+  int16_t  max;   ///< Maximum value in the bucket
+  int16_t  mean;  ///< Rounded mean of the bucket
+  uint16_t count; ///< Number of raw samples folded into the bucket
+}; // struct TSRecord
+
+/// @brief A single raw sample.
+struct TSSample
+{
+  uint32_t t; ///< Sample time in seconds
+  int16_t  v; ///< Sample value, fixed point
+}; // struct TSSample
+
+/// @brief The resolution tiers of a TimeSeries.
+enum class TSTier : uint8_t
+{
+  Raw = 0,
+  Minute = 1,
+  Hour = 2
+}; // enum class TSTier
+
+/// @class RingBuffer
+/// @brief Fixed capacity ring buffer. Pushing into a full buffer
+/// overwrites the oldest element. Element 0 is the oldest.
+template <typename T, size_t N>
+class RingBuffer
+{
+  static_assert(N > 0, "RingBuffer capacity must be non-zero");
+
+public:
+  void push(const T& item)
+  {
+    _items[_head] = item;
+    _head = (_head + 1 == N) ? 0 : _head + 1;
+    if ( _size < N )
+      ++_size;
+  } // push()
+
+  void clear() { _head = 0; _size = 0; }
+
+  size_t size() const { return _size; }
+  static constexpr size_t capacity() { return N; }
+  bool empty() const { return _size == 0; }
+
+  /// @brief Element i, counting from the oldest.
+  const T& operator[](size_t i) const
+  {
+    size_t idx = _head + N - _size + i;
+    return _items[idx >= N ? idx - N : idx];
+  } // operator[]
+
+  const T& newest() const { return (*this)[_size - 1]; }
+
+  /// @brief Index of the first element whose time is >= t. Requires
+  /// the elements to be ordered by their 't' member.
+  size_t lower_bound(uint32_t t) const
+  {
+    size_t lo = 0;
+    size_t hi = _size;
+    while ( lo < hi )
+    {
+      size_t mid = lo + (hi - lo) / 2;
+      if ( (*this)[mid].t < t )
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    return lo;
+  } // lower_bound()
+
+private:
+  T      _items[N];
+  size_t _head {0}; ///< Next slot to be written
+  size_t _size {0}; ///< Number of valid elements
+}; // class RingBuffer
+
+/// @class TSAccumulator
+/// @brief Running min/max/sum/count for the bucket currently being filled.
+class TSAccumulator
+{
+public:
+  void reset(uint32_t bucket_t)
+  {
+    _t = bucket_t;
+    _count = 0;
+    _sum = 0;
+  } // reset()
+
+  void add(int16_t v)
+  {
+    if ( _count == 0 )
+    {
+      _min = v;
+      _max = v;
+    }
+    else
+    {
+      if ( v < _min ) _min = v;
+      if ( v > _max ) _max = v;
+    }
+    // A full bucket keeps its min and max current, but its mean is that
+    // of the first UINT16_MAX samples: sum and count stop together.
+    if ( _count < UINT16_MAX )
+    {
+      _sum += v;
+      ++_count;
+    }
+  } // add()
+
+  bool empty() const { return _count == 0; }
+  uint32_t t() const { return _t; }
+
+  TSRecord record() const
+  {
+    TSRecord r;
+    r.t = _t;
+    r.min = _min;
+    r.max = _max;
+    r.count = _count;
+    // Round half away from zero
+    int32_t half = _count / 2;
+    r.mean = static_cast<int16_t>( (_sum >= 0 ? _sum + half : _sum - half) / static_cast<int32_t>(_count) );
+    return r;
+  } // record()
+
+private:
+  uint32_t _t {0};
+  int32_t  _sum {0};
+  int16_t  _min {0};
+  int16_t  _max {0};
+  uint16_t _count {0};
+}; // class TSAccumulator
+
+/// @class TimeSeries
+///
+/// @brief
+/// Three tier sensor history. RAW_N, MIN_N and HOUR_N are the depths
+/// of the raw, minute and hour ring buffers.
+///
+/// @param scale: Fixed-point scale. A float value v is stored as
+///   round(v * scale). Use 10 for tenths, 1 for raw ADC counts.
+template <size_t RAW_N, size_t MIN_N, size_t HOUR_N>
+class TimeSeries
+{
+public:
+  static constexpr uint32_t MINUTE_S = 60U;
+  static constexpr uint32_t HOUR_S = 3600U;
+
+  explicit TimeSeries(uint16_t scale = 1) : _scale(scale) {}
+
+  /// @brief Adds a sample. O(1).
+  /// @param t: Sample time in seconds
+  /// @param v: Sample value, fixed point
+  void add(uint32_t t, int16_t v)
+  {
+    if ( !_raw.empty() && t < _raw.newest().t )
+      t = _raw.newest().t;
+
+    _raw.push({t, v});
+    _roll(_min_acc, _min, t - t % MINUTE_S, v);
+    _roll(_hour_acc, _hour, t - t % HOUR_S, v);
+  } // add()
+
+  /// @brief Adds a floating point sample, converting to fixed point.
+  void add_float(uint32_t t, float v) { add(t, to_fixed(v)); }
+
+  int16_t to_fixed(float v) const
+  {
+    float f = v * _scale;
+    f += (f >= 0.0f) ? 0.5f : -0.5f;
+    if ( f > INT16_MAX ) return INT16_MAX;
+    if ( f < INT16_MIN ) return INT16_MIN;
+    return static_cast<int16_t>(f);
+  } // to_fixed()
+
+  float to_float(int16_t v) const { return static_cast<float>(v) / _scale; }
+
+  uint16_t scale() const { return _scale; }
+
+  /// @brief Returns false until the first sample has been added.
+  bool has_data() const { return !_raw.empty(); }
+
+  /// @brief The most recent raw sample. Only valid if has_data().
+  const TSSample& latest() const { return _raw.newest(); }
+
+  /// @brief Visits every record of the tier with from <= t < to, oldest
+  /// first. The bucket still being filled is reported last, so a roll-up
+  /// query always includes the most recent samples. Nothing is copied;
+  /// the visitor sees each record in turn.
+  /// @param fn: Callable taking (const TSRecord&). May return void, or
+  ///   bool where false stops the walk.
+  /// @return The number of records visited.
+  template <typename Visitor>
+  size_t query(TSTier tier, uint32_t from, uint32_t to, Visitor&& fn) const
+  {
+    switch ( tier )
+    {
+      case TSTier::Raw:
+        return _query_raw(from, to, fn);
+      case TSTier::Minute:
+        return _query_rollup(_min, _min_acc, from, to, fn);
+      case TSTier::Hour:
+      default:
+        return _query_rollup(_hour, _hour_acc, from, to, fn);
+    }
+  } // query()
+
+  /// @brief Time of the oldest record still held by the tier, or 0.
+  uint32_t oldest(TSTier tier) const
+  {
+    switch ( tier )
+    {
+      case TSTier::Raw:
+        return _raw.empty() ? 0 : _raw[0].t;
+      case TSTier::Minute:
+        return _min.empty() ? _min_acc.t() : _min[0].t;
+      case TSTier::Hour:
+      default:
+        return _hour.empty() ? _hour_acc.t() : _hour[0].t;
+    }
+  } // oldest()
+
+  /// @brief Number of completed records held by the tier.
+  size_t size(TSTier tier) const
+  {
+    switch ( tier )
+    {
+      case TSTier::Raw: return _raw.size();
+      case TSTier::Minute: return _min.size();
+      case TSTier::Hour:
+      default: return _hour.size();
+    }
+  } // size()
+
+  /// @brief Depth of the tier's ring buffer.
+  static constexpr size_t capacity(TSTier tier)
+  {
+    return tier == TSTier::Raw ? RAW_N : ( tier == TSTier::Minute ? MIN_N : HOUR_N );
+  } // capacity()
+
+  /// @brief Number of records query() would visit. O(log n).
+  size_t count(TSTier tier, uint32_t from, uint32_t to) const
+  {
+    if ( to <= from )
+      return 0;
+    switch ( tier )
+    {
+      case TSTier::Raw:
+        return _raw.lower_bound(to) - _raw.lower_bound(from);
+      case TSTier::Minute:
+        return _count_rollup(_min, _min_acc, from, to);
+      case TSTier::Hour:
+      default:
+        return _count_rollup(_hour, _hour_acc, from, to);
+    }
+  } // count()
+
+  /// @brief Picks the finest tier that still holds everything since
+  /// 'from' and has no more than max_records in [from, to). Falls back
+  /// to the hour tier.
+  TSTier select_tier(uint32_t from, uint32_t to, size_t max_records) const
+  {
+    for ( TSTier tier : { TSTier::Raw, TSTier::Minute } )
+    {
+      // A tier that has not wrapped yet holds every sample ever added.
+      const bool covers = size(tier) < capacity(tier) || oldest(tier) <= from;
+      if ( covers && count(tier, from, to) <= max_records )
+        return tier;
+    }
+    return TSTier::Hour;
+  } // select_tier()
+
+  void clear()
+  {
+    _raw.clear();
+    _min.clear();
+    _hour.clear();
+    _min_acc.reset(0);
+    _hour_acc.reset(0);
+  } // clear()
+
+private:
+  template <typename R>
+  static void _roll(TSAccumulator& acc, R& ring, uint32_t bucket_t, int16_t v)
+  {
+    if ( !acc.empty() && bucket_t != acc.t() )
+    {
+      ring.push(acc.record());
+      acc.reset(bucket_t);
+    }
+    else if ( acc.empty() )
+    {
+      acc.reset(bucket_t);
+    }
+    acc.add(v);
+  } // _roll()
+
+  // Visitors may return void or bool. These adapters normalise that.
+  template <typename Visitor>
+  static auto _visit(Visitor& fn, const TSRecord& r, int)
+    -> decltype(static_cast<bool>(fn(r)))
+  {
+    return static_cast<bool>(fn(r));
+  }
+  template <typename Visitor>
+  static bool _visit(Visitor& fn, const TSRecord& r, long)
+  {
+    fn(r);
+    return true;
+  }
+
+  template <typename Visitor>
+  size_t _query_raw(uint32_t from, uint32_t to, Visitor& fn) const
+  {
+    size_t n = 0;
+    for ( size_t i = _raw.lower_bound(from); i < _raw.size(); ++i )
+    {
+      const TSSample& s = _raw[i];
+      if ( s.t >= to )
+        break;
+      TSRecord r { s.t, s.v, s.v, s.v, 1U };
+      ++n;
+      if ( !_visit(fn, r, 0) )
+        break;
+    }
+    return n;
+  } // _query_raw()
+
+  template <typename R, typename Visitor>
+  static size_t _query_rollup(const R& ring, const TSAccumulator& acc,
+    uint32_t from, uint32_t to, Visitor& fn)
+  {
+    size_t n = 0;
+    for ( size_t i = ring.lower_bound(from); i < ring.size(); ++i )
+    {
+      if ( ring[i].t >= to )
+        return n;
+      ++n;
+      if ( !_visit(fn, ring[i], 0) )
+        return n;
+    }
+    if ( !acc.empty() && acc.t() >= from && acc.t() < to )
+    {
+      ++n;
+      _visit(fn, acc.record(), 0);
+    }
+    return n;
+  } // _query_rollup()
+
+  template <typename R>
+  static size_t _count_rollup(const R& ring, const TSAccumulator& acc, uint32_t from, uint32_t to)
+  {
+    size_t n = ring.lower_bound(to) - ring.lower_bound(from);
+    if ( !acc.empty() && acc.t() >= from && acc.t() < to )
+      ++n;
+    return n;
+  } // _count_rollup()
+
+  uint16_t _scale;                     ///< Fixed-point scale factor
+  RingBuffer<TSSample, RAW_N>  _raw;   ///< Raw samples
+  RingBuffer<TSRecord, MIN_N>  _min;   ///< Completed minute buckets
+  RingBuffer<TSRecord, HOUR_N> _hour;  ///< Completed hour buckets
+  TSAccumulator _min_acc;              ///< Minute bucket being filled
+  TSAccumulator _hour_acc;             ///< Hour bucket being filled
+}; // class TimeSeries
+
+/// Bytes reserved out of a budget for the TimeSeries bookkeeping members.
+static constexpr size_t TS_OVERHEAD = 128U;
+
+/// @brief Ring depth for a share of a budget, never less than one.
+constexpr size_t ts_depth(size_t bytes, size_t item_size)
+{
+  return bytes / item_size > 0 ? bytes / item_size : 1;
+} // ts_depth()
+
+/// @brief The part of a budget left for the rings.
+template <size_t BUDGET>
+struct TSBudget
+{
+  static_assert(BUDGET > TS_OVERHEAD, "TimeSeries budget must exceed TS_OVERHEAD");
+  static constexpr size_t rings = BUDGET - TS_OVERHEAD;
+}; // struct TSBudget
+
+/// @brief A TimeSeries sized to fit a RAM budget in bytes. After the
+/// bookkeeping overhead, a quarter of the budget goes to raw samples,
+/// half to minute and a quarter to hour records.
+template <size_t BUDGET>
+using BudgetedTimeSeries = TimeSeries<
+  ts_depth(TSBudget<BUDGET>::rings / 4, sizeof(TSSample)),
+  ts_depth(TSBudget<BUDGET>::rings / 2, sizeof(TSRecord)),
+  ts_depth(TSBudget<BUDGET>::rings / 4, sizeof(TSRecord))>;
+
+} // namespace SSW
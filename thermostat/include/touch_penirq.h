@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+
+#define LGFX_USE_V1
+#include <LovyanGFX.hpp>
+
+/// @class PenIrqTouch
+///
+/// @brief
+/// XPT2046 touch reads gated by its PENIRQ output, which the controller
+/// pulls low while the panel is pressed. While nothing touches the
+/// panel, read() only looks at the PENIRQ pin, so there is no traffic
+/// on the SPI bus the touch controller shares with the display. A
+/// falling-edge interrupt latches presses that begin and end between
+/// two reads, and lets loop() notice a touch while LVGL is not reading
+/// (pressed()).
+///
+/// While pressed, each read() takes SAMPLES readings through the
+/// device's getTouch() and reports the per-axis median. This removes
+/// the single-sample jumps resistive panels give at light pressure. The
+/// read counts as released if fewer than half the samples saw a touch.
+///
+/// With irq_pin < 0 every read() samples the bus, as polling did: one
+/// getTouch() while the panel is not pressed, SAMPLES once it is.
+///
+/// @param tft: The display the touch controller is configured on
+/// @param irq_pin: GPIO wired to PENIRQ, or -1
+class PenIrqTouch
+{
+public:
+  static constexpr unsigned SAMPLES = 5;
+
+  PenIrqTouch(lgfx::LGFX_Device& tft, int irq_pin) :
+    _tft(tft),
+    _irq_pin(irq_pin)
+  {}
+
+  /// @brief Configures the pin and attaches the interrupt.
+  void begin();
+
+  /// @brief True if PENIRQ is low or has fallen since the last read(),
+  /// without touching the bus. Always true with no PENIRQ pin.
+  bool pressed() const;
+
+  /// @brief Samples the panel if pressed().
+  /// @return true with the filtered point if the panel is pressed
+  bool read(uint16_t& x, uint16_t& y);
+
+  /// @brief Reads that sampled the bus / that did not, since boot.
+  uint32_t sampled_reads() const { return _sampled; }
+  uint32_t idle_reads() const { return _idle; }
+
+private:
+  static void _isr(void* arg);
+
+  lgfx::LGFX_Device& _tft;
+  int _irq_pin;
+  volatile bool _edge {false}; ///< PENIRQ fell since the last read()
+  uint32_t _sampled {0};
+  uint32_t _idle {0};
+}; // class PenIrqTouch
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <lvgl.h>
+
+// The fonts of the screen labels. With UI_SUBSET_FONTS these are the
+// reduced fonts from tools/fonts/fonts.json, which only hold the
+// characters the labels show; otherwise the stock Montserrat fonts.
+// Text outside fonts.json does not render with the reduced fonts, so
+// add any new characters there.
+#if UI_SUBSET_FONTS
+#define UI_FONT_18 ui_font_18
+#define UI_FONT_22 ui_font_22
+#define UI_FONT_42 ui_font_42
+#else
+#define UI_FONT_18 lv_font_montserrat_18
+#define UI_FONT_22 lv_font_montserrat_22
+#define UI_FONT_42 lv_font_montserrat_42
+#endif
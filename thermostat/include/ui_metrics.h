@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <lvgl.h>
+
+class Print;
+
+namespace SSW
+{
+
+/// @class Histogram
+///
+/// @brief
+/// Counts values into fixed buckets, Prometheus style: bucket i counts
+/// values <= bounds[i], and one more bucket takes everything larger.
+/// Keeps the count, sum and maximum as well. Never resets, so rates and
+/// recent distributions come from the difference between two reads.
+template <size_t N>
+class Histogram
+{
+public:
+  explicit Histogram(const uint32_t (&bounds)[N]) : _bounds(bounds) {}
+
+  void add(uint32_t v)
+  {
+    size_t i = 0;
+    while ( i < N && v > _bounds[i] )
+      ++i;
+    ++_counts[i];
+    ++_count;
+    _sum += v;
+    if ( v > _max )
+      _max = v;
+  } // add()
+
+  static constexpr size_t buckets() { return N; }
+  uint32_t bound(size_t i) const { return _bounds[i]; }
+  /// @brief Values <= bound(i); i == buckets() for all values.
+  uint32_t cumulative(size_t i) const
+  {
+    uint32_t n = 0;
+    for ( size_t b = 0; b <= i && b <= N; ++b )
+      n += _counts[b];
+    return n;
+  } // cumulative()
+  uint32_t count() const { return _count; }
+  uint64_t sum() const { return _sum; }
+  uint32_t max() const { return _max; }
+
+  /// @brief Upper bound of the bucket holding the p'th percentile, or
+  /// max() if that is the overflow bucket.
+  uint32_t percentile(unsigned p) const
+  {
+    if ( _count == 0 )
+      return 0;
+    const uint64_t rank = (static_cast<uint64_t>(_count) * p + 99U) / 100U;
+    uint32_t n = 0;
+    for ( size_t i = 0; i < N; ++i )
+    {
+      n += _counts[i];
+      if ( n >= rank )
+        return _bounds[i] < _max ? _bounds[i] : _max;
+    }
+    return _max;
+  } // percentile()
+
+private:
+  const uint32_t* _bounds;
+  uint32_t _counts[N + 1] {};
+  uint32_t _count {0};
+  uint64_t _sum {0};
+  uint32_t _max {0};
+}; // class Histogram
+
+/// @class UiMetrics
+///
+/// @brief
+/// Frame time and memory instrumentation for LVGL, without drawing
+/// anything. attach() hooks the display driver's render_start_cb and
+/// monitor_cb; the flush callback brackets its work with flush_begin()
+/// and flush_end(). Per refresh it records:
+///   frame_us   render_start_cb to monitor_cb
+///   flush_us   time spent inside the flush callback, i.e. waiting for
+///              the SPI bus; a DMA transfer running in the background
+///              is not counted
+///   render_us  frame_us - flush_us
+///   pixels     area redrawn
+/// sample() reads lv_mem_monitor() for the LV_MEM_SIZE pool into the
+/// mem_used and mem_frag histograms (percent).
+///
+/// The counters since boot are there for rate reports (main.cpp's
+/// DISP_STATS); print() writes the distributions and the memory pool to
+/// a serial port; metric_line() produces the Prometheus text format, one
+/// line at a time, for an HTTP handler.
+class UiMetrics
+{
+public:
+  static constexpr uint32_t US_BOUNDS[] = { 250, 500, 1000, 2000, 4000, 8000, 16000, 32000, 64000, 128000 };
+  static constexpr uint32_t PX_BOUNDS[] = { 500, 2000, 8000, 19200, 38400, 76800 };
+  static constexpr uint32_t PCT_BOUNDS[] = { 10, 20, 30, 40, 50, 60, 70, 80, 90, 100 };
+
+  /// @brief Hooks the display driver. Call before lv_disp_drv_register().
+  void attach(lv_disp_drv_t& drv);
+
+  void flush_begin(uint32_t now_us) { _flush_start = now_us; }
+  void flush_end(uint32_t now_us)
+  {
+    _flush_us += now_us - _flush_start;
+    ++_flushes;
+  } // flush_end()
+
+  /// @brief Samples the memory pool and records the widget update count
+  /// (see screen_widget_updates()). Call about once a second.
+  void sample(uint32_t widget_updates);
+
+  /// @name Counters since boot
+  /// @{
+  uint32_t frames() const { return _frames; }
+  uint64_t pixels() const { return _pixels; }
+  uint32_t flushes() const { return _flushes; }
+  uint64_t frame_us() const { return _frame_hist.sum(); }   ///< Rendering and flushing
+  uint64_t flush_wait_us() const { return _flush_hist.sum(); } ///< Waiting in the flush callback
+  uint32_t widget_updates() const { return _widget_updates; }
+  /// @}
+
+  /// @brief Writes a few lines of summary: percentiles since boot and
+  /// the memory pool.
+  void print(Print& out) const;
+
+  /// @brief Formats line 'index' of the Prometheus text exposition.
+  /// @return Characters written, 0 if the line does not fit, -1 past
+  /// the last line
+  int metric_line(size_t index, char* buf, size_t cap) const;
+
+private:
+  static void _render_start(lv_disp_drv_t* drv);
+  static void _monitor(lv_disp_drv_t* drv, uint32_t time_ms, uint32_t px);
+
+  uint32_t _frame_start {0};
+  uint32_t _flush_start {0};
+  uint32_t _flush_us {0};       ///< This frame
+  uint32_t _flushes {0};        ///< Since boot
+  uint32_t _frames {0};
+  uint64_t _pixels {0};
+  uint32_t _widget_updates {0};
+
+  Histogram<10> _frame_hist {US_BOUNDS};
+  Histogram<10> _render_hist {US_BOUNDS};
+  Histogram<10> _flush_hist {US_BOUNDS};
+  Histogram<6>  _pixel_hist {PX_BOUNDS};
+  Histogram<10> _mem_used_hist {PCT_BOUNDS};
+  Histogram<10> _mem_frag_hist {PCT_BOUNDS};
+  lv_mem_monitor_t _mem {};
+}; // class UiMetrics
+
+} // namespace SSW
@@ -0,0 +1,136 @@
+#include <Arduino.h>
+#include <driver/ledc.h>
+
+#include "backlight.h"
+
+// Duty for each perceptual level: CIE 1976 lightness L* = level / 2.55
+// converted to relative luminance, times 1023.
+static const uint16_t GAMMA_DUTY[256] PROGMEM =
+{
+     0,    0,    1,    1,    2,    2,    3,    3,    4,    4,    4,    5,    5,    6,    6,    7,
+     7,    8,    8,    8,    9,    9,   10,   10,   11,   11,   12,   12,   13,   13,   14,   15,
+    15,   16,   17,   17,   18,   19,   19,   20,   21,   22,   22,   23,   24,   25,   26,   27,
+    28,   29,   30,   31,   32,   33,   34,   35,   36,   37,   38,   39,   40,   42,   43,   44,
+    45,   47,   48,   50,   51,   52,   54,   55,   57,   58,   60,   61,   63,   65,   66,   68,
+    70,   71,   73,   75,   77,   79,   81,   83,   84,   86,   88,   90,   93,   95,   97,   99,
+   101,  103,  106,  108,  110,  113,  115,  118,  120,  123,  125,  128,  130,  133,  136,  138,
+   141,  144,  147,  149,  152,  155,  158,  161,  164,  167,  171,  174,  177,  180,  183,  187,
+   190,  194,  197,  200,  204,  208,  211,  215,  218,  222,  226,  230,  234,  237,  241,  245,
+   249,  254,  258,  262,  266,  270,  275,  279,  283,  288,  292,  297,  301,  306,  311,  315,
+   320,  325,  330,  335,  340,  345,  350,  355,  360,  365,  370,  376,  381,  386,  392,  397,
+   403,  408,  414,  420,  425,  431,  437,  443,  449,  455,  461,  467,  473,  480,  486,  492,
+   499,  505,  512,  518,  525,  532,  538,  545,  552,  559,  566,  573,  580,  587,  594,  601,
+   609,  616,  624,  631,  639,  646,  654,  662,  669,  677,  685,  693,  701,  709,  717,  726,
+   734,  742,  751,  759,  768,  776,  785,  794,  802,  811,  820,  829,  838,  847,  857,  866,
+   875,  885,  894,  903,  913,  923,  932,  942,  952,  962,  972,  982,  992, 1002, 1013, 1023,
+};
+static_assert(Backlight::DUTY_BITS == 10, "GAMMA_DUTY is for a 10-bit duty");
+
+// The ESP-IDF releases the fade a little after the requested time; a
+// duty write before then blocks until it does.
+static constexpr uint32_t FADE_MARGIN_MS = 10;
+
+// Arduino's ledcSetup() numbering: channels 0 - 7 are high speed and
+// 8 - 15 low speed, and each pair of channels shares a timer.
+static ledc_mode_t speed_mode(unsigned channel) { return static_cast<ledc_mode_t>(channel / 8U); }
+static ledc_channel_t ledc_channel(unsigned channel) { return static_cast<ledc_channel_t>(channel % 8U); }
+static ledc_timer_t ledc_timer(unsigned channel) { return static_cast<ledc_timer_t>((channel / 2U) % 4U); }
+
+uint16_t Backlight::duty(uint8_t level)
+{
+  return GAMMA_DUTY[level];
+} // duty()
+
+bool Backlight::begin(uint8_t level)
+{
+  ledc_timer_config_t timer = {};
+  timer.speed_mode = speed_mode(_channel);
+  timer.duty_resolution = static_cast<ledc_timer_bit_t>(DUTY_BITS);
+  timer.timer_num = ledc_timer(_channel);
+  timer.freq_hz = _freq_hz;
+  timer.clk_cfg = LEDC_AUTO_CLK;
+  if ( ledc_timer_config(&timer) != ESP_OK )
+  {
+    Serial.println("Backlight: ledc_timer_config failed");
+    return false;
+  }
+
+  ledc_channel_config_t chan = {};
+  chan.gpio_num = static_cast<int>(_pin);
+  chan.speed_mode = speed_mode(_channel);
+  chan.channel = ledc_channel(_channel);
+  chan.timer_sel = ledc_timer(_channel);
+  chan.duty = duty(level);
+  if ( ledc_channel_config(&chan) != ESP_OK )
+  {
+    Serial.println("Backlight: ledc_channel_config failed");
+    return false;
+  }
+
+  // Already installed is fine
+  const esp_err_t err = ledc_fade_func_install(0);
+  if ( err != ESP_OK && err != ESP_ERR_INVALID_STATE )
+  {
+    Serial.println("Backlight: ledc_fade_func_install failed");
+    return false;
+  }
+
+  _from = _to = _level = level;
+  _ok = true;
+  return true;
+} // begin()
+
+void Backlight::set_target(uint8_t level, uint32_t fade_ms, uint32_t now_ms)
+{
+  if ( level == _to )
+    return;
+  _from = _level;
+  _to = level;
+  _fade_ms = fade_ms;
+  // The fade is timed from when its first segment can start
+  _start_ms = _in_segment && static_cast<int32_t>(_seg_end_ms - now_ms) > 0 ? _seg_end_ms : now_ms;
+} // set_target()
+
+void Backlight::update(uint32_t now_ms)
+{
+  if ( !_ok )
+    return;
+  if ( _in_segment )
+  {
+    if ( static_cast<int32_t>(now_ms - _seg_end_ms) < 0 )
+      return;
+    _in_segment = false;
+  }
+  if ( _level == _to )
+    return;
+
+  const uint32_t elapsed = now_ms - _start_ms;
+  uint32_t seg_ms = 0;
+  uint8_t next = _to;
+  if ( elapsed < _fade_ms )
+  {
+    seg_ms = _fade_ms - elapsed < SEGMENT_MS ? _fade_ms - elapsed : SEGMENT_MS;
+    next = static_cast<uint8_t>(_from + (static_cast<int32_t>(_to) - _from) *
+      static_cast<int32_t>(elapsed + seg_ms) / static_cast<int32_t>(_fade_ms));
+  }
+  _write(next, seg_ms);
+  _level = next;
+  if ( seg_ms > 0 )
+  {
+    _seg_end_ms = now_ms + seg_ms + FADE_MARGIN_MS;
+    _in_segment = true;
+  }
+} // update()
+
+void Backlight::_write(uint8_t level, uint32_t fade_ms)
+{
+  const ledc_mode_t mode = speed_mode(_channel);
+  const ledc_channel_t chan = ledc_channel(_channel);
+  if ( fade_ms == 0 || duty(level) == duty(_level) )
+  {
+    ledc_set_duty(mode, chan, duty(level));
+    ledc_update_duty(mode, chan);
+  }
+  else
+    ledc_set_fade_time_and_start(mode, chan, duty(level), static_cast<int>(fade_ms), LEDC_FADE_NO_WAIT);
+} // _write()
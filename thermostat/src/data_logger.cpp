@@ -0,0 +1,391 @@
+#include "data_logger.h"
+
+#include <cstring>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace SSW
+{
+
+////////////////////////////////////////////////////////////////////////////////
+// BlockFile
+////////////////////////////////////////////////////////////////////////////////
+
+bool BlockFile::open(const char* path, bool create)
+{
+  close();
+  _fp = fopen(path, create ? "w+b" : "r+b");
+  return _fp != nullptr;
+} // open()
+
+void BlockFile::close()
+{
+  if ( _fp != nullptr )
+  {
+    fclose(_fp);
+    _fp = nullptr;
+  }
+} // close()
+
+uint32_t BlockFile::block_count()
+{
+  if ( _fp == nullptr || fseek(_fp, 0, SEEK_END) != 0 )
+    return 0;
+  long size = ftell(_fp);
+  return size < 0 ? 0 : static_cast<uint32_t>(size / LOG_BLOCK_SIZE);
+} // block_count()
+
+bool BlockFile::read_block(uint32_t pos, LogBlock& blk)
+{
+  if ( _fp == nullptr || fseek(_fp, static_cast<long>(pos) * LOG_BLOCK_SIZE, SEEK_SET) != 0 )
+    return false;
+  return fread(blk.bytes, LOG_BLOCK_SIZE, 1, _fp) == 1;
+} // read_block()
+
+bool BlockFile::write_block(uint32_t pos, const LogBlock& blk)
+{
+  if ( _fp == nullptr || fseek(_fp, static_cast<long>(pos) * LOG_BLOCK_SIZE, SEEK_SET) != 0 )
+    return false;
+  return fwrite(blk.bytes, LOG_BLOCK_SIZE, 1, _fp) == 1;
+} // write_block()
+
+bool BlockFile::sync()
+{
+  if ( _fp == nullptr || fflush(_fp) != 0 )
+    return false;
+  return fsync(fileno(_fp)) == 0;
+} // sync()
+
+bool BlockFile::truncate(uint32_t blocks)
+{
+  if ( _fp == nullptr || fflush(_fp) != 0 )
+    return false;
+  return ftruncate(fileno(_fp), static_cast<off_t>(blocks) * LOG_BLOCK_SIZE) == 0;
+} // truncate()
+
+////////////////////////////////////////////////////////////////////////////////
+// DataLogger
+////////////////////////////////////////////////////////////////////////////////
+
+static const char LOG_NAME_FMT[] = "%s/log%05u.bin";
+
+void DataLogger::file_path(uint32_t file_no, char* buf, size_t len) const
+{
+  snprintf(buf, len, LOG_NAME_FMT, _dir, static_cast<unsigned>(file_no));
+} // file_path()
+
+uint32_t DataLogger::_newest_file_no() const
+{
+  uint32_t newest = 0;
+  DIR* dir = opendir(_dir);
+  if ( dir == nullptr )
+    return 0;
+
+  struct dirent* ent;
+  while ( (ent = readdir(dir)) != nullptr )
+  {
+    unsigned n = 0;
+    char ext[4] = "";
+    if ( sscanf(ent->d_name, "log%5u.%3s", &n, ext) == 2 && strcmp(ext, "bin") == 0 && n > newest )
+      newest = n;
+  }
+  closedir(dir);
+  return newest;
+} // _newest_file_no()
+
+bool DataLogger::begin(uint32_t now)
+{
+  _fill = 0;
+  _pending = false;
+  _dropped = 0;
+
+  mkdir(_dir, 0755); // Fails harmlessly if it already exists.
+
+  uint32_t newest = _newest_file_no();
+  if ( newest == 0 )
+    return _open_new(1, now);
+  return _recover(newest, now);
+} // begin()
+
+void DataLogger::end(uint32_t now)
+{
+  if ( !ready() )
+    return;
+  // At most both staging blocks hold records.
+  for ( int i = 0; i < 2; ++i )
+  {
+    if ( !_pending && _fill > 0 )
+      _hand_over();
+    if ( !_pending )
+      break;
+    service(now);
+  }
+  _close_file();
+} // end()
+
+bool DataLogger::_open_new(uint32_t file_no, uint32_t now)
+{
+  char path[64];
+  file_path(file_no, path, sizeof(path));
+  if ( !_file.open(path, true) )
+    return false;
+
+  LogBlock blk;
+  memset(blk.bytes, 0, sizeof(blk.bytes));
+  blk.info.file_no = file_no;
+  blk.info.created_t = now;
+  blk.info.max_blocks = _max_blocks;
+  blk.info.group_blocks = LOG_GROUP_BLOCKS;
+  blk.info.record_size = sizeof(LogRecord);
+  log_seal_block(blk, 0, LogBlockType::FileHeader, 0);
+  if ( !_file.write_block(0, blk) || !_file.sync() )
+  {
+    _file.close();
+    return false;
+  }
+
+  _file_no = file_no;
+  _next_pos = 1;
+  _index_count = 0;
+  memset(&_summary, 0, sizeof(_summary));
+  return true;
+} // _open_new()
+
+bool DataLogger::_recover(uint32_t file_no, uint32_t now)
+{
+  char path[64];
+  file_path(file_no, path, sizeof(path));
+  if ( !_file.open(path, false) )
+    return _open_new(file_no + 1, now);
+
+  // Find the last block that was completely written. Only whole blocks
+  // are ever written in order, so at most the tail can be damaged.
+  LogBlock blk;
+  uint32_t pos = _file.block_count();
+  while ( pos > 0 && !(_file.read_block(pos - 1, blk) && log_block_valid(blk, pos - 1)) )
+    --pos;
+
+  if ( pos == 0 )
+    return _open_new(file_no, now); // Not even the header survived. Start the file over.
+
+  if ( blk.hdr.type == static_cast<uint8_t>(LogBlockType::Footer) )
+  {
+    // Closed cleanly; continue in a new file.
+    _file.close();
+    return _open_new(file_no + 1, now);
+  }
+
+  // Rebuild the footer totals from the index blocks, then the pending
+  // index entries from the data blocks after the last index block.
+  _file_no = file_no;
+  _next_pos = pos;
+  _index_count = 0;
+  memset(&_summary, 0, sizeof(_summary));
+
+  uint32_t group_start = 1;
+  for ( uint32_t ipos = LOG_GROUP_BLOCKS; ipos < pos; ipos += LOG_GROUP_BLOCKS )
+  {
+    if ( !_file.read_block(ipos, blk) || !log_block_valid(blk, ipos) )
+      break;
+    for ( uint16_t i = 0; i < blk.hdr.count; ++i )
+    {
+      const LogIndexEntry& e = blk.index[i];
+      if ( _summary.records == 0 )
+        _summary.first_t = e.first_t;
+      _summary.last_t = e.last_t;
+      _summary.records += e.count;
+      _summary.data_blocks++;
+    }
+    group_start = ipos + 1;
+  }
+
+  // If an index block could not be read, this walks the groups after it
+  // as well. Their data still counts towards the totals, but the pending
+  // entries restart at each index position so they only ever describe
+  // the current group.
+  for ( uint32_t dpos = group_start; dpos < pos; ++dpos )
+  {
+    if ( log_is_index_pos(dpos) )
+    {
+      _index_count = 0;
+      continue;
+    }
+    if ( !_file.read_block(dpos, blk) || !log_block_valid(blk, dpos) ||
+         blk.hdr.type != static_cast<uint8_t>(LogBlockType::Data) || blk.hdr.count == 0 ||
+         _index_count == LOG_INDEX_PER_BLOCK )
+      continue;
+    LogIndexEntry& e = _index[_index_count++];
+    e.block = dpos;
+    e.first_t = blk.records[0].t;
+    e.last_t = blk.records[blk.hdr.count - 1].t;
+    e.count = blk.hdr.count;
+    e.reserved = 0;
+    if ( _summary.records == 0 )
+      _summary.first_t = e.first_t;
+    _summary.last_t = e.last_t;
+    _summary.records += e.count;
+    _summary.data_blocks++;
+  }
+
+  // Discard the damaged tail, if the file system allows it. If not, the
+  // next writes overwrite it and readers stop at the first bad block.
+  _file.truncate(_next_pos);
+
+  // Power was lost between the last data block of a group and its index.
+  if ( log_is_index_pos(_next_pos) && !_write_index_block() )
+  {
+    _file.close();
+    return false;
+  }
+
+  return true;
+} // _recover()
+
+void DataLogger::_close_file()
+{
+  if ( !ready() )
+    return;
+
+  LogBlock blk;
+  memset(blk.bytes, 0, sizeof(blk.bytes));
+  blk.footer = _summary;
+  blk.footer.dropped = _dropped;
+  log_seal_block(blk, _next_pos, LogBlockType::Footer, 0);
+  if ( _file.write_block(_next_pos, blk) )
+    ++_next_pos;
+  _file.sync();
+  _file.close();
+} // _close_file()
+
+bool DataLogger::log(const LogRecord& rec)
+{
+  if ( !ready() )
+    return false;
+
+  if ( _fill == LOG_RECORDS_PER_BLOCK )
+  {
+    // The previous hand-over has not been written yet.
+    ++_dropped;
+    return false;
+  }
+
+  if ( _fill == 0 )
+    _active_since = rec.t;
+  _stage[_active].records[_fill++] = rec;
+
+  if ( _fill == LOG_RECORDS_PER_BLOCK && !_pending )
+    _hand_over();
+  return true;
+} // log()
+
+bool DataLogger::log_sample(uint32_t t, LogChannel ch, float value)
+{
+  float scaled = value * LOG_SAMPLE_SCALE;
+  LogRecord rec { t, static_cast<uint8_t>(LogRecordType::Sample), static_cast<uint8_t>(ch), 0,
+    static_cast<int32_t>(scaled >= 0.0f ? scaled + 0.5f : scaled - 0.5f), 0 };
+  return log(rec);
+} // log_sample()
+
+bool DataLogger::log_set_point(uint32_t t, float old_temp, float new_temp)
+{
+  LogRecord rec { t, static_cast<uint8_t>(LogRecordType::SetPoint), static_cast<uint8_t>(LogChannel::Temp), 0,
+    static_cast<int32_t>(old_temp * 10.0f + 0.5f), static_cast<int32_t>(new_temp * 10.0f + 0.5f) };
+  return log(rec);
+} // log_set_point()
+
+bool DataLogger::log_latency(uint32_t t, LogChannel ch, uint32_t latency_ms, bool ok)
+{
+  LogRecord rec { t, static_cast<uint8_t>(LogRecordType::NetLatency), static_cast<uint8_t>(ch), 0,
+    static_cast<int32_t>(latency_ms), ok ? 1 : 0 };
+  return log(rec);
+} // log_latency()
+
+void DataLogger::_hand_over()
+{
+  _pending_count = _fill;
+  _pending = true;
+  _active ^= 1U;
+  _fill = 0;
+} // _hand_over()
+
+void DataLogger::service(uint32_t now)
+{
+  if ( !ready() )
+    return;
+
+  // Push out a partially filled block once its oldest record is old enough.
+  if ( !_pending && _fill > 0 && now - _active_since >= _flush_period_s )
+    _hand_over();
+
+  if ( !_pending )
+    return;
+
+  LogBlock& blk = _stage[_active ^ 1U];
+  if ( !_write_data_block(blk, _pending_count, now) )
+    return; // Leave it pending and try again next time.
+  _pending = false;
+
+  // A full active block may have been waiting for the buffer to free up.
+  if ( _fill == LOG_RECORDS_PER_BLOCK )
+    _hand_over();
+} // service()
+
+bool DataLogger::_write_data_block(LogBlock& blk, uint16_t count, uint32_t now)
+{
+  // Keep room for this block, the index block and the footer.
+  if ( _next_pos + 3 > _max_blocks )
+  {
+    _close_file();
+    if ( !_open_new(_file_no + 1, now) )
+      return false;
+  }
+
+  // An earlier index block write failed. It must land before more data.
+  if ( log_is_index_pos(_next_pos) && !_write_index_block() )
+    return false;
+
+  // Clear unused record slots so stale data never reaches the card.
+  if ( count < LOG_RECORDS_PER_BLOCK )
+    memset(&blk.records[count], 0, (LOG_RECORDS_PER_BLOCK - count) * sizeof(LogRecord));
+  memset(blk.bytes + sizeof(LogBlockHeader) + LOG_RECORDS_PER_BLOCK * sizeof(LogRecord), 0,
+    LOG_PAYLOAD_SIZE - LOG_RECORDS_PER_BLOCK * sizeof(LogRecord));
+  log_seal_block(blk, _next_pos, LogBlockType::Data, count);
+  if ( !_file.write_block(_next_pos, blk) )
+    return false;
+
+  LogIndexEntry& e = _index[_index_count++];
+  e.block = _next_pos;
+  e.first_t = blk.records[0].t;
+  e.last_t = blk.records[count - 1].t;
+  e.count = count;
+  e.reserved = 0;
+
+  if ( _summary.records == 0 )
+    _summary.first_t = e.first_t;
+  _summary.last_t = e.last_t;
+  _summary.records += count;
+  _summary.data_blocks++;
+  ++_next_pos;
+
+  if ( log_is_index_pos(_next_pos) )
+    _write_index_block();
+
+  _file.sync();
+  return true;
+} // _write_data_block()
+
+bool DataLogger::_write_index_block()
+{
+  LogBlock blk;
+  memset(blk.bytes, 0, sizeof(blk.bytes));
+  memcpy(blk.index, _index, _index_count * sizeof(LogIndexEntry));
+  log_seal_block(blk, _next_pos, LogBlockType::Index, _index_count);
+  if ( !_file.write_block(_next_pos, blk) )
+    return false;
+  ++_next_pos;
+  _index_count = 0;
+  return true;
+} // _write_index_block()
+
+} // namespace SSW
@@ -5,6 +5,7 @@
 #include "timer.h"
 
 #include "http_request.h"
+#include "data_logger.h"
 
 // Allocate a temporary JsonDocument
 // Don't forget to change the capacity to match your requirements.
@@ -53,18 +54,26 @@ bool http_request(const IPAddress& ip_addr, unsigned port, const char* method,
     "%s %s HTTP/1.1\r\nHost: %s\r\nUser-Agent: SSW_IOT Device\r\nAccept: application/json\r\nContent-Type: application/json\r\nContent-Length: %d\r\n\r\n%s\r\n",
     method, url, ip_addr.toString(), strlen(body), body);
 
+  const SSW::LogChannel channel = ( ip_addr == CTRL.ctrl_server_ip ) ?
+    SSW::LogChannel::CtrlServer : SSW::LogChannel::OtherDevice;
+  const uint32_t start_ms = millis();
+
   WiFiClient client;
   Serial.printf("HTTP_Request: %s\n\n", HttpRequestBuf);
   if ( !client.connect( ip_addr, port) )
   {
     Serial.println("Connection failed.\n");
+    data_logger.log_latency(static_cast<uint32_t>(time(nullptr)), channel, millis() - start_ms, false);
     return false;
   }
 
   // If we have successfully connected, send our request:
   client.print(HttpRequestBuf);
 
-  return process_response(client, data);
+  bool rtn = process_response(client, data);
+  data_logger.log_latency(static_cast<uint32_t>(time(nullptr)), channel, millis() - start_ms, rtn);
+
+  return rtn;
 
 } // http_request()
 
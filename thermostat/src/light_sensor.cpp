@@ -0,0 +1,114 @@
+#include <Arduino.h>
+#include <driver/adc.h>
+
+#include "light_sensor.h"
+
+// Bytes moved from the DMA ring to the task per read. Each conversion
+// result is two bytes, so at 20 kHz the task wakes about 20 times a
+// second. 20 kHz is the lowest rate the ESP32 digital controller runs
+// at; the chunk size is what keeps the wake-ups down.
+static constexpr uint32_t READ_CHUNK_BYTES = 2048;
+// Size of the driver's DMA ring: two chunks, about 100 ms of samples. If
+// the task is starved longer than that, samples are lost but the filter
+// simply averages what it gets.
+static constexpr uint32_t DMA_RING_BYTES = 2 * READ_CHUNK_BYTES;
+// Too big for the task's stack. There is only one light sensor.
+static uint8_t read_buf[READ_CHUNK_BYTES];
+static uint16_t samples[READ_CHUNK_BYTES / SOC_ADC_DIGI_RESULT_BYTES];
+
+bool LightSensor::begin()
+{
+  if ( _running )
+    return true;
+
+  adc_digi_init_config_t init_cfg = {};
+  init_cfg.max_store_buf_size = DMA_RING_BYTES;
+  init_cfg.conv_num_each_intr = READ_CHUNK_BYTES;
+  init_cfg.adc1_chan_mask = BIT(_channel);
+  init_cfg.adc2_chan_mask = 0;
+  if ( adc_digi_initialize(&init_cfg) != ESP_OK )
+  {
+    Serial.println("LightSensor: adc_digi_initialize failed");
+    return false;
+  }
+
+  static adc_digi_pattern_config_t pattern = {};
+  pattern.atten = ADC_ATTEN_DB_11;
+  pattern.channel = _channel;
+  pattern.unit = 0; // ADC1
+  pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+  adc_digi_configuration_t dig_cfg = {};
+  dig_cfg.conv_limit_en = 1; // Required on the ESP32
+  dig_cfg.conv_limit_num = 250;
+  dig_cfg.pattern_num = 1;
+  dig_cfg.adc_pattern = &pattern;
+  dig_cfg.sample_freq_hz = SAMPLE_RATE_HZ;
+  dig_cfg.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  dig_cfg.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+  if ( adc_digi_controller_configure(&dig_cfg) != ESP_OK )
+  {
+    Serial.println("LightSensor: adc_digi_controller_configure failed");
+    adc_digi_deinitialize();
+    return false;
+  }
+
+  _filter.reset();
+  _running = true;
+  adc_digi_start();
+
+  // Core 0, just above idle. The task sleeps in adc_digi_read_bytes()
+  // until the DMA has a chunk ready.
+  TaskHandle_t handle = nullptr;
+  xTaskCreatePinnedToCore(_task_entry, "light", 2048, this, 1, &handle, 0);
+  _task = handle;
+  return _task != nullptr;
+} // begin()
+
+void LightSensor::end()
+{
+  if ( !_running )
+    return;
+  _running = false;
+  // The task notices _running on its next chunk and deletes itself.
+  while ( _task != nullptr )
+    delay(1);
+  adc_digi_stop();
+  adc_digi_deinitialize();
+} // end()
+
+void LightSensor::_task_entry(void* arg)
+{
+  static_cast<LightSensor*>(arg)->_run();
+} // _task_entry()
+
+void LightSensor::_run()
+{
+  uint32_t last_publish = millis();
+
+  while ( _running )
+  {
+    uint32_t len = 0;
+    if ( adc_digi_read_bytes(read_buf, sizeof(read_buf), &len, 200) == ESP_OK )
+    {
+      size_t n = 0;
+      for ( uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= len; i += SOC_ADC_DIGI_RESULT_BYTES )
+      {
+        const adc_digi_output_data_t* p = reinterpret_cast<const adc_digi_output_data_t*>(&read_buf[i]);
+        if ( p->type1.channel == _channel )
+          samples[n++] = p->type1.data;
+      }
+      _filter.push(samples, n);
+    }
+
+    if ( millis() - last_publish >= _publish_period_ms && _filter.count() > 0 )
+    {
+      _level_q = _filter.take();
+      _seq = _seq + 1;
+      last_publish = millis();
+    }
+  }
+
+  _task = nullptr;
+  vTaskDelete(nullptr);
+} // _run()
@@ -1,9 +1,7 @@
 // @todo Fix bug that allows a failed server call to set the temperature to 50.
 // @todo Screen calibration and lamp button
 // @todo Continue refactoring
-// @todo Use motion detection to trigger display update?
 // @todo Away/Home
-// @todo display stale sensor indicator (dead battery)
 // @todo Lamp control by Away/Home
 // @todo UDP logging
 // @todo Config file?
@@ -11,6 +9,8 @@
 // @todo Have got to clamp set_temp on server!
 #include <Arduino.h>
 #include <esp_sntp.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
 
 #include <WiFi.h>
 #include <ArduinoJson.h>
@@ -50,10 +50,12 @@ static const unsigned ENC1_Q2 = 25;
 #include "lvgl_tc/esp_nvs_tc.h"
 #endif
 #include "screen1.h"
+#include "ui_metrics.h"
 #include <SD.h>
 #include <FS.h>
 
 #include "temp_controller.h"
+#include "data_logger.h"
 
 ////////////////////////////////////////
 // Note that pinout and other parameters are defined in library
@@ -73,16 +75,44 @@ static const int SCREEN_HEIGHT = TFT_WIDTH;
 #endif
 
 
-static const unsigned TFT_BACKLIGHT = 5U;
 static const unsigned SD_CS = 13U;
 static uint16_t TOUCH_CAL_DATA[8] = { 63, 164, 9667, 54100, 56300, 11700, 200, 450 };// { 416, 350, 3900, 3888, 0 };
 
 // LVGL Stuff
+// Two draw buffers: LVGL renders the next stripe into one while the
+// other goes out over SPI by DMA. Taller stripes mean fewer flushes per
+// frame for 2 * SCREEN_WIDTH * 2 bytes of RAM per line.
+#ifndef DISP_BUF_LINES
+#define DISP_BUF_LINES 20
+#endif
+// DISP_FLUSH_DMA=0 pushes each stripe synchronously instead, as before
+// the DMA flush, so the two can be compared on the same build.
+#ifndef DISP_FLUSH_DMA
+#define DISP_FLUSH_DMA 1
+#endif
+// Print display refresh statistics, per minute, and the UI metrics
+// distributions every DISP_STATS_MS. The metrics are always served at
+// /metrics.
+#ifndef DISP_STATS
+#define DISP_STATS 0
+#endif
+static const uint32_t DISP_STATS_MS = 60000;
+static_assert(LV_COLOR_16_SWAP, "The DMA flush sends lv_color_t as is: set LV_COLOR_16_SWAP in lv_conf.h");
 static lv_disp_draw_buf_t draw_buf;
-static lv_color_t buf[ SCREEN_WIDTH * 10 ];
+static lv_color_t buf_1[ SCREEN_WIDTH * DISP_BUF_LINES ];
+static lv_color_t buf_2[ SCREEN_WIDTH * DISP_BUF_LINES ];
+static SSW::UiMetrics ui_metrics; ///< Frame times, redraws and LVGL memory
+
 void my_disp_flush( lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color_p );
+#if DISP_STATS
+static void print_disp_stats(uint32_t now);
+#endif
 void my_touchpad_read( lv_indev_drv_t * indev_driver, lv_indev_data_t * data );
 
+// Touch reads use the shared SPI bus only while PENIRQ says the panel is pressed
+#include "touch_penirq.h"
+static PenIrqTouch touch(tft, TOUCH_IRQ_PIN);
+
 
 ////////////////////////////////////////
 // Setup Encoder and Button Handler
@@ -127,7 +157,62 @@ TempController lr_temp_controller(LR_TEMP_CTRLR_UPDATE_MS, LR_TEMP_CTRLR_SRVR_UP
 
 /////////////////////////////////////////////
 // PIR Sensor
+#include "occupancy.h"
+
 static const unsigned PIR_PIN = 32;
+static const uint32_t PRESENT_HOLD_MS = 10000; ///< Room stays 'present' this long after the PIR drops
+static const uint32_t AWAY_MS = 15 * 60000;    ///< No motion for this long means the room is empty
+// Light sleep while the room is empty. The PIR wakes the CPU immediately.
+// Off by default: the Wi-Fi station is not kept associated in manual light sleep.
+#define PIR_LIGHT_SLEEP 0
+static const uint32_t AWAY_SLEEP_MS = 1000;    ///< Light sleep period while away
+
+static SSW::EdgeQueue<16> pir_edges;
+SSW::OccupancyTracker occupancy(PRESENT_HOLD_MS, AWAY_MS);
+
+void IRAM_ATTR pirISR()
+{
+  pir_edges.push(millis(), digitalRead(PIR_PIN) == HIGH);
+} // pirISR()
+
+void setup_pir()
+{
+  pinMode(PIR_PIN, INPUT);
+  occupancy.begin(digitalRead(PIR_PIN) == HIGH, millis());
+  attachInterrupt(PIR_PIN, pirISR, CHANGE);
+#if PIR_LIGHT_SLEEP
+  esp_sleep_enable_gpio_wakeup(); // The pin is armed in idle_wait()
+#endif
+} // setup_pir()
+
+/// @brief Waits out the rest of the loop period. When the room is empty
+/// and PIR_LIGHT_SLEEP is enabled, light sleeps until the PIR fires or
+/// AWAY_SLEEP_MS passes.
+static void idle_wait(uint32_t ms)
+{
+#if PIR_LIGHT_SLEEP
+  if ( occupancy.state() == SSW::Occupancy::Away && !occupancy.motion() )
+  {
+    // The GPIO wake-up replaces pirISR()'s edge interrupt with a
+    // high-level one, which would fire continuously while the PIR output
+    // is high. Arm it only for the sleep, with the CPU interrupt masked
+    // (the wake-up does not need it), then put the edges back.
+    const gpio_num_t pin = static_cast<gpio_num_t>(PIR_PIN);
+    gpio_intr_disable(pin);
+    gpio_wakeup_enable(pin, GPIO_INTR_HIGH_LEVEL);
+    esp_sleep_enable_timer_wakeup(static_cast<uint64_t>(AWAY_SLEEP_MS) * 1000U);
+    esp_light_sleep_start();
+    gpio_wakeup_disable(pin);
+    gpio_set_intr_type(pin, GPIO_INTR_ANYEDGE);
+    gpio_intr_enable(pin);
+    // Woken by the PIR: the rising edge went to the wake-up, not pirISR()
+    if ( digitalRead(PIR_PIN) == HIGH )
+      pir_edges.push(millis(), true);
+    return;
+  }
+#endif
+  delay(ms);
+} // idle_wait()
 
 
 /////////////////////////////////////////////
@@ -148,9 +233,130 @@ static const unsigned DHTPIN = 33;
 
 DHT dht(DHTPIN, DHTTYPE);
 
+// Smoothing between the DHT22 and the display/history. Readings are
+// filtered in hundredths (SSW::LOG_SAMPLE_SCALE) of a degree F / percent.
+// The DHT22 is good to about +/-0.2 F, so the temperature uses a Kalman
+// filter with that as its measurement noise; humidity is noisier and
+// less important, so a plain EMA is enough.
+#include "filter.h"
+
+using TempFilter = SSW::Filter<SSW::FilterKind::Kalman>;
+using HumidFilter = SSW::Filter<SSW::FilterKind::EMA>;
+static const TempFilter::Config TEMP_FILTER_CFG {
+  SSW::q16(9.0),   // q: ~0.03 F of real drift per 15 s sample
+  SSW::q16(324.0), // r: ~0.18 F measurement noise
+  SSW::q16(324.0)  // p0
+};
+static const HumidFilter::Config HUMID_FILTER_CFG { SSW::q16(0.25) };
+TempFilter temp_filter(TEMP_FILTER_CFG);
+HumidFilter humid_filter(HUMID_FILTER_CFG);
+
 /////////////////////////////////////////////////
 // Light sensor pin
 static const unsigned LIGHT_PIN = 36; // ADC1_0
+#include "light_sensor.h"
+
+static const unsigned LIGHT_ADC_CHANNEL = 0; ///< ADC1 channel of LIGHT_PIN
+static const unsigned LIGHT_PUBLISH_MS = 500; ///< Time between filtered light levels
+LightSensor light_sensor(LIGHT_ADC_CHANNEL, LIGHT_PUBLISH_MS);
+
+/////////////////////////////////////////////
+// Backlight
+#include "backlight.h"
+
+static const uint8_t  BACKLIGHT_DIM_LEVEL = 72;    ///< Perceptual level while nobody is present
+static const uint32_t BACKLIGHT_WAKE_MS = 300;     ///< Fade up when someone arrives
+static const uint32_t BACKLIGHT_DIM_MS = 3000;     ///< Fade down when they leave
+static const uint32_t BACKLIGHT_AMBIENT_MS = 2000; ///< Fade following the room light
+// Brighter room, brighter screen: light sensor counts to perceptual level
+static const SSW::AmbientPoint BACKLIGHT_CURVE[] = {
+  {  100, 110 },
+  {  800, 170 },
+  { 2500, 235 },
+  { 3500, 255 },
+};
+static const uint32_t BACKLIGHT_OFF_MS = 1000;     ///< Fade out before the panel sleeps
+Backlight backlight(TFT_BL_PIN, TFT_BL_PWM_CHANNEL, TFT_BL_PWM_HZ);
+SSW::AmbientCurve ambient_backlight(BACKLIGHT_CURVE);
+
+/////////////////////////////////////////////
+// Display power
+#include "display_power.h"
+
+static const uint32_t DISPLAY_DIM_MS = 20000;         ///< Dim this long after the last presence or input
+static const uint32_t DISPLAY_SUSPEND_MS = 5 * 60000; ///< Sleep the panel this long after
+static const uint32_t SUSPENDED_TOUCH_POLL_MS = 250;  ///< Touch check while suspended, without PENIRQ
+static const uint32_t ENCODER_WAKE_MS = 500;          ///< Knob still this long ends a wake-up turn
+SSW::DisplayPower display_power(DISPLAY_DIM_MS, DISPLAY_SUSPEND_MS);
+static bool display_asleep = false; ///< Panel asleep and LVGL not running
+
+/// @brief Backlight level for the display state and room light.
+static uint8_t backlight_level()
+{
+  switch ( display_power.state() )
+  {
+    case SSW::DisplayState::Active: return ambient_backlight.level();
+    case SSW::DisplayState::Dim: return BACKLIGHT_DIM_LEVEL;
+    case SSW::DisplayState::Suspended:
+    default: return 0;
+  }
+} // backlight_level()
+
+/// @brief Puts the panel to sleep and stops running LVGL, so nothing is
+/// rendered, flushed or read from the touch controller. Call with the
+/// backlight off and outside lv_timer_handler(); the last flush of a
+/// refresh has already released the bus.
+static void suspend_display()
+{
+  tft.sleep();
+  display_asleep = true;
+} // suspend_display()
+
+/// @brief Wakes the panel and redraws the whole screen once with the
+/// current values, before the backlight comes up.
+static void resume_display()
+{
+  tft.wakeup();
+  display_asleep = false;
+
+  // A touch that woke the display must not also press a button
+  for ( lv_indev_t* indev = lv_indev_get_next(nullptr); indev != nullptr; indev = lv_indev_get_next(indev) )
+    lv_indev_wait_release(indev);
+
+  commit_screen();
+  lv_obj_invalidate(lv_scr_act());
+  lv_refr_now(nullptr);
+} // resume_display()
+
+/////////////////////////////////////////////////
+// Sensor history
+#include "time_series.h"
+
+static constexpr size_t SENSOR_HISTORY_BYTES = 8192U; ///< RAM budget for each sensor's history
+SSW::BudgetedTimeSeries<SENSOR_HISTORY_BYTES> temp_history(10);  ///< Living room temperature, tenths of a degree F
+SSW::BudgetedTimeSeries<SENSOR_HISTORY_BYTES> humid_history(10); ///< Living room humidity, tenths of a percent
+SSW::BudgetedTimeSeries<SENSOR_HISTORY_BYTES> light_history(1);  ///< Light level, ADC counts
+static_assert(sizeof(temp_history) <= SENSOR_HISTORY_BYTES, "Sensor history exceeds its RAM budget");
+
+/// @brief Timestamp used for history samples. Seconds since boot until
+/// SNTP has synchronized, seconds since the epoch thereafter.
+static uint32_t history_time()
+{
+  return static_cast<uint32_t>(time(nullptr));
+} // history_time()
+
+/// @brief True once SNTP has set the clock, i.e. history_time() is in
+/// seconds since the epoch. Earlier times are seconds since boot.
+static bool clock_synced()
+{
+  static constexpr time_t SYNCED_AFTER = 1600000000; // September 2020
+  return time(nullptr) > SYNCED_AFTER;
+} // clock_synced()
+
+/////////////////////////////////////////////////
+// SD card data logger
+SSW::DataLogger data_logger("/sd/log"); ///< SD.begin() mounts the card at /sd
+static bool log_waiting = false; ///< The card is mounted; data_logger starts once clock_synced()
 
 static uint8_t cardType = CARD_NONE;
 static uint64_t cardSize = 0;
@@ -186,6 +392,292 @@ static String card_type(uint8_t cardType)
 // const char* WPA_PASSWD =  "yourNetworkPass";
 #include "credentials.h"
 #include "http_request.h"
+/////////////////////////////////////////////
+// Remote sensors, polled through the control server
+#include "sensor_freshness.h"
+
+static const uint32_t REMOTE_MIN_POLL_MS = 15000;     ///< Poll period for stale or fast-changing sensors
+static const uint32_t REMOTE_MAX_POLL_MS = 5 * 60000; ///< Poll period for steady sensors
+static const uint32_t REMOTE_STALE_MS = 30 * 60000;   ///< A reading older than this is stale
+static const float    REMOTE_CHANGE_DEG = 0.5;        ///< Change between polls that counts as fast-changing
+
+SSW::FreshSource outside_temp_src("outside", REMOTE_MIN_POLL_MS, REMOTE_MAX_POLL_MS, REMOTE_STALE_MS, REMOTE_CHANGE_DEG);
+SSW::FreshSource fam_room_temp_src("fam_room", REMOTE_MIN_POLL_MS, REMOTE_MAX_POLL_MS, REMOTE_STALE_MS, REMOTE_CHANGE_DEG);
+static SSW::FreshnessIndex<2> remote_sensors;
+
+/// @brief When a subdevice state was reported, in local millis() time.
+/// Uses the state's "timestamp" (seconds since the epoch) if the server
+/// supplies one and SNTP has synchronized; otherwise the time of receipt.
+static uint32_t source_time_ms(JsonVariantConst state, uint32_t now_ms)
+{
+  uint32_t ts = state["timestamp"] | 0U;
+  uint32_t epoch_now = static_cast<uint32_t>(time(nullptr));
+  if ( ts == 0 || sntp_get_sync_status() != SNTP_SYNC_STATUS_COMPLETED || ts > epoch_now )
+    return now_ms;
+  return now_ms - (epoch_now - ts) * 1000U;
+} // source_time_ms()
+
+static void poll_outside_temp(uint32_t now_ms)
+{
+  String json;
+  if ( http_get_from_server("/device?dev_id=ESP_F803", "", json) )
+  {
+//      Serial.println("\n\nOutside temp sensor: " + json);
+
+    DeserializationError error = deserializeJson(json_doc, json);
+    if ( error )
+    {
+      Serial.printf("JSON Decoding Error: %s\n", error.c_str());
+      outside_temp_src.failed(now_ms);
+    }
+    else
+    {
+      JsonVariantConst state = json_doc["subdevs"]["bme280"]["state"];
+      float outside_temp = state["temp"];
+      float humid = state["humid"];
+      float baro = state["baro"];
+//          Serial.printf("Outside temp: %3.1f humid: %2.1f, baro: %2.1f\n", outside_temp, humid, baro);
+      const uint32_t seq = outside_temp_src.value().seq;
+      outside_temp_src.update(outside_temp, source_time_ms(state, now_ms), now_ms);
+      if ( outside_temp_src.value().seq != seq )
+      {
+        update_outside_temp(outside_temp, humid, baro);
+        data_logger.log_sample(history_time(), SSW::LogChannel::OutsideTemp, outside_temp);
+      }
+    }
+  }
+  else
+  {
+    Serial.println("Get outside temperature failed.");
+    outside_temp_src.failed(now_ms);
+  }
+} // poll_outside_temp()
+
+static void poll_fam_room_temp(uint32_t now_ms)
+{
+  String json;
+  if ( http_get_from_server("/device?dev_id=ESP_F444", "", json) )
+  {
+//      Serial.println("\n\nFamily room temp sensor: " + json);
+
+    DeserializationError error = deserializeJson(json_doc, json);
+    if ( error )
+    {
+      Serial.printf("JSON Decoding Error: %s\n", error.c_str());
+      fam_room_temp_src.failed(now_ms);
+    }
+    else
+    {
+      JsonVariantConst state = json_doc["subdevs"]["ds18b20"]["state"];
+      float family_room_temp = state["temp"];
+//          Serial.printf("Family room temp: %3.1f\n", family_room_temp);
+      const uint32_t seq = fam_room_temp_src.value().seq;
+      fam_room_temp_src.update(family_room_temp, source_time_ms(state, now_ms), now_ms);
+      if ( fam_room_temp_src.value().seq != seq )
+      {
+        update_fam_room_temp(family_room_temp);
+        data_logger.log_sample(history_time(), SSW::LogChannel::FamRoomTemp, family_room_temp);
+      }
+    }
+  }
+  else
+  {
+    Serial.println("Get family room temperature failed.");
+    fam_room_temp_src.failed(now_ms);
+  }
+} // poll_fam_room_temp()
+
+/////////////////////////////////////////////
+// State server
+//
+// Serves this thermostat's own readings at /api/state (JSON) and
+// /api/state.bin, the sensor history at /api/history and the UI metrics
+// at /metrics, with the same non-blocking server core as the sensor
+// server. loop() publishes a snapshot once a second and polls the
+// server; a request never touches a sensor or waits on a socket.
+#include "http_server.h"
+#include "http_backend_posix.h"
+#include "snapshot_buffer.h"
+#include "history_stream.h"
+
+static const uint16_t STATE_SERVER_PORT = 80;
+static const uint32_t STATE_SNAPSHOT_MS = 1000; ///< Time between snapshots
+static constexpr uint8_t STATE_FORMAT = 1;
+static constexpr int16_t NO_READING = INT16_MIN;
+
+/// @brief The /api/state.bin format: little-endian, no padding.
+/// Temperatures are hundredths of a degree F, NO_READING if unknown.
+struct StateSnapshot
+{
+  uint8_t  format;        ///< STATE_FORMAT
+  uint8_t  occupancy;     ///< SSW::Occupancy
+  uint8_t  stale;         ///< Bit 0: outside, bit 1: family room
+  uint8_t  reserved;
+  int16_t  temp;
+  uint16_t humidity;      ///< Hundredths of a percent
+  int16_t  set_temp;
+  int16_t  outside_temp;
+  int16_t  fam_room_temp;
+  uint16_t light;         ///< Filtered ADC counts
+}; // StateSnapshot
+static_assert(sizeof(StateSnapshot) == 16, "StateSnapshot must not contain padding");
+static SSW::SnapshotBuffer<StateSnapshot> state_snapshot;
+
+static SSW::PosixBackend state_backend;
+static SSW::HttpServer<SSW::PosixBackend, 3, 512, 512, 4> state_server(state_backend);
+
+static const char STATE_JSON[] PROGMEM = R"EOF({"temp":{{temp}},"humidity":{{humidity}},"set_temp":{{set_temp}},"outside_temp":{{outside_temp}},"outside_stale":{{outside_stale}},"fam_room_temp":{{fam_room_temp}},"fam_room_stale":{{fam_room_stale}},"light":{{light}},"occupancy":"{{occupancy}}"}
+)EOF";
+
+static int16_t to_hundredths(float v)
+{
+  return isnan(v) ? NO_READING : static_cast<int16_t>(lroundf(v * 100.0f));
+} // to_hundredths()
+
+/// @brief Fills in the STATE_JSON placeholders from the current snapshot.
+static void resolve_state(const char* name, size_t len, SSW::TemplateWriter& out)
+{
+  using SSW::name_is;
+  const StateSnapshot& snap = state_snapshot.current();
+  auto temp = [&out](int16_t v)
+  {
+    if ( v == NO_READING )
+      out.print("null");
+    else
+      out.print(v / 100.0f, 2);
+  };
+  if ( name_is(name, len, "temp") )
+    temp(snap.temp);
+  else if ( name_is(name, len, "humidity") )
+    out.print(snap.humidity / 100.0f, 2);
+  else if ( name_is(name, len, "set_temp") )
+    temp(snap.set_temp);
+  else if ( name_is(name, len, "outside_temp") )
+    temp(snap.outside_temp);
+  else if ( name_is(name, len, "outside_stale") )
+    out.print(( snap.stale & 0x01U ) ? "true" : "false");
+  else if ( name_is(name, len, "fam_room_temp") )
+    temp(snap.fam_room_temp);
+  else if ( name_is(name, len, "fam_room_stale") )
+    out.print(( snap.stale & 0x02U ) ? "true" : "false");
+  else if ( name_is(name, len, "light") )
+    out.print(static_cast<int32_t>(snap.light));
+  else if ( name_is(name, len, "occupancy") )
+    out.print(SSW::occupancy_name(static_cast<SSW::Occupancy>(snap.occupancy)));
+} // resolve_state()
+
+/// @brief Adds the snapshot's ETag; responds 304 if the client has it.
+static bool state_not_modified(const SSW::HttpRequest& req, SSW::HttpResponse& res)
+{
+  char etag[12];
+  state_snapshot.format_etag(etag, sizeof(etag));
+  res.header("ETag", etag);
+  res.header("Cache-Control", "no-cache");
+  if ( !state_snapshot.matches(req.if_none_match) )
+    return false;
+  res.not_modified();
+  return true;
+} // state_not_modified()
+
+static void handle_state(const SSW::HttpRequest& req, SSW::HttpResponse& res)
+{
+  if ( !state_not_modified(req, res) )
+    res.send_template(200, "application/json", STATE_JSON, resolve_state);
+} // handle_state()
+
+static void handle_state_bin(const SSW::HttpRequest& req, SSW::HttpResponse& res)
+{
+  if ( !state_not_modified(req, res) )
+    res.send_copy(200, "application/octet-stream", &state_snapshot.current(), sizeof(StateSnapshot));
+} // handle_state_bin()
+
+/// @brief /api/history?sensor=temp|humidity|light&from=..&to=..&res=..
+/// Times are history_time(); see history_stream.h for the rest.
+static void handle_history(const SSW::HttpRequest& req, SSW::HttpResponse& res)
+{
+  SSW::HistoryParams params;
+  if ( !SSW::parse_history_params(req, history_time(), params) )
+  {
+    res.send(400, "text/plain", "Bad from, to, res or format\n");
+    return;
+  }
+  if ( strcmp(params.sensor, "temp") == 0 )
+    SSW::send_history(temp_history, params, res);
+  else if ( strcmp(params.sensor, "humidity") == 0 )
+    SSW::send_history(humid_history, params, res);
+  else if ( strcmp(params.sensor, "light") == 0 )
+    SSW::send_history(light_history, params, res);
+  else
+    res.send(400, "text/plain", "sensor must be temp, humidity or light\n");
+} // handle_history()
+
+/// @brief HttpProducer for /metrics: as many UiMetrics lines as fit.
+/// The context is the index of the next line.
+static size_t metrics_producer(void* ctx, char* buf, size_t cap, bool& done)
+{
+  uint16_t& line = *static_cast<uint16_t*>(ctx);
+  size_t n = 0;
+  for ( ;; )
+  {
+    const int len = ui_metrics.metric_line(line, buf + n, cap - n);
+    if ( len < 0 )
+    {
+      done = true;
+      break;
+    }
+    if ( len == 0 )
+      break; // Buffer full
+    n += static_cast<size_t>(len);
+    ++line;
+  }
+  return n;
+} // metrics_producer()
+
+/// @brief /metrics: UI frame times and LVGL memory, Prometheus text format.
+static void handle_metrics(const SSW::HttpRequest&, SSW::HttpResponse& res)
+{
+  const uint16_t line = 0;
+  res.header("Cache-Control", "no-cache");
+  res.send_stream(200, "text/plain; version=0.0.4", metrics_producer, &line, sizeof(line));
+} // handle_metrics()
+
+/// @brief Starts serving once the network is up.
+static void setup_state_server()
+{
+  state_server.on("/api/state", handle_state);
+  state_server.on("/api/state.bin", handle_state_bin);
+  state_server.on("/api/history", handle_history);
+  state_server.on("/metrics", handle_metrics);
+  if ( state_backend.begin(STATE_SERVER_PORT) )
+    Serial.printf("State server listening on port %u\n", STATE_SERVER_PORT);
+  else
+    Serial.println("State server failed to start");
+} // setup_state_server()
+
+/// @brief Publishes the latest readings for the state server.
+/// @param temp: Filtered room temperature, NAN until the first reading
+/// @param humidity: Filtered humidity, NAN until the first reading
+static void publish_state(float temp, float humidity)
+{
+  static uint32_t last_ms = 0;
+  const uint32_t now = millis();
+  if ( state_snapshot.version() != 0 && now - last_ms < STATE_SNAPSHOT_MS )
+    return;
+  last_ms = now;
+
+  StateSnapshot& snap = state_snapshot.edit();
+  snap.format = STATE_FORMAT;
+  snap.occupancy = static_cast<uint8_t>(occupancy.state());
+  snap.stale = ( outside_temp_src.stale(now) ? 0x01U : 0U ) | ( fam_room_temp_src.stale(now) ? 0x02U : 0U );
+  snap.temp = to_hundredths(temp);
+  snap.humidity = isnan(humidity) ? 0U : static_cast<uint16_t>(lroundf(humidity * 100.0f));
+  snap.set_temp = to_hundredths(lr_temp_controller.set_temp());
+  snap.outside_temp = outside_temp_src.value().seq != 0 ? to_hundredths(outside_temp_src.value().value) : NO_READING;
+  snap.fam_room_temp = fam_room_temp_src.value().seq != 0 ? to_hundredths(fam_room_temp_src.value().value) : NO_READING;
+  snap.light = light_sensor.available() ? light_sensor.level() : 0U;
+  state_snapshot.publish();
+} // publish_state()
+
 // const char* ntpServer = "time.google.com";
 const char* ntpServer = "pool.ntp.org";
 
@@ -229,12 +721,11 @@ void setup()
 
   Serial.println("Encoder has been setup");
 
-  pinMode(TFT_BACKLIGHT, OUTPUT);
+  pinMode(TFT_BL_PIN, OUTPUT);
   pinMode(TFT_CS, OUTPUT);
   pinMode(TOUCH_CS, OUTPUT);
   pinMode(SD_CS, OUTPUT);
-  pinMode(PIR_PIN, INPUT);
-  digitalWrite(TFT_BACKLIGHT, HIGH);
+  digitalWrite(TFT_BL_PIN, HIGH);
   digitalWrite(TFT_CS, HIGH);
   digitalWrite(TOUCH_CS, HIGH);
   digitalWrite(SD_CS, HIGH);
@@ -243,7 +734,9 @@ void setup()
   // Initialize touch display and LVGL
   tft.begin();
   tft.setRotation(1);
-  tft.setBrightness(15); // 0 - 255?
+  touch.begin();
+  if ( !backlight.begin(BACKLIGHT_DIM_LEVEL) )
+    tft.setBrightness(15); // Not faded, but still dimmed
 #if !CALIBRATE
 #ifdef ESPI
   ft.setTouch( TOUCH_CAL_DATA );
@@ -257,7 +750,7 @@ void setup()
   Serial.println( LVGL_Arduino );
 
   lv_init();
-  lv_disp_draw_buf_init( &draw_buf, buf, NULL, SCREEN_WIDTH * 10 );
+  lv_disp_draw_buf_init( &draw_buf, buf_1, buf_2, SCREEN_WIDTH * DISP_BUF_LINES );
 
   // Initialize the display
   static lv_disp_drv_t disp_drv;
@@ -266,6 +759,7 @@ void setup()
   disp_drv.ver_res = SCREEN_HEIGHT;
   disp_drv.flush_cb = my_disp_flush;
   disp_drv.draw_buf = &draw_buf;
+  ui_metrics.attach( disp_drv );
   lv_disp_drv_register( &disp_drv );
 
   /*Initialize the input device driver*/
@@ -296,13 +790,27 @@ void setup()
 
   lr_temp_controller.init();
 
+  remote_sensors.add(outside_temp_src);
+  remote_sensors.add(fam_room_temp_src);
+  outside_temp_src.begin(millis());
+  fam_room_temp_src.begin(millis());
+
   pinMode(DHTPIN, INPUT_PULLUP);
   dht.begin();
   Serial.println("DHT has been setup");
 
+  if ( light_sensor.begin() )
+    Serial.println("Light sensor has been setup");
+  else
+    Serial.println("Light sensor setup failed");
+
   setup_encoder_button_handler(); // Encoder
   Serial.println("Encoder button has been setup");
 
+  setup_pir();
+  Serial.println("PIR has been setup");
+  display_power.begin(millis());
+
  // SD Card
   if ( SD.begin(SD_CS) ) 
   {
@@ -312,6 +820,10 @@ void setup()
     {
       cardSize = SD.cardSize() / (1024 * 1024);
       Serial.printf("SD Card Type: %s  Size: %lluMB\n", card_type(cardType), cardSize);
+
+      // Records and the index are in epoch seconds, so nothing is logged
+      // before SNTP has set the clock; see loop().
+      log_waiting = true;
     }
     else
     {
@@ -340,6 +852,8 @@ void setup()
   #define PST_OFFSET -8*3600
   configTime(PST_OFFSET, DST_OFFSET, ntpServer);
 
+  setup_state_server();
+
   // This has to be the last thing in setup()!
   initialize_wdt(10000, &wdt_ISR); // 10000 msec
 
@@ -391,6 +905,7 @@ void loop() {
 
     static float humidity = 0.0;
     static float temp_fahren = 0.0;
+    static bool have_dht = false;
     if (loop_cntr % (15000/DELAY) == 0)
     {
       static const float TEMP_CORR = -3.0; // Temperature correction. Not sure it's constant.
@@ -407,8 +922,15 @@ void loop() {
       }
       else
       {
-        humidity = h;
-        temp_fahren = t + TEMP_CORR;
+        // The log keeps the raw readings so the filters can be re-tuned
+        // offline; everything else sees the filtered values.
+        data_logger.log_sample(history_time(), SSW::LogChannel::Temp, t + TEMP_CORR);
+        data_logger.log_sample(history_time(), SSW::LogChannel::Humidity, h);
+        temp_fahren = temp_filter.step(lroundf((t + TEMP_CORR) * SSW::LOG_SAMPLE_SCALE)) / float(SSW::LOG_SAMPLE_SCALE);
+        humidity = humid_filter.step(lroundf(h * SSW::LOG_SAMPLE_SCALE)) / float(SSW::LOG_SAMPLE_SCALE);
+        temp_history.add_float(history_time(), temp_fahren);
+        humid_history.add_float(history_time(), humidity);
+        have_dht = true;
   #if 0
         // Compute heat index in Fahrenheit (the default)
         float hif = dht.computeHeatIndex(temp_fahren, humidity);
@@ -421,8 +943,35 @@ void loop() {
       }
     }
 
+    // The encoder and its button keep the display awake. A turn that wakes
+    // the suspended display only wakes it: until the knob has been still
+    // for ENCODER_WAKE_MS, the encoder is put back before the controller
+    // sees it, so the set point does not move.
+    static int64_t last_enc_count = encoder.getCount();
+    static unsigned last_button_cnt = button_cnt;
+    static uint32_t wake_turn_ms = 0;
+    static bool wake_turn = false;
+    if ( encoder.getCount() != last_enc_count || button_cnt != last_button_cnt )
+    {
+      if ( encoder.getCount() != last_enc_count &&
+           ( display_asleep || ( wake_turn && millis() - wake_turn_ms < ENCODER_WAKE_MS ) ) )
+      {
+        lr_temp_controller.discard_input();
+        wake_turn = true;
+        wake_turn_ms = millis();
+      }
+      else
+      {
+        wake_turn = false;
+      }
+      last_enc_count = encoder.getCount();
+      last_button_cnt = button_cnt;
+      display_power.input(millis());
+    }
+
     // Perform the update on the living room temperature controller.
     lr_temp_controller.update();
+    last_enc_count = encoder.getCount(); // The controller moves it to the set temp
 
     // Check the lamp relay state
     if ( loop_cntr % (5000/DELAY) == 0)
@@ -440,47 +989,54 @@ void loop() {
       Serial.println("Pressed : Button Cnt: " + String(button_cnt));
     }
 
-    if ( loop_cntr % 100/DELAY )
+    if ( loop_cntr % (100/DELAY) == 0 )
     {
       update_temp_humid_display(temp_fahren, humidity);
     }
 
-    if (loop_cntr % (20000/DELAY) == 0)
+    if ( (loop_cntr % (20000/DELAY) == 0) && light_sensor.available() )
     {
-      // Read light level
-      auto light_level = analogRead(LIGHT_PIN);
+      // Latest filtered light level
+      auto light_level = light_sensor.level();
+      light_history.add(history_time(), light_level);
+      data_logger.log_sample(history_time(), SSW::LogChannel::Light, light_level);
       Serial.println("Light: " + String(light_level));
     }
 
-    static int last_state = 0;
-    static bool motion_detected = false;
-    if (loop_cntr % (999/DELAY) == 0)
+    // Apply the PIR edges captured by pirISR()
+    if ( occupancy.update(pir_edges, millis()) )
+      Serial.printf("Occupancy: %s\n", SSW::occupancy_name(occupancy.state()));
+
+    // Touch keeps the display awake as well. LVGL reads touch while the
+    // display is awake; while it sleeps, the PENIRQ line is checked here,
+    // or without one, the panel at a slow rate.
+    if ( display_asleep && (TOUCH_IRQ_PIN >= 0 || loop_cntr % (SUSPENDED_TOUCH_POLL_MS/DELAY) == 0) )
     {
-      // Read the PIR sensor
-      int cur_state = digitalRead(PIR_PIN);
-      if ( cur_state != last_state )
-      {
-        if ( cur_state == 1 )
-        {
-          Serial.println("Motion detected!");
-        }
-        last_state = cur_state;
-        motion_detected = ( cur_state == 1 );
-      }
+      uint16_t x, y;
+      if ( touch.read(x, y) )
+        display_power.input(millis());
     }
 
-    static SSW::Timer motion_timeout(10000);
-    if ( !motion_detected )
+    // Move between active, dim and suspended
+    if ( display_power.update(occupancy.present(), millis()) )
     {
-      if ( motion_timeout.expired() )
-      {
-        tft.setBrightness(15);
-      }
+      Serial.printf("Display: %s\n", SSW::display_state_name(display_power.state()));
+      if ( display_asleep && !display_power.suspended() )
+        resume_display();
+      static const uint32_t FADE_MS[] = { BACKLIGHT_WAKE_MS, BACKLIGHT_DIM_MS, BACKLIGHT_OFF_MS };
+      backlight.set_target(backlight_level(), FADE_MS[static_cast<unsigned>(display_power.state())], millis());
     }
-    else
+    // Sleep the panel once the backlight is out
+    if ( display_power.suspended() && !display_asleep && !backlight.fading() )
+      suspend_display();
+
+    // Follow the room light with each newly published level
+    static uint32_t light_seq = 0;
+    if ( light_sensor.sequence() != light_seq )
     {
-      tft.setBrightness(220); // 0 - 255?
-      motion_timeout.reset();
+      light_seq = light_sensor.sequence();
+      ambient_backlight.update(light_sensor.level());
+      backlight.set_target(backlight_level(), BACKLIGHT_AMBIENT_MS, millis());
     }
 
     static bool synch_completed = false;
@@ -496,84 +1052,134 @@ void loop() {
         synch_completed = true;
     }
 
-    // Update the outside temperature
-    if ( loop_cntr % (60000/DELAY) == 0 )
+    // Poll the most overdue remote sensor; at most one request per pass.
+    if ( loop_cntr % (1000/DELAY) == 0 )
     {
-      String json;
-      if ( http_get_from_server("/device?dev_id=ESP_F803", "", json) )
-      {
-  //      Serial.println("\n\nOutside temp sensor: " + json);
-
-        DeserializationError error = deserializeJson(json_doc, json);
-        if ( error )
-        {
-          Serial.printf("JSON Decoding Error: %s\n", error.c_str());
-        }
-        else
-        {
-            float outside_temp = json_doc["subdevs"]["bme280"]["state"]["temp"];
-            float humid = json_doc["subdevs"]["bme280"]["state"]["humid"];
-            float baro = json_doc["subdevs"]["bme280"]["state"]["baro"];
-  //          Serial.printf("Outside temp: %3.1f humid: %2.1f, baro: %2.1f\n", outside_temp, humid, baro);
-            update_outside_temp(outside_temp, humid, baro);
-        }
-      }
-      else
-        Serial.println("Get outside temperature failed.");
+      const uint32_t now = millis();
+      SSW::FreshSource* src = remote_sensors.next_due(now);
+      if ( src == &outside_temp_src )
+        poll_outside_temp(now);
+      else if ( src == &fam_room_temp_src )
+        poll_fam_room_temp(now);
+
+      set_outside_temp_stale(outside_temp_src.stale(now));
+      set_fam_room_temp_stale(fam_room_temp_src.stale(now));
     }
 
-    // Update the family room temperature
-    if ( loop_cntr % (58000/DELAY) == 0 )
-    {
-      String json;
-      if ( http_get_from_server("/device?dev_id=ESP_F444", "", json) )
-      {
-  //      Serial.println("\n\nFamily room temp sensor: " + json);
-
-        DeserializationError error = deserializeJson(json_doc, json);
-        if ( error )
-        {
-          Serial.printf("JSON Decoding Error: %s\n", error.c_str());
-        }
-        else
-        {
-            float family_room_temp = json_doc["subdevs"]["ds18b20"]["state"]["temp"];
-  //          Serial.printf("Family room temp: %3.1f\n", family_room_temp);
-            update_fam_room_temp(family_room_temp);
-        }
-      }
-      else
-        Serial.println("Get family room temperature failed.");
-    }
+    publish_state(have_dht ? temp_fahren : NAN, have_dht ? humidity : NAN);
+  }
+
+  // Start the next backlight fade segment, if any
+  backlight.update(millis());
+
+  // Start logging once the clock is set, then write out any staged blocks
+  if ( log_waiting && clock_synced() )
+  {
+    log_waiting = false;
+    if ( data_logger.begin(history_time()) )
+      Serial.printf("Logging to file %u block %u\n", data_logger.file_no(), data_logger.next_block());
+    else
+      Serial.println("Data logger failed to start");
+  }
+  data_logger.service(history_time());
+
+  // Answer state requests without blocking
+  state_server.poll(millis());
+
+  // Let the GUI do it's work, starting with whatever changed this pass.
+  // While the display is asleep the screen functions still record their
+  // values; resume_display() shows them.
+  if ( !display_asleep )
+  {
+    commit_screen();
+    lv_timer_handler();
+  }
+  if ( loop_cntr % (1000/DELAY) == 0 )
+  {
+    ui_metrics.sample(screen_widget_updates());
+#if DISP_STATS
+    print_disp_stats(millis());
+#endif
   }
-  // Let the GUI do it's work
-  lv_timer_handler();
 
   loop_cntr++;
 
-  delay(DELAY);
+  idle_wait(DELAY);
 } // loop()
 
-/* LVGL: Display flush */
+/* LVGL: Display flush
+ * Starts a DMA transfer of the stripe and returns at once, so LVGL
+ * renders the next stripe into the other buffer meanwhile. There is no
+ * DMA-complete callback to call lv_disp_flush_ready() from; instead the
+ * next pushImageDMA() waits for the previous transfer, which is all the
+ * protection the buffer LVGL is about to reuse needs. The bus is shared
+ * with touch and the SD card, so it is released after the last stripe
+ * of a refresh. */
 void my_disp_flush( lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color_p )
 {
-    uint32_t w = ( area->x2 - area->x1 + 1 );
-    uint32_t h = ( area->y2 - area->y1 + 1 );
-
-    tft.startWrite();
-    tft.setAddrWindow( area->x1, area->y1, w, h );
-    tft.pushPixels( ( uint16_t * )&color_p->full, w * h, true );
-    tft.endWrite();
+    const int32_t w = ( area->x2 - area->x1 + 1 );
+    const int32_t h = ( area->y2 - area->y1 + 1 );
+    ui_metrics.flush_begin( micros() );
+
+    if ( tft.getStartCount() == 0 )
+      tft.startWrite();
+    // LV_COLOR_16_SWAP: the buffer already holds big-endian RGB565
+#if DISP_FLUSH_DMA
+    tft.pushImageDMA( area->x1, area->y1, w, h, reinterpret_cast<const lgfx::swap565_t *>(color_p) );
+#else
+    tft.pushImage( area->x1, area->y1, w, h, reinterpret_cast<const lgfx::swap565_t *>(color_p) );
+#endif
+    if ( lv_disp_flush_is_last( disp ) )
+    {
+      tft.waitDMA();
+      tft.endWrite();
+    }
 
+    ui_metrics.flush_end( micros() );
     lv_disp_flush_ready( disp );
 } // my_disp_flush()
 
+#if DISP_STATS
+/// @brief Prints the display counters every DISP_STATS_MS, scaled to a
+/// minute so runs with different settings compare directly, followed by
+/// the UI metrics distributions.
+static void print_disp_stats(uint32_t now)
+{
+  static uint32_t last_print = 0;
+  static uint32_t last_frames = 0;
+  static uint64_t last_pixels = 0;
+  static uint32_t last_flushes = 0;
+  static uint64_t last_frame_us = 0;
+  static uint64_t last_flush_wait_us = 0;
+  static uint32_t last_updates = 0;
+  if ( now - last_print < DISP_STATS_MS )
+    return;
+  const uint32_t frames = ui_metrics.frames() - last_frames;
+  const uint32_t flushes = ui_metrics.flushes() - last_flushes;
+  const float per_min = 60000.0f / (now - last_print);
+  Serial.printf("Display per minute: %.0f widget updates %.0f redraws %.0f KB SPI; %u ms/redraw %u us/flush waiting (%u lines/stripe)\n",
+    (ui_metrics.widget_updates() - last_updates) * per_min, frames * per_min,
+    (ui_metrics.pixels() - last_pixels) * 2.0f / 1024.0f * per_min,
+    frames ? static_cast<unsigned>((ui_metrics.frame_us() - last_frame_us) / 1000U / frames) : 0U,
+    flushes ? static_cast<unsigned>((ui_metrics.flush_wait_us() - last_flush_wait_us) / flushes) : 0U,
+    DISP_BUF_LINES);
+  ui_metrics.print(Serial);
+  last_print = now;
+  last_frames = ui_metrics.frames();
+  last_pixels = ui_metrics.pixels();
+  last_flushes = ui_metrics.flushes();
+  last_frame_us = ui_metrics.frame_us();
+  last_flush_wait_us = ui_metrics.flush_wait_us();
+  last_updates = ui_metrics.widget_updates();
+} // print_disp_stats()
+#endif
+
 /*Read the touchpad*/
 void my_touchpad_read( lv_indev_drv_t * indev_driver, lv_indev_data_t * data )
 {
     uint16_t touchX, touchY;
 
-    bool touched = tft.getTouch( &touchX, &touchY);
+    bool touched = touch.read( touchX, touchY );
 
     if( !touched )
     {
@@ -582,6 +1188,7 @@ void my_touchpad_read( lv_indev_drv_t * indev_driver, lv_indev_data_t * data )
     else
     {
         data->state = LV_INDEV_STATE_PR;
+        display_power.input(millis());
 
         /*Set the coordinates*/
         data->point.x = touchX;
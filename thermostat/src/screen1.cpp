@@ -1,20 +1,12 @@
+// Only LVGL and the Arduino core: the display driver lives in main.cpp,
+// and host/screen_render builds this file for Linux.
 #include <Arduino.h>
-#include <esp_sntp.h>
+#include <stdarg.h>
 
 #include "screen1.h"
+#include "ui_fonts.h"
 
 #include <lvgl.h>
-#ifdef ESPI
-// https://github.com/Bodmer/TFT_eSPI
-// This video has a good summary of how to use the library, including the
-// SD card.
-// https://www.youtube.com/watch?v=rq5yPJbX_uk&ab_channel=XTronical
-//
-// User Setup comes from; TFT_eSPI/User_Setups/User_Setup.h
-#include <TFT_eSPI.h>
-#else
-#include "lovyan_gfx_setup.h"
-#endif
 
 static lv_obj_t *outside_temp_label = nullptr;
 static lv_obj_t *outside_baro_label = nullptr;
@@ -40,6 +32,119 @@ static void set_value(void *indic, int32_t v)
   lv_meter_set_indicator_end_value(meter, (lv_meter_indicator_t *)indic, v);
 } // set_value()
 
+///////////////////////////////////////////////////////////////////////
+// View model
+// The update functions write into these fields rather than the widgets.
+// A field only becomes dirty when its value differs from what is shown,
+// and commit_screen() hands the dirty ones to LVGL once per frame, so a
+// value refreshed several times between frames costs one invalidation
+// and an unchanged value costs none.
+static uint32_t widget_updates = 0U; ///< Widget changes handed to LVGL
+
+/// @brief The text of a label. The label displays the field's own buffer
+/// (lv_label_set_text_static), so LVGL never copies it.
+template <size_t N>
+class TextField
+{
+public:
+  /// @brief Attaches the label, showing its initial text. The label is
+  /// always set, even to "", so it never shows LVGL's default text.
+  void bind(lv_obj_t* label, const char* text)
+  {
+    _label = label;
+    set("%s", text);
+    _dirty = true;
+    commit();
+  } // bind()
+
+  /// @brief Formats the next text; marks the field dirty if it differs.
+  void set(const char* fmt, ...) __attribute__((format(printf, 2, 3)))
+  {
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(_next, N, fmt, args);
+    va_end(args);
+    _dirty = strcmp(_next, _shown) != 0;
+  } // set()
+
+  /// @brief Shows the new text if it changed.
+  /// @return true if the label was invalidated
+  bool commit()
+  {
+    if ( !_dirty || _label == nullptr )
+      return false;
+    memcpy(_shown, _next, N);
+    lv_label_set_text_static(_label, _shown);
+    _dirty = false;
+    return true;
+  } // commit()
+
+private:
+  lv_obj_t* _label {nullptr};
+  char      _shown[N] {};
+  char      _next[N] {};
+  bool      _dirty {false};
+}; // class TextField
+
+/// @brief A meter indicator, in whole degrees. A change animates the
+/// indicator from the shown value to the new one.
+class MeterField
+{
+public:
+  void bind(lv_meter_indicator_t* indic) { _indic = indic; }
+
+  void set(int value) { _next = value; }
+
+  bool commit()
+  {
+    if ( _next == _shown || _indic == nullptr )
+      return false;
+    lv_anim_set_var(&a, _indic);
+    lv_anim_set_time(&a, 500);
+    lv_anim_set_values(&a, _shown, _next);
+    lv_anim_start(&a);
+    _shown = _next;
+    return true;
+  } // commit()
+
+private:
+  lv_meter_indicator_t* _indic {nullptr};
+  int _shown {0};
+  int _next {0};
+}; // class MeterField
+
+static TextField<12> time_text;
+static TextField<8>  date_text;
+static TextField<10> outside_temp_text;
+static TextField<16> outside_baro_text;
+static TextField<10> fr_temp_text;
+static TextField<8>  temp_text;
+static TextField<8>  humid_text;
+static TextField<8>  tset_text;
+static MeterField    temp_meter;
+static MeterField    tset_meter;
+
+void commit_screen()
+{
+  unsigned n = 0U;
+  n += time_text.commit();
+  n += date_text.commit();
+  n += outside_temp_text.commit();
+  n += outside_baro_text.commit();
+  n += fr_temp_text.commit();
+  n += temp_text.commit();
+  n += humid_text.commit();
+  n += tset_text.commit();
+  n += temp_meter.commit();
+  n += tset_meter.commit();
+  widget_updates += n;
+} // commit_screen()
+
+uint32_t screen_widget_updates()
+{
+  return widget_updates;
+} // screen_widget_updates()
+
 void set_lamp_button_event_handler(lv_event_cb_t btn_event_handler)
 {
   lv_obj_add_event_cb(lamp_btn, btn_event_handler, LV_EVENT_ALL, NULL);
@@ -79,6 +184,8 @@ void setup_screen(void)
 
   temp_indic = lv_meter_add_arc(meter, scale, 10, lv_palette_main(LV_PALETTE_RED), 0);
   tset_indic = lv_meter_add_arc(meter, scale, 10, lv_palette_main(LV_PALETTE_BLUE), -15);
+  temp_meter.bind(temp_indic);
+  tset_meter.bind(tset_indic);
 
   lv_anim_init(&a);
   lv_anim_set_exec_cb(&a, set_value);
@@ -104,20 +211,20 @@ void setup_screen(void)
   static lv_style_t style_center;
   lv_style_init(&style_center);
   lv_style_set_text_align(&style_center, LV_TEXT_ALIGN_CENTER);
-  lv_style_set_text_font(&style_center, &lv_font_montserrat_42);
+  lv_style_set_text_font(&style_center, &UI_FONT_42);
 
   // Current temperature, center of screen
   temp_label = lv_label_create(lv_scr_act());
   lv_obj_set_width(temp_label, 200);
-  lv_label_set_text(temp_label, "");
+  temp_text.bind(temp_label, "");
   lv_obj_add_style(temp_label, &style_center, LV_PART_MAIN);
   lv_obj_align(temp_label, LV_ALIGN_CENTER, 0, -6);
   // Current humidity
   humid_label = lv_label_create(lv_scr_act());
   lv_obj_set_width(humid_label, 100);
-  lv_label_set_text(humid_label, "");
+  humid_text.bind(humid_label, "");
   lv_obj_add_style(humid_label, &style_center, LV_PART_MAIN);
-  lv_obj_set_style_text_font(humid_label, &lv_font_montserrat_18, LV_PART_MAIN);
+  lv_obj_set_style_text_font(humid_label, &UI_FONT_18, LV_PART_MAIN);
   lv_obj_align_to(humid_label, temp_label, LV_ALIGN_OUT_BOTTOM_MID, 0, 0);
 
 
@@ -126,7 +233,7 @@ void setup_screen(void)
   lv_obj_set_width(tset_label, 200);
   lv_obj_add_style(tset_label, &style_center, LV_PART_MAIN);
   lv_obj_set_style_text_color(tset_label, lv_palette_main(LV_PALETTE_BLUE), LV_PART_MAIN);
-  lv_label_set_text(tset_label, "");
+  tset_text.bind(tset_label, "");
   lv_obj_align(tset_label, LV_ALIGN_BOTTOM_MID, 0, -20);
 
   ///////////////////////////////////////////////////////////////////////
@@ -135,50 +242,50 @@ void setup_screen(void)
   time_label = lv_label_create(lv_scr_act());
   lv_obj_set_width(time_label, 100);
   lv_obj_set_style_text_align(time_label, LV_TEXT_ALIGN_RIGHT, 0);
-  lv_obj_set_style_text_font(time_label, &lv_font_montserrat_22, LV_PART_MAIN);
+  lv_obj_set_style_text_font(time_label, &UI_FONT_22, LV_PART_MAIN);
   lv_obj_set_style_text_color(time_label, lv_color_white(), LV_PART_MAIN);
   lv_obj_align(time_label, LV_ALIGN_TOP_RIGHT, -10, 0);
-  lv_label_set_text(time_label, "20:10");
+  time_text.bind(time_label, "20:10");
 
   ///////////////////////////////////////////////////////////////////////
   // Date field
   date_label = lv_label_create(lv_scr_act());
   lv_obj_set_width(date_label, 100);
   lv_obj_set_style_text_align(date_label, LV_TEXT_ALIGN_RIGHT, 0);
-  lv_obj_set_style_text_font(date_label, &lv_font_montserrat_18, LV_PART_MAIN);
+  lv_obj_set_style_text_font(date_label, &UI_FONT_18, LV_PART_MAIN);
   lv_obj_set_style_text_color(date_label, lv_color_white(), LV_PART_MAIN);
   lv_obj_align_to(date_label, time_label, LV_ALIGN_OUT_BOTTOM_RIGHT, 0, 5);
-  lv_label_set_text(date_label, "July 29");
+  date_text.bind(date_label, "July 29");
 
   ///////////////////////////////////////////////////////////////////////
   // Outside temperature field
   outside_temp_label = lv_label_create(lv_scr_act());
   lv_obj_set_width(outside_temp_label, 100);
   lv_obj_set_style_text_align(outside_temp_label, LV_TEXT_ALIGN_LEFT, 0);
-  lv_obj_set_style_text_font(outside_temp_label, &lv_font_montserrat_22, LV_PART_MAIN);
+  lv_obj_set_style_text_font(outside_temp_label, &UI_FONT_22, LV_PART_MAIN);
   lv_obj_set_style_text_color(outside_temp_label, lv_color_white(), LV_PART_MAIN);
   lv_obj_align(outside_temp_label, LV_ALIGN_TOP_LEFT, 10, 0);
-  lv_label_set_text(outside_temp_label, "00.0");
+  outside_temp_text.bind(outside_temp_label, "00.0");
 
   ///////////////////////////////////////////////////////////////////////
   // Outside humidity and barometric pressure field
   outside_baro_label = lv_label_create(lv_scr_act());
   lv_obj_set_width(outside_baro_label, 100);
   lv_obj_set_style_text_align(outside_baro_label, LV_TEXT_ALIGN_LEFT, 0);
-  lv_obj_set_style_text_font(outside_baro_label, &lv_font_montserrat_18, LV_PART_MAIN);
+  lv_obj_set_style_text_font(outside_baro_label, &UI_FONT_18, LV_PART_MAIN);
   lv_obj_set_style_text_color(outside_baro_label, lv_color_white(), LV_PART_MAIN);
   lv_obj_align_to(outside_baro_label, outside_temp_label, LV_ALIGN_OUT_BOTTOM_LEFT, 0, 5);
-  lv_label_set_text(outside_baro_label, "00.0%\n00.0");
+  outside_baro_text.bind(outside_baro_label, "00.0%\n00.0");
 
   ///////////////////////////////////////////////////////////////////////
   // Family room temperature
   fr_temp_label = lv_label_create(lv_scr_act());
   lv_obj_set_width(fr_temp_label, 100);
   lv_obj_set_style_text_align(fr_temp_label, LV_TEXT_ALIGN_RIGHT, 0);
-  lv_obj_set_style_text_font(fr_temp_label, &lv_font_montserrat_22, LV_PART_MAIN);
+  lv_obj_set_style_text_font(fr_temp_label, &UI_FONT_22, LV_PART_MAIN);
   lv_obj_set_style_text_color(fr_temp_label, lv_color_white(), LV_PART_MAIN);
   lv_obj_align(fr_temp_label, LV_ALIGN_BOTTOM_RIGHT, -10, -5);
-  lv_label_set_text(fr_temp_label, "00.0");
+  fr_temp_text.bind(fr_temp_label, "00.0");
 
   ///////////////////////////////////////////////////////////////////////
   // Table lamp button
@@ -202,79 +309,61 @@ void update_time_label()
     return;
   }
  
-  char date[8] = "";
-  char tod[12] = "";
   static const char months[13][4] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec", "ERR" };
   if ( (time.tm_mon < 0) || (time.tm_mon > 11) )
     time.tm_mon = 12;
   else
     time.tm_mon = time.tm_mon; // 0-index into array
 
-  snprintf(date, sizeof(date), "%3.3s %02d", months[time.tm_mon], time.tm_mday);
+  date_text.set("%3.3s %02d", months[time.tm_mon], time.tm_mday);
   int hr = (time.tm_hour > 12) ? time.tm_hour-12 : time.tm_hour;
-  snprintf(tod, sizeof(tod), "%2d:%02d %s", hr, time.tm_min, (time.tm_hour<12)?"am":"pm");
-  
-  lv_label_set_text(time_label, tod );
-  lv_label_set_text(date_label, date );
+  time_text.set("%2d:%02d %s", hr, time.tm_min, (time.tm_hour<12)?"am":"pm");
 } // update_time()
 
 void update_outside_temp(const float temp, const float humid, const float baro) 
 {
-  char temps[9] = "";
-  char baros[14] = "";
-  snprintf(temps, sizeof(temps), "%3.1f°F", temp);
-  snprintf(baros, sizeof(baros), "%2.1f%%\n%2.1f\"", humid, baro);
-
-  lv_label_set_text(outside_temp_label, temps);
-  lv_label_set_text(outside_baro_label, baros);
+  outside_temp_text.set("%3.1f°F", temp);
+  outside_baro_text.set("%2.1f%%\n%2.1f\"", humid, baro);
 } // update_outside_temp()
 
 void update_fam_room_temp(const float temp) 
 {
-  char temps[9] = "";
-  snprintf(temps, sizeof(temps), "%3.1f°F", temp);
-
-  lv_label_set_text(fr_temp_label, temps);
+  fr_temp_text.set("%3.1f°F", temp);
 } // update_fam_room_temp()
 
-void update_temp_humid_display(float temp_fahren, float humid)
+/// @brief Greys out a label while its reading is stale. Only touches the
+/// style when the state changes.
+static void set_label_stale(lv_obj_t* label, bool stale, bool& prev_stale)
 {
+  if ( label == nullptr || stale == prev_stale )
+    return;
+  lv_obj_set_style_text_color(label, stale ? lv_palette_main(LV_PALETTE_GREY) : lv_color_white(), LV_PART_MAIN);
+  prev_stale = stale;
+} // set_label_stale()
 
-  char tmp_str[8] = "";
-  static int prev_temp = 0;
-  // Update when there is any change of 0.1 degree
-  int curr_temp = static_cast<int>(temp_fahren*10.0+0.5);
-  if ( curr_temp != prev_temp )
-  {
-    snprintf(tmp_str, sizeof(tmp_str), "%2.1f", temp_fahren);
-    lv_label_set_text(temp_label, tmp_str);
-    snprintf(tmp_str, sizeof(tmp_str), "%3.0f%%", humid);
-    lv_label_set_text(humid_label, tmp_str);
-
+void set_outside_temp_stale(bool stale)
+{
+  static bool prev_stale = false;
+  set_label_stale(outside_temp_label, stale, prev_stale);
+  static bool prev_baro_stale = false;
+  set_label_stale(outside_baro_label, stale, prev_baro_stale);
+} // set_outside_temp_stale()
 
-    lv_anim_set_var(&a, temp_indic);
-    lv_anim_set_time(&a, 500);
-    lv_anim_set_values(&a, static_cast<int>(prev_temp/10.0+0.5), static_cast<int>(curr_temp/10.0+0.5));
-    lv_anim_start(&a);
-    prev_temp = curr_temp;
-  }
+void set_fam_room_temp_stale(bool stale)
+{
+  static bool prev_stale = false;
+  set_label_stale(fr_temp_label, stale, prev_stale);
+} // set_fam_room_temp_stale()
 
-} // update_temp_tset_display()
+void update_temp_humid_display(float temp_fahren, float humid)
+{
+  temp_text.set("%2.1f", temp_fahren);
+  humid_text.set("%3.0f%%", humid);
+  temp_meter.set(static_cast<int>(lroundf(temp_fahren)));
+} // update_temp_humid_display()
 
 void SetTempDE::update(float set_temp)
 {
-  int curr_tset = static_cast<int>(set_temp*10.0+0.5);
-  if ( curr_tset != _prev_tset )
-  {
-    char tsets[8] {""};
-    snprintf(tsets, sizeof(tsets), "%2.1f", set_temp);
-    lv_label_set_text(tset_label, tsets);
-
-    lv_anim_set_var(&a, tset_indic);
-    lv_anim_set_time(&a, 500);
-    lv_anim_set_values(&a, static_cast<int>(_prev_tset/10.0+0.5), static_cast<int>(curr_tset/10.0+0.5));
-    lv_anim_start(&a);
-    _prev_tset = curr_tset;
-  }
-
+  tset_text.set("%2.1f", set_temp);
+  tset_meter.set(static_cast<int>(lroundf(set_temp)));
 } // update()
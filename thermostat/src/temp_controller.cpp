@@ -2,14 +2,22 @@
 
 #include "http_request.h"
 #include "screen1.h"
+#include "data_logger.h"
 #include <ESP32Encoder.h>
 
 void TempController::init()
 {
   // Update the encoder position based on the new set temp.
   _encoder.setCount(_temp_to_count(_set_temp));
+  // The initial set temp is not a change
+  _logged_set_temp = _set_temp;
 } // init()
 
+void TempController::discard_input()
+{
+  _encoder.setCount(_temp_to_count(_set_temp));
+} // discard_input()
+
 bool TempController::update()
 {
   // Early return if it isn't time to do something
@@ -67,6 +75,13 @@ bool TempController::update()
   // Update the encoder position based on the new set temp.
   _encoder.setCount(_temp_to_count(_set_temp));
 
+  // Log settled set-point changes, not every step while the knob turns.
+  if ( !_position_changing && _set_temp != _logged_set_temp )
+  {
+    data_logger.log_set_point(static_cast<uint32_t>(time(nullptr)), _logged_set_temp, _set_temp);
+    _logged_set_temp = _set_temp;
+  }
+
   // Update the display with the set temp
   if ( _display != nullptr )
   {
@@ -0,0 +1,81 @@
+#include <Arduino.h>
+#include <driver/gpio.h>
+
+#include "adc_filter.h"
+#include "touch_penirq.h"
+
+static_assert(PenIrqTouch::SAMPLES == 5, "read() uses SSW::median5()");
+
+void PenIrqTouch::begin()
+{
+  if ( _irq_pin < 0 )
+    return;
+  // PENIRQ is open drain. The internal pull-up helps only on pins that
+  // have one: GPIOs 34-39 do not, and rely on the module's or an external
+  // pull-up.
+  pinMode(_irq_pin, INPUT_PULLUP);
+  _edge = false;
+  attachInterruptArg(_irq_pin, _isr, this, FALLING);
+} // begin()
+
+void IRAM_ATTR PenIrqTouch::_isr(void* arg)
+{
+  static_cast<PenIrqTouch*>(arg)->_edge = true;
+} // _isr()
+
+bool PenIrqTouch::pressed() const
+{
+  return _irq_pin < 0 || _edge || digitalRead(_irq_pin) == LOW;
+} // pressed()
+
+bool PenIrqTouch::read(uint16_t& x, uint16_t& y)
+{
+  if ( !pressed() )
+  {
+    ++_idle;
+    return false;
+  }
+  ++_sampled;
+
+  // The XPT2046 drives PENIRQ during conversions, so the edges a read
+  // produces are masked, and the latch is cleared after unmasking in
+  // case one got through.
+  if ( _irq_pin >= 0 )
+    gpio_intr_disable(static_cast<gpio_num_t>(_irq_pin));
+
+  uint16_t xs[SAMPLES];
+  uint16_t ys[SAMPLES];
+  unsigned n = 0;
+  for ( unsigned i = 0; i < SAMPLES; ++i )
+  {
+    uint16_t tx, ty;
+    if ( _tft.getTouch(&tx, &ty) )
+    {
+      xs[n] = tx;
+      ys[n] = ty;
+      ++n;
+    }
+    // Without PENIRQ an untouched panel costs one getTouch(), as polling
+    // did; the rest of the samples are taken only once it reports a touch
+    else if ( i == 0 && _irq_pin < 0 )
+      return false;
+  }
+
+  if ( _irq_pin >= 0 )
+  {
+    gpio_intr_enable(static_cast<gpio_num_t>(_irq_pin));
+    _edge = false;
+  }
+
+  if ( n * 2 < SAMPLES )
+    return false;
+  // Pad a partial set with its own samples so the median stays within them
+  for ( unsigned i = n; i < SAMPLES; ++i )
+  {
+    xs[i] = xs[i - n];
+    ys[i] = ys[i - n];
+  }
+  x = SSW::median5(xs[0], xs[1], xs[2], xs[3], xs[4]);
+  y = SSW::median5(ys[0], ys[1], ys[2], ys[3], ys[4]);
+  return true;
+} // read()
@@ -0,0 +1,128 @@
+#include <Arduino.h>
+#include <cstdio>
+
+#include "ui_metrics.h"
+
+namespace SSW
+{
+
+constexpr uint32_t UiMetrics::US_BOUNDS[];
+constexpr uint32_t UiMetrics::PX_BOUNDS[];
+constexpr uint32_t UiMetrics::PCT_BOUNDS[];
+
+void UiMetrics::attach(lv_disp_drv_t& drv)
+{
+  drv.user_data = this;
+  drv.render_start_cb = &UiMetrics::_render_start;
+  drv.monitor_cb = &UiMetrics::_monitor;
+} // attach()
+
+void UiMetrics::_render_start(lv_disp_drv_t* drv)
+{
+  UiMetrics* self = static_cast<UiMetrics*>(drv->user_data);
+  self->_frame_start = micros();
+  self->_flush_us = 0;
+} // _render_start()
+
+void UiMetrics::_monitor(lv_disp_drv_t* drv, uint32_t /*time_ms*/, uint32_t px)
+{
+  UiMetrics* self = static_cast<UiMetrics*>(drv->user_data);
+  const uint32_t frame_us = micros() - self->_frame_start;
+  self->_frame_hist.add(frame_us);
+  self->_flush_hist.add(self->_flush_us);
+  self->_render_hist.add(frame_us > self->_flush_us ? frame_us - self->_flush_us : 0);
+  self->_pixel_hist.add(px);
+  self->_frames++;
+  self->_pixels += px;
+} // _monitor()
+
+void UiMetrics::sample(uint32_t widget_updates)
+{
+  lv_mem_monitor(&_mem);
+  _mem_used_hist.add(_mem.used_pct);
+  _mem_frag_hist.add(_mem.frag_pct);
+  _widget_updates = widget_updates;
+} // sample()
+
+template <size_t N>
+static void print_hist(Print& out, const char* name, const Histogram<N>& h)
+{
+  out.printf("UI %s: p50 %u p90 %u p99 %u max %u (n %u)\n", name,
+    h.percentile(50), h.percentile(90), h.percentile(99), h.max(), h.count());
+} // print_hist()
+
+void UiMetrics::print(Print& out) const
+{
+  print_hist(out, "frame_us", _frame_hist);
+  print_hist(out, "render_us", _render_hist);
+  print_hist(out, "flush_us", _flush_hist);
+  print_hist(out, "pixels", _pixel_hist);
+  out.printf("UI mem: %u%% used, max %u of %u bytes, %u%% frag, biggest free %u\n",
+    _mem.used_pct, static_cast<unsigned>(_mem.max_used), static_cast<unsigned>(_mem.total_size),
+    _mem.frag_pct, static_cast<unsigned>(_mem.free_biggest_size));
+} // print()
+
+/// @brief Formats a line of a histogram's exposition if 'index' falls
+/// within it, otherwise takes its lines off 'index'.
+/// @return true if 'index' was in this histogram
+template <size_t N>
+static bool hist_line(const char* name, const Histogram<N>& h, size_t& index, char* buf, size_t cap, int& n)
+{
+  const size_t lines = N + 4; // TYPE, buckets, +Inf, sum, count
+  if ( index >= lines )
+  {
+    index -= lines;
+    return false;
+  }
+  if ( index == 0 )
+    n = snprintf(buf, cap, "# TYPE %s histogram\n", name);
+  else if ( index <= N )
+    n = snprintf(buf, cap, "%s_bucket{le=\"%u\"} %u\n", name, h.bound(index - 1), h.cumulative(index - 1));
+  else if ( index == N + 1 )
+    n = snprintf(buf, cap, "%s_bucket{le=\"+Inf\"} %u\n", name, h.count());
+  else if ( index == N + 2 )
+    n = snprintf(buf, cap, "%s_sum %llu\n", name, static_cast<unsigned long long>(h.sum()));
+  else
+    n = snprintf(buf, cap, "%s_count %u\n", name, h.count());
+  return true;
+} // hist_line()
+
+int UiMetrics::metric_line(size_t index, char* buf, size_t cap) const
+{
+  int n = -1;
+  if ( hist_line("ui_frame_us", _frame_hist, index, buf, cap, n) ||
+       hist_line("ui_render_us", _render_hist, index, buf, cap, n) ||
+       hist_line("ui_flush_us", _flush_hist, index, buf, cap, n) ||
+       hist_line("ui_frame_pixels", _pixel_hist, index, buf, cap, n) ||
+       hist_line("ui_mem_used_percent", _mem_used_hist, index, buf, cap, n) ||
+       hist_line("ui_mem_frag_percent", _mem_frag_hist, index, buf, cap, n) )
+    return n < 0 || static_cast<size_t>(n) >= cap ? 0 : n;
+
+  struct Scalar
+  {
+    const char* name;
+    const char* type;
+    unsigned long long value;
+  };
+  const Scalar scalars[] =
+  {
+    {"ui_frames_total", "counter", _frames},
+    {"ui_pixels_total", "counter", _pixels},
+    {"ui_flushes_total", "counter", _flushes},
+    {"ui_widget_updates_total", "counter", _widget_updates},
+    {"ui_mem_total_bytes", "gauge", _mem.total_size},
+    {"ui_mem_free_bytes", "gauge", _mem.free_size},
+    {"ui_mem_free_biggest_bytes", "gauge", _mem.free_biggest_size},
+    {"ui_mem_max_used_bytes", "gauge", _mem.max_used},
+  };
+  if ( index >= 2 * sizeof(scalars) / sizeof(scalars[0]) )
+    return -1;
+  const Scalar& s = scalars[index / 2];
+  if ( index % 2 == 0 )
+    n = snprintf(buf, cap, "# TYPE %s %s\n", s.name, s.type);
+  else
+    n = snprintf(buf, cap, "%s %llu\n", s.name, s.value);
+  return n < 0 || static_cast<size_t>(n) >= cap ? 0 : n;
+} // metric_line()
+
+} // namespace SSW
@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+"""Generates the reduced LVGL fonts used by the thermostat screen.
+
+The big screen labels only ever show digits and a handful of other
+characters, but the stock lv_font_montserrat_NN fonts carry all of
+printable ASCII. For each entry in fonts.json this runs lv_font_conv on
+the same Montserrat TTF LVGL builds its fonts from, keeping only the
+listed characters, and writes src/fonts/<name>.c. lv_conf.h then leaves
+the fonts they replace out of the build.
+
+Runs from platformio.ini as a pre-build script, where it finds the TTF
+in the LVGL library that PlatformIO has installed and defines
+UI_SUBSET_FONTS=1 once every font has been generated. Fonts are only
+regenerated when fonts.json or the TTF is newer. If lv_font_conv cannot
+be run (it needs Node.js; npx fetches it on first use) the build fails,
+so a build never quietly ends up with the other font set. Set
+custom_ui_fonts = stock in platformio.ini to build with the stock fonts
+and skip this script.
+
+From the command line:
+
+    python3 tools/fonts/make_fonts.py --ttf .pio/libdeps/nodemcu-32s/lvgl/scripts/built_in_font/Montserrat-Medium.ttf
+
+--compress --suffix _z writes compressed copies of every font, named
+<name>_z, for comparing size and speed (host/build.sh does this).
+"""
+
+import argparse
+import json
+import os
+import shutil
+import subprocess
+import sys
+
+
+def glyphs(font):
+    """The characters to keep, without duplicates, as a string."""
+    seen = []
+    for part in font["text"]:
+        for ch in part:
+            if ch not in seen:
+                seen.append(ch)
+    return "".join(seen)
+
+
+def converter():
+    """Command that runs lv_font_conv, or None."""
+    if shutil.which("lv_font_conv"):
+        return ["lv_font_conv"]
+    if shutil.which("npx"):
+        return ["npx", "--yes", "lv_font_conv"]
+    return None
+
+
+def up_to_date(out, inputs):
+    if not os.path.exists(out):
+        return False
+    stamp = os.path.getmtime(out)
+    return all(os.path.getmtime(i) <= stamp for i in inputs)
+
+
+def generate(config_path, ttf, out_dir, force=False, compress=None, suffix=""):
+    """Generates every font in the config. Returns True if all exist.
+
+    compress overrides each font's "compress" setting when not None, and
+    suffix is appended to the font and file names."""
+    if not os.path.exists(ttf):
+        print("make_fonts: %s not found" % ttf, file=sys.stderr)
+        return False
+    with open(config_path, encoding="utf-8") as f:
+        config = json.load(f)
+    os.makedirs(out_dir, exist_ok=True)
+    conv = None
+    for font in config["fonts"]:
+        name = font["name"] + suffix
+        out = os.path.join(out_dir, name + ".c")
+        if not force and up_to_date(out, [config_path, ttf]):
+            continue
+        if conv is None:
+            conv = converter()
+            if conv is None:
+                print("make_fonts: lv_font_conv not found", file=sys.stderr)
+                return False
+        cmd = conv + [
+            "--font", ttf,
+            "--size", str(font["size"]),
+            "--bpp", str(font["bpp"]),
+            "--symbols", glyphs(font),
+            "--format", "lvgl",
+            "--lv-include", "lvgl.h",
+            "--lv-font-name", name,
+            "--no-prefilter",
+            "-o", out,
+        ]
+        if not (font.get("compress", False) if compress is None else compress):
+            cmd.append("--no-compress")
+        print("make_fonts: %s (%d pt, %d glyphs)" % (name, font["size"], len(glyphs(font))))
+        try:
+            subprocess.run(cmd, check=True)
+        except (OSError, subprocess.CalledProcessError) as e:
+            print("make_fonts: %s failed: %s" % (name, e), file=sys.stderr)
+            if os.path.exists(out):
+                os.remove(out)
+            return False
+    return True
+
+
+def pio_main(env):
+    """PlatformIO pre-build hook."""
+    fonts = env.GetProjectOption("custom_ui_fonts", "subset")
+    if fonts == "stock":
+        print("make_fonts: custom_ui_fonts = stock, using the stock fonts")
+        return
+    if fonts != "subset":
+        print("make_fonts: custom_ui_fonts must be subset or stock, not %s" % fonts, file=sys.stderr)
+        env.Exit(1)
+    project = env.subst("$PROJECT_DIR")
+    ttf = os.path.join(env.subst("$PROJECT_LIBDEPS_DIR"), env.subst("$PIOENV"),
+                       "lvgl", "scripts", "built_in_font", "Montserrat-Medium.ttf")
+    if generate(os.path.join(project, "tools", "fonts", "fonts.json"), ttf,
+                os.path.join(project, "src", "fonts")):
+        env.Append(CPPDEFINES=[("UI_SUBSET_FONTS", 1)])
+    else:
+        print("make_fonts: could not generate the fonts in fonts.json. Install "
+              "Node.js (or lv_font_conv), or set custom_ui_fonts = stock", file=sys.stderr)
+        env.Exit(1)
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--ttf", required=True, help="Montserrat-Medium.ttf from LVGL's scripts/built_in_font")
+    parser.add_argument("--config", default=os.path.join(here, "fonts.json"))
+    parser.add_argument("--out", default=os.path.join(here, "..", "..", "src", "fonts"))
+    parser.add_argument("--force", action="store_true", help="Regenerate even if up to date")
+    parser.add_argument("--compress", action="store_true", help="Compress every font, whatever fonts.json says")
+    parser.add_argument("--suffix", default="", help="Append to the font and file names")
+    args = parser.parse_args()
+    compress = True if args.compress else None
+    return 0 if generate(args.config, args.ttf, args.out, args.force, compress, args.suffix) else 1
+
+
+try:
+    Import("env")  # noqa: F821 (SCons)
+except NameError:
+    if __name__ == "__main__":
+        sys.exit(main())
+else:
+    pio_main(env)  # noqa: F821
@@ -0,0 +1,492 @@
+/////////////////////////////////////////////////////////////////////
+/// Thermostat log analysis tool
+///
+/// Reads the binary logs written by SSW::DataLogger (see log_format.h)
+/// on a workstation. Log files are memory-mapped, the index blocks are
+/// used to skip data blocks outside the requested time range, and
+/// multiple files are processed in parallel by a small thread pool.
+///
+/// See README.md in this directory for build instructions.
+/////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "log_format.h"
+#include "data_logger.h"
+
+using namespace SSW;
+
+namespace
+{
+
+enum class Mode
+{
+  Csv,
+  Stats,
+  Series,
+  Synth
+};
+
+struct Options
+{
+  Mode     mode {Mode::Stats};
+  uint32_t from {0};
+  uint32_t to {UINT32_MAX};
+  int      channel {-1};        ///< -1 for all channels
+  uint32_t period_s {3600};     ///< Bucket size for --series
+  unsigned threads {0};         ///< 0 for hardware concurrency
+  bool     verify {true};       ///< Check block CRCs
+  bool     timing {false};      ///< Report elapsed time on stderr
+  std::vector<std::string> files;
+};
+
+/// Running statistics for one (type, channel) key or one series bucket.
+struct Acc
+{
+  uint64_t count {0};
+  int64_t  sum {0};
+  int32_t  min {INT32_MAX};
+  int32_t  max {INT32_MIN};
+  uint32_t first_t {UINT32_MAX};
+  uint32_t last_t {0};
+
+  void add(const LogRecord& r)
+  {
+    ++count;
+    sum += r.a;
+    min = std::min(min, r.a);
+    max = std::max(max, r.a);
+    first_t = std::min(first_t, r.t);
+    last_t = std::max(last_t, r.t);
+  }
+
+  void merge(const Acc& o)
+  {
+    count += o.count;
+    sum += o.sum;
+    min = std::min(min, o.min);
+    max = std::max(max, o.max);
+    first_t = std::min(first_t, o.first_t);
+    last_t = std::max(last_t, o.last_t);
+  }
+};
+
+/// Key for statistics: record type in the high byte, channel in the low.
+inline uint16_t stat_key(const LogRecord& r) { return static_cast<uint16_t>((r.type << 8) | r.channel); }
+
+/// Key for series buckets: the stat key and the bucket start time.
+inline uint64_t series_key(const LogRecord& r, uint32_t period)
+{
+  return (static_cast<uint64_t>(stat_key(r)) << 32) | (r.t - r.t % period);
+}
+
+/// Everything one worker produces for one file.
+struct FileResult
+{
+  std::string csv;
+  std::map<uint16_t, Acc> stats;
+  std::map<uint64_t, Acc> series;
+  uint64_t blocks_read {0};
+  uint64_t blocks_skipped {0};
+  uint64_t bad_blocks {0};
+  std::string error;
+};
+
+const char* type_name(uint8_t type)
+{
+  switch ( static_cast<LogRecordType>(type) )
+  {
+    case LogRecordType::Sample: return "sample";
+    case LogRecordType::SetPoint: return "set_point";
+    case LogRecordType::NetLatency: return "latency";
+  }
+  return "unknown";
+}
+
+const char* channel_name(uint8_t ch)
+{
+  switch ( static_cast<LogChannel>(ch) )
+  {
+    case LogChannel::Temp: return "temp";
+    case LogChannel::Humidity: return "humidity";
+    case LogChannel::Light: return "light";
+    case LogChannel::OutsideTemp: return "outside_temp";
+    case LogChannel::FamRoomTemp: return "fam_room_temp";
+    case LogChannel::CtrlServer: return "ctrl_server";
+    case LogChannel::OtherDevice: return "other_device";
+  }
+  return "unknown";
+}
+
+/// Converts the 'a' value of a record to engineering units.
+double scaled(uint8_t type, double a)
+{
+  switch ( static_cast<LogRecordType>(type) )
+  {
+    case LogRecordType::Sample: return a / LOG_SAMPLE_SCALE;
+    case LogRecordType::SetPoint: return a / 10.0;
+    default: return a;
+  }
+}
+
+/// A read-only memory mapping of a log file.
+class MappedFile
+{
+public:
+  explicit MappedFile(const std::string& path)
+  {
+    int fd = open(path.c_str(), O_RDONLY);
+    if ( fd < 0 )
+      return;
+    struct stat st;
+    if ( fstat(fd, &st) == 0 && st.st_size >= static_cast<off_t>(LOG_BLOCK_SIZE) )
+    {
+      void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if ( p != MAP_FAILED )
+      {
+        _data = static_cast<const uint8_t*>(p);
+        _size = st.st_size;
+        madvise(p, _size, MADV_SEQUENTIAL);
+      }
+    }
+    close(fd);
+  }
+  ~MappedFile()
+  {
+    if ( _data != nullptr )
+      munmap(const_cast<uint8_t*>(_data), _size);
+  }
+
+  bool ok() const { return _data != nullptr; }
+  uint32_t blocks() const { return static_cast<uint32_t>(_size / LOG_BLOCK_SIZE); }
+  const LogBlock& block(uint32_t pos) const
+  {
+    return *reinterpret_cast<const LogBlock*>(_data + static_cast<size_t>(pos) * LOG_BLOCK_SIZE);
+  }
+
+private:
+  const uint8_t* _data {nullptr};
+  size_t _size {0};
+};
+
+class FileScanner
+{
+public:
+  FileScanner(const Options& opt, FileResult& res) : _opt(opt), _res(res) {}
+
+  void scan(const std::string& path)
+  {
+    MappedFile mf(path);
+    if ( !mf.ok() )
+    {
+      _res.error = "cannot map " + path;
+      return;
+    }
+    if ( !_valid(mf, 0) || mf.block(0).hdr.type != static_cast<uint8_t>(LogBlockType::FileHeader) )
+    {
+      _res.error = "not a thermostat log: " + path;
+      return;
+    }
+
+    // Walk complete groups through their index blocks.
+    const uint32_t nblocks = mf.blocks();
+    uint32_t pos = 1;
+    for ( uint32_t ipos = LOG_GROUP_BLOCKS; ipos < nblocks; ipos += LOG_GROUP_BLOCKS )
+    {
+      const LogBlock& idx = mf.block(ipos);
+      if ( !_valid(mf, ipos) || idx.hdr.type != static_cast<uint8_t>(LogBlockType::Index) )
+        break;
+      for ( uint16_t i = 0; i < idx.hdr.count; ++i )
+      {
+        const LogIndexEntry& e = idx.index[i];
+        if ( e.last_t < _opt.from || e.first_t >= _opt.to )
+        {
+          ++_res.blocks_skipped;
+          continue;
+        }
+        if ( !_data_block(mf, e.block) )
+          return;
+      }
+      pos = ipos + 1;
+    }
+
+    // The tail after the last index block has no index; read it directly
+    // up to the footer or the first damaged block.
+    for ( ; pos < nblocks; ++pos )
+    {
+      if ( log_is_index_pos(pos) )
+        continue;
+      const LogBlock& blk = mf.block(pos);
+      if ( !_valid(mf, pos) || blk.hdr.type != static_cast<uint8_t>(LogBlockType::Data) )
+        break;
+      _data_block(mf, pos);
+    }
+  }
+
+private:
+  bool _valid(const MappedFile& mf, uint32_t pos)
+  {
+    const LogBlock& blk = mf.block(pos);
+    if ( !_opt.verify )
+      return blk.hdr.magic == LOG_MAGIC && blk.hdr.seq == pos;
+    return log_block_valid(blk, pos);
+  }
+
+  bool _data_block(const MappedFile& mf, uint32_t pos)
+  {
+    if ( pos >= mf.blocks() || !_valid(mf, pos) )
+    {
+      ++_res.bad_blocks;
+      return false;
+    }
+    ++_res.blocks_read;
+    const LogBlock& blk = mf.block(pos);
+    const uint16_t n = std::min<uint16_t>(blk.hdr.count, LOG_RECORDS_PER_BLOCK);
+    for ( uint16_t i = 0; i < n; ++i )
+    {
+      const LogRecord& r = blk.records[i];
+      if ( r.t < _opt.from || r.t >= _opt.to )
+        continue;
+      if ( _opt.channel >= 0 && r.channel != _opt.channel )
+        continue;
+      _record(r);
+    }
+    return true;
+  }
+
+  void _record(const LogRecord& r)
+  {
+    switch ( _opt.mode )
+    {
+      case Mode::Csv:
+      {
+        char line[96];
+        int len = snprintf(line, sizeof(line), "%" PRIu32 ",%s,%s,%.2f,%" PRId32 "\n",
+          r.t, type_name(r.type), channel_name(r.channel), scaled(r.type, r.a), r.b);
+        _res.csv.append(line, len);
+        break;
+      }
+      case Mode::Stats:
+        _lookup(_res.stats, stat_key(r)).add(r);
+        break;
+      case Mode::Series:
+        _lookup(_res.series, series_key(r, _opt.period_s)).add(r);
+        break;
+      case Mode::Synth:
+        break;
+    }
+  }
+
+  // Consecutive records usually share a key, so remember the last one
+  // and skip the map lookup.
+  template <typename Key>
+  Acc& _lookup(std::map<Key, Acc>& m, Key key)
+  {
+    if ( _last_acc == nullptr || key != _last_key )
+    {
+      _last_acc = &m[key];
+      _last_key = key;
+    }
+    return *_last_acc;
+  }
+
+  const Options& _opt;
+  FileResult& _res;
+  Acc* _last_acc {nullptr};
+  uint64_t _last_key {0};
+};
+
+/// Runs 'job(i)' for i in [0, n) on a fixed pool of threads. Each worker
+/// claims the next index from a shared counter.
+template <typename Job>
+void parallel_for(size_t n, unsigned threads, Job job)
+{
+  std::atomic<size_t> next {0};
+  auto worker = [&]() {
+    for ( size_t i = next++; i < n; i = next++ )
+      job(i);
+  };
+  std::vector<std::thread> pool;
+  for ( unsigned t = 1; t < threads && t < n; ++t )
+    pool.emplace_back(worker);
+  worker();
+  for ( auto& th : pool )
+    th.join();
+}
+
+/// Writes a synthetic log set with the device logger: 'days' of 15 s
+/// temperature and humidity samples. Useful for benchmarking.
+int synth(const std::string& dir, unsigned days)
+{
+  DataLogger logger(dir.c_str());
+  uint32_t t = 1672531200U; // 2023-01-01
+  if ( !logger.begin(t) )
+  {
+    fprintf(stderr, "cannot create logs in %s\n", dir.c_str());
+    return 1;
+  }
+  const uint32_t end_t = t + days * 86400U;
+  for ( ; t < end_t; t += 15 )
+  {
+    double day = (t % 86400U) / 86400.0;
+    logger.log_sample(t, LogChannel::Temp, static_cast<float>(68.0 + 3.0 * std::sin(day * 2 * M_PI)));
+    logger.log_sample(t, LogChannel::Humidity, static_cast<float>(40.0 + 5.0 * std::cos(day * 2 * M_PI)));
+    logger.service(t);
+    logger.service(t);
+  }
+  logger.end(t);
+  printf("wrote %u files to %s\n", logger.file_no(), dir.c_str());
+  return 0;
+}
+
+void usage()
+{
+  fprintf(stderr,
+    "usage: log_tool [options] FILE...\n"
+    "       log_tool --synth DIR DAYS\n"
+    "  --csv              dump records as CSV\n"
+    "  --stats            per type/channel summary (default)\n"
+    "  --series SECONDS   downsample to SECONDS buckets (min/max/mean)\n"
+    "  --from T --to T    time range, seconds since the epoch\n"
+    "  --channel N        only channel N\n"
+    "  --threads N        worker threads (default: all cores)\n"
+    "  --no-verify        skip block CRC checks\n"
+    "  --time             report elapsed time on stderr\n");
+}
+
+bool parse(int argc, char** argv, Options& opt)
+{
+  for ( int i = 1; i < argc; ++i )
+  {
+    std::string a = argv[i];
+    auto next = [&](uint32_t& v) {
+      if ( i + 1 >= argc ) return false;
+      v = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+      return true;
+    };
+    uint32_t v = 0;
+    if ( a == "--csv" ) opt.mode = Mode::Csv;
+    else if ( a == "--stats" ) opt.mode = Mode::Stats;
+    else if ( a == "--series" ) { if ( !next(opt.period_s) || opt.period_s == 0 ) return false; opt.mode = Mode::Series; }
+    else if ( a == "--from" ) { if ( !next(opt.from) ) return false; }
+    else if ( a == "--to" ) { if ( !next(opt.to) ) return false; }
+    else if ( a == "--channel" ) { if ( !next(v) ) return false; opt.channel = static_cast<int>(v); }
+    else if ( a == "--threads" ) { if ( !next(v) ) return false; opt.threads = v; }
+    else if ( a == "--no-verify" ) opt.verify = false;
+    else if ( a == "--time" ) opt.timing = true;
+    else if ( a == "--synth" ) opt.mode = Mode::Synth;
+    else if ( a.size() > 1 && a[0] == '-' ) return false;
+    else opt.files.push_back(a);
+  }
+  return !opt.files.empty();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  Options opt;
+  if ( !parse(argc, argv, opt) )
+  {
+    usage();
+    return 2;
+  }
+  if ( opt.mode == Mode::Synth )
+  {
+    if ( opt.files.size() != 2 )
+    {
+      usage();
+      return 2;
+    }
+    return synth(opt.files[0], static_cast<unsigned>(atoi(opt.files[1].c_str())));
+  }
+
+  // Files are named by rotation number, so name order is time order.
+  std::sort(opt.files.begin(), opt.files.end());
+  if ( opt.threads == 0 )
+    opt.threads = std::max(1U, std::thread::hardware_concurrency());
+
+  const auto start = std::chrono::steady_clock::now();
+
+  std::vector<FileResult> results(opt.files.size());
+  parallel_for(opt.files.size(), opt.threads, [&](size_t i) {
+    FileScanner(opt, results[i]).scan(opt.files[i]);
+  });
+
+  // Merge in file order.
+  FileResult total;
+  for ( auto& r : results )
+  {
+    if ( !r.error.empty() )
+      fprintf(stderr, "warning: %s\n", r.error.c_str());
+    total.blocks_read += r.blocks_read;
+    total.blocks_skipped += r.blocks_skipped;
+    total.bad_blocks += r.bad_blocks;
+    for ( const auto& kv : r.stats )
+      total.stats[kv.first].merge(kv.second);
+    for ( const auto& kv : r.series )
+      total.series[kv.first].merge(kv.second);
+  }
+
+  switch ( opt.mode )
+  {
+    case Mode::Csv:
+      fputs("t,type,channel,a,b\n", stdout);
+      for ( const auto& r : results )
+        fwrite(r.csv.data(), 1, r.csv.size(), stdout);
+      break;
+
+    case Mode::Stats:
+      printf("type,channel,count,first_t,last_t,min,max,mean\n");
+      for ( const auto& kv : total.stats )
+      {
+        const uint8_t type = kv.first >> 8;
+        const Acc& a = kv.second;
+        printf("%s,%s,%" PRIu64 ",%" PRIu32 ",%" PRIu32 ",%.2f,%.2f,%.3f\n",
+          type_name(type), channel_name(kv.first & 0xFFU), a.count, a.first_t, a.last_t,
+          scaled(type, a.min), scaled(type, a.max), scaled(type, static_cast<double>(a.sum) / a.count));
+      }
+      break;
+
+    case Mode::Series:
+      printf("t,type,channel,count,min,max,mean\n");
+      for ( const auto& kv : total.series )
+      {
+        const uint16_t key = static_cast<uint16_t>(kv.first >> 32);
+        const uint8_t type = key >> 8;
+        const Acc& a = kv.second;
+        printf("%" PRIu32 ",%s,%s,%" PRIu64 ",%.2f,%.2f,%.3f\n",
+          static_cast<uint32_t>(kv.first), type_name(type), channel_name(key & 0xFFU), a.count,
+          scaled(type, a.min), scaled(type, a.max), scaled(type, static_cast<double>(a.sum) / a.count));
+      }
+      break;
+
+    case Mode::Synth:
+      break;
+  }
+
+  if ( opt.timing )
+  {
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    fprintf(stderr, "%zu files, %" PRIu64 " blocks read, %" PRIu64 " skipped by index, %" PRIu64
+      " bad, %u threads, %.1f ms\n", opt.files.size(), total.blocks_read, total.blocks_skipped,
+      total.bad_blocks, opt.threads, ms);
+  }
+  return 0;
+}